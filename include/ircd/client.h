@@ -32,6 +32,7 @@ struct ircd::client
 	struct conf;
 	struct settings;
 	struct request;
+	struct h2;
 
 	static log::log log;
 	static struct settings settings;
@@ -62,6 +63,8 @@ struct ircd::client
 	size_t head_length {0};
 	size_t content_consumed {0};
 	resource::request request;
+	std::shared_ptr<struct h2> h2;    // HTTP/2 connection this client is or is a stream of
+	uint32_t stream_id {0};           // HTTP/2 stream handled by this client
 
 	string_view loghead() const;
 	size_t write_all(const const_buffer &);
@@ -74,6 +77,7 @@ struct ircd::client
 	bool main();
 	bool async();
 
+	client(std::shared_ptr<struct h2>, const uint32_t &stream_id, const string_view &head, const string_view &content);
 	client(std::shared_ptr<socket>);
 	client(client &&) = delete;
 	client(const client &) = delete;
@@ -42,7 +42,8 @@ struct ircd::ctx::ole::opts
 	/// Optionally give this offload task a name for any tasklist.
 	string_view name;
 
-	/// The function will be executed on each thread.
+	/// The function is queued this many times and may be executed on as many
+	/// threads at once; the caller divides the work among the invocations.
 	size_t concurrency {1};
 
 	/// Queuing priority; in the form of a nice value.
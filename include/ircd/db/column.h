@@ -43,6 +43,7 @@ namespace ircd::db
 	bool has(column &, const string_view &key, const gopts & = {});
 	bool cached(column &, const string_view &key, const gopts & = {});
 	bool prefetch(column &, const string_view &key, const gopts & = {});
+	size_t prefetch(column &, const vector_view<const string_view> &keys, const gopts & = {});
 
 	// [GET] Query space usage
 	size_t bytes(column &, const std::pair<string_view, string_view> &range, const gopts & = {});
@@ -147,6 +148,12 @@ struct ircd::db::column
 	void operator()(const string_view &key, const view_closure &func, const gopts & = {});
 	void operator()(const string_view &key, const gopts &, const view_closure &func);
 
+	// [GET] Perform a get of a batch of keys with a single query to the database. The
+	// closure is called with the position in the batch of each key which was found;
+	// a key which fails to read is logged and skipped rather than failing the batch.
+	using multi_closure = std::function<void (const size_t &, const string_view &)>;
+	size_t operator()(const vector_view<const string_view> &keys, std::nothrow_t, const multi_closure &func, const gopts & = {});
+
 	// [SET] Perform operations in a sequence as a single transaction. No template iterators
 	// supported yet, just a ContiguousContainer iteration (and derived convenience overloads)
 	void operator()(const delta *const &begin, const delta *const &end, const sopts & = {});
@@ -20,32 +20,67 @@ struct ircd::db::prefetcher
 {
 	struct ticker;
 	struct request;
+	struct lane;
 	using closure = std::function<bool (request &)>;
+	using lane_id = std::pair<const database *, uint32_t>;
+
+	static conf::item<size_t> depth_min;
+	static conf::item<size_t> depth_max;
+	static conf::item<size_t> widen;
+	static conf::item<size_t> throttle;
 
 	ctx::dock dock;
-	std::deque<request> queue;
+	std::map<lane_id, lane> lanes;
+	lane_id cursor;
 	std::unique_ptr<ticker> ticker;
 	ctx::context context;
 	size_t request_workers {0};
 
+	lane &get(database &, const column &);
+	lane *next();
 	size_t wait_pending();
-	void request_handle(request &);
-	size_t request_cleanup() noexcept;
-	void request_worker();
-	void handle();
+	void request_handle(lane &, request &);
+	size_t request_cleanup(lane &) noexcept;
+	void request_worker(lane &);
+	void handle(lane &);
+	bool dispatch(lane &, const gopts &);
 	void worker();
 
   public:
+	size_t size() const;               // Requests in all queues
+
 	size_t cancel(const closure &);
 	size_t cancel(database &);         // Cancel all for db
 	size_t cancel(column &);           // Cancel all for column
 
+	size_t operator()(column &, const vector_view<const string_view> &keys, const gopts &);
 	bool operator()(column &, const string_view &key, const gopts &);
 
 	prefetcher();
 	~prefetcher() noexcept;
 };
 
+/// Queue of requests for one column of a database. The number of requests
+/// dispatched to the database at once is limited by the depth, which adapts
+/// to the latency of the device observed from the req and fin timestamps:
+/// it widens by one each round of requests completing near the lowest
+/// latency seen recently, and narrows with each request completing at a
+/// multiple of it, so a saturated device is left to the foreground.
+struct ircd::db::prefetcher::lane
+{
+	std::deque<request> queue;
+	size_t pending {0};                ///< Requests not yet taken by a worker
+	size_t dispatched {0};             ///< Workers dispatched for this lane
+	size_t active {0};                 ///< Workers with a request in progress
+	size_t depth {1};                  ///< Limit of dispatched workers
+	size_t credit {0};                 ///< Completions toward widening
+	microseconds latency {0us};        ///< Moving average of req-fin
+	microseconds baseline {0us};       ///< Lowest recent req-fin
+
+	bool ready() const;
+	void sample(const microseconds &);
+};
+
 struct ircd::db::prefetcher::request
 {
 	using key_buf = char[208];
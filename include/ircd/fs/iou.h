@@ -21,6 +21,11 @@ extern "C"
 	struct io_uring_sqe;
 }
 
+namespace ircd::ctx
+{
+	struct dock;
+}
+
 /// Input/Output Userspace Ring buffering.
 ///
 /// Note that fs::aio and fs::iou are never used simultaneously. If io_uring
@@ -63,6 +68,9 @@ namespace ircd::fs::iou
 	static size_t count(const op &);
 }
 
+/// Request control block. The entry on the submit queue is claimed when the
+/// request is submitted; `id` is its index until the kernel consumes it. The
+/// dock is notified on completion; one dock may be shared by a batch.
 struct ircd::fs::iou::request
 {
 	const fs::opts *opts {nullptr};
@@ -70,9 +78,15 @@ struct ircd::fs::iou::request
 	std::error_code ec;
 	int32_t res {-1};
 	int32_t id {-1};
+	int fd {-1};
+	const_iovec_view iov;
+	enum state state {};
+	ctx::dock *waiter {nullptr};
 
 	request() = default;
-	request(const fd &, const const_iovec_view &, const fs::opts *const &);
+	request(const fs::fd &, const const_iovec_view &, const fs::opts *const &);
+	request(request &&) = delete;
+	request(const request &) = delete;
 	~request() noexcept;
 };
 
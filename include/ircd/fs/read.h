@@ -14,6 +14,7 @@
 namespace ircd::fs
 {
 	struct read_opts extern const read_opts_default;
+	struct read_op;
 
 	// Yields ircd::ctx for read into buffers; returns bytes read
 	size_t read(const fd &, const mutable_buffers &, const read_opts & = read_opts_default);
@@ -27,6 +28,10 @@ namespace ircd::fs
 	std::string read(const fd &, const read_opts & = read_opts_default);
 	std::string read(const string_view &path, const read_opts & = read_opts_default);
 
+	// Yields ircd::ctx for a batch of reads submitted together; returns the
+	// number of ops which succeeded; errors are left in each op.
+	size_t read(const vector_view<read_op> &);
+
 	// Test whether bytes in the specified range are cached and should not block
 	bool fincore(const fd &, const size_t &, const read_opts & = read_opts_default);
 
@@ -56,6 +61,17 @@ struct ircd::fs::read_opts
 	read_opts(const off_t & = 0);
 };
 
+/// One read of a batch. The result is the number of bytes read into the
+/// buffer, or the exception thrown for this read alone.
+struct ircd::fs::read_op
+{
+	const fs::fd *fd {nullptr};
+	const read_opts *opts {nullptr};
+	mutable_buffer buf;
+	size_t ret {0};
+	std::exception_ptr eptr;
+};
+
 inline
 ircd::fs::read_opts::read_opts(const off_t &offset)
 :opts{offset, op::READ}
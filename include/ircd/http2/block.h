@@ -0,0 +1,31 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2019 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_HTTP2_BLOCK_H
+
+namespace ircd::http2
+{
+	struct block;
+}
+
+/// Header block received in a HEADERS frame and the CONTINUATION frames
+/// after it (RFC 7540 6.2, 6.10). No other frame may come between them;
+/// expect() throws for one that does. The padding and priority of the
+/// HEADERS frame are removed.
+struct ircd::http2::block
+{
+	std::string buf;                   ///< The block so far
+	uint32_t stream_id {0};            ///< Stream of an incomplete block; 0 for none
+	uint8_t flags {0};                 ///< Flags of the HEADERS frame
+
+	void expect(const frame::header &) const;
+	bool operator()(const frame::header &, const const_buffer &payload, const size_t &max);
+};
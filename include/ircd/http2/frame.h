@@ -21,6 +21,9 @@ struct ircd::http2::frame
 	struct header;
 	struct settings;
 	enum type :uint8_t;
+	enum flag :uint8_t;
+
+	static constexpr const size_t SIZE {9};
 
 	static string_view reflect(const type &);
 };
@@ -32,9 +35,33 @@ struct ircd::http2::frame::header
 	uint8_t flags;
 	uint32_t            : 1;
 	uint32_t stream_id  : 31;
+
+	header(const uint32_t &len, const enum type &, const uint8_t &flags, const uint32_t &stream_id);
+	explicit header(const const_buffer &);      // from the wire (network order)
+	header() = default;
 }
 __attribute__((packed));
 
+namespace ircd::http2
+{
+	using frame_closure = std::function<void (const frame::header &, const const_buffer &payload)>;
+
+	// Frames received; each one is validated for its type.
+	size_t read_frames(const_buffer &, const frame_closure &);
+	const_buffer read_data(const frame::header &, const const_buffer &payload);
+	uint32_t read_window(const frame::header &, const const_buffer &payload);
+	enum error::code read_reset(const frame::header &, const const_buffer &payload);
+	uint32_t read_goaway(const frame::header &, const const_buffer &payload);
+
+	// Frames sent; the payloads are in network order.
+	const_buffer write(const mutable_buffer &, const frame::header &);
+	void write(std::string &out, const frame::header &, const const_buffer &payload = {});
+	void write_headers(std::string &out, const const_buffer &block, const uint32_t &stream_id, const size_t &max_frame, const bool &end_stream);
+	const_buffer write_window(const mutable_buffer &, const uint32_t &increment);
+	const_buffer write_reset(const mutable_buffer &, const enum error::code &);
+	const_buffer write_goaway(const mutable_buffer &, const uint32_t &last_stream, const enum error::code &);
+}
+
 enum ircd::http2::frame::type
 :uint8_t
 {
@@ -49,3 +76,13 @@ enum ircd::http2::frame::type
 	WINDOW_UPDATE  = 0x8,
 	CONTINUATION   = 0x9,
 };
+
+enum ircd::http2::frame::flag
+:uint8_t
+{
+	ACK           = 0x01,              ///< SETTINGS, PING
+	END_STREAM    = 0x01,              ///< DATA, HEADERS
+	END_HEADERS   = 0x04,              ///< HEADERS, PUSH_PROMISE, CONTINUATION
+	PADDED        = 0x08,              ///< DATA, HEADERS, PUSH_PROMISE
+	PRIORITIZED   = 0x20,              ///< HEADERS (the PRIORITY flag)
+};
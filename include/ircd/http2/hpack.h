@@ -0,0 +1,55 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2019 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_HTTP2_HPACK_H
+
+namespace ircd::http2
+{
+	struct hpack;
+
+	// RFC 7540 8.1.2 field validity; names must be lowercase tokens.
+	bool valid_field_name(const string_view &);
+	bool valid_field_value(const string_view &);
+}
+
+/// RFC 7541 header compression. An instance holds the dynamic table for one
+/// direction of a connection. The decoder is complete; the encoder only
+/// emits literals without indexing, which never touch the dynamic table of
+/// the peer, so it requires no state.
+///
+/// The decoder counts the size of the header list as RFC 7540 6.5.2 does;
+/// once it exceeds list_max the rest of the block is decoded for the state
+/// of the table but not given to the closure, and false is returned.
+struct ircd::http2::hpack
+{
+	using field = std::pair<string_view, string_view>;
+	using closure = std::function<void (const string_view &, const string_view &)>;
+
+	static const field static_table[61];
+
+	std::deque<std::pair<std::string, std::string>> dynamic;
+	size_t dynamic_size {0};           ///< RFC 7541 4.1 size of the entries
+	size_t dynamic_max {4096};         ///< Current maximum set by the peer
+	size_t dynamic_limit {4096};       ///< Limit of dynamic_max we advertised
+
+	field at(const size_t &index) const;
+	void evict(const size_t &max);
+	void insert(const string_view &name, const string_view &value);
+
+  public:
+	static size_t write_integer(const mutable_buffer &, const uint8_t &prefix, const uint8_t &bits, const uint64_t &value);
+	static size_t write_literal(const mutable_buffer &, const string_view &name, const string_view &value);
+	static size_t write_literal(const mutable_buffer &, const uint8_t &index, const string_view &value);
+	static uint64_t read_integer(const_buffer &, const uint8_t &bits);
+	static string_view read_string(const_buffer &, std::string &);
+
+	bool operator()(const const_buffer &block, const closure &, const size_t &list_max = -1UL);
+};
@@ -19,5 +19,7 @@ namespace ircd::http2
 
 #include "error.h"
 #include "frame.h"
+#include "block.h"
 #include "settings.h"
 #include "stream.h"
+#include "hpack.h"
@@ -34,7 +34,11 @@ __attribute__((packed));
 
 namespace ircd::http2
 {
+	using settings_closure = std::function<void (const frame::settings::code &, const uint32_t &value)>;
+
 	string_view reflect(const frame::settings::code &);
+	bool read_settings(settings &, const frame::header &, const const_buffer &payload, const settings_closure & = {});
+	const_buffer write_settings(const mutable_buffer &, const vector_view<const struct frame::settings::param> &);
 }
 
 enum ircd::http2::frame::settings::code
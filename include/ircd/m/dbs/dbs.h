@@ -57,6 +57,8 @@ namespace ircd::m::dbs::appendix
 #include "room_state_space.h"       // room_id | type, state_key, depth, event_idx
 #include "room_joined.h"            // room_id | origin, member => event_idx
 #include "room_head.h"              // room_id | event_id => event_idx
+#include "room_search.h"            // room_id | term, event_idx => field
+#include "user_room_recency.h"      // user_id | event_idx, room_id
 
 /// Options that affect the dbs::write() of an event to the transaction.
 struct ircd::m::dbs::write_opts
@@ -186,6 +188,9 @@ enum ircd::m::dbs::appendix::index
 
 	/// Take branch to handle room redaction events.
 	ROOM_REDACT,
+
+	/// Involves room_search table (full-text index of content terms).
+	ROOM_SEARCH,
 };
 
 struct ircd::m::dbs::init
@@ -83,6 +83,23 @@ enum class ircd::m::dbs::ref
 	/// The previous states in the transitions for a (type,state_key) cell.
 	PREV_STATE          = 0x04,
 
+	/// Members of a chain in the auth chain cover index, keyed by the first
+	/// event of the chain. Every member has the member before it in its
+	/// `auth_events` so it reaches all members before it; the event_idx
+	/// orders the chain.
+	AUTH_CHAIN          = 0x08,
+
+	/// The first event of the chain in the auth chain cover index which this
+	/// state event is a member of.
+	AUTH_ROOT           = 0x09,
+
+	/// Auth references from a member of a chain (keyed by the first event of
+	/// the chain) to an event on another chain. The value is the event_idx
+	/// of the member making the reference followed by the first event of the
+	/// chain of the referenced event. Only the earliest member of a chain
+	/// referencing an event is recorded.
+	AUTH_LINK           = 0x0A,
+
 	/// All m.receipt's which target this event.
 	M_RECEIPT__M_READ   = 0x10,
 
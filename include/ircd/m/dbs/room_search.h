@@ -0,0 +1,79 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_M_DBS_ROOM_SEARCH_H
+
+namespace ircd::m::dbs::room_search_field
+{
+	enum field :uint8_t;
+}
+
+namespace ircd::m::dbs
+{
+	constexpr size_t ROOM_SEARCH_TERM_MAX_SIZE
+	{
+		48
+	};
+
+	constexpr size_t ROOM_SEARCH_TERMS_MAX
+	{
+		256
+	};
+
+	constexpr size_t ROOM_SEARCH_KEY_MAX_SIZE
+	{
+		id::MAX_SIZE                   // room_id
+		+ 1                            // \0
+		+ ROOM_SEARCH_TERM_MAX_SIZE    // term
+		+ 1                            // \0
+		+ 8                            // u64
+	};
+
+	using room_search_tuple = std::tuple<event::idx>;
+	using room_search_term_closure = std::function<bool (const string_view &)>;
+
+	bool room_search_terms(const string_view &text, const room_search_term_closure &);
+
+	room_search_tuple
+	room_search_key(const string_view &amalgam);
+
+	string_view
+	room_search_key(const mutable_buffer &out,
+	                const id::room &,
+	                const string_view &term,
+	                const event::idx & = -1UL);
+
+	void _index_room_search(db::txn &, const event &, const write_opts &);
+
+	// room_id | term, event_idx => field
+	extern db::domain room_search;
+}
+
+/// Bits stored in the value of a _room_search entry indicating which content
+/// property of the event contained the term.
+enum ircd::m::dbs::room_search_field::field
+:uint8_t
+{
+	BODY    = 0x01,   ///< content.body
+	NAME    = 0x02,   ///< content.name
+	TOPIC   = 0x04,   ///< content.topic
+};
+
+namespace ircd::m::dbs::desc
+{
+	extern conf::item<size_t> room_search__block__size;
+	extern conf::item<size_t> room_search__meta_block__size;
+	extern conf::item<size_t> room_search__cache__size;
+	extern conf::item<size_t> room_search__cache_comp__size;
+	extern const db::prefix_transform room_search__pfx;
+	extern const db::comparator room_search__cmp;
+	extern const db::descriptor room_search;
+}
@@ -0,0 +1,52 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_M_DBS_USER_ROOM_RECENCY_H
+
+namespace ircd::m::dbs
+{
+	constexpr size_t USER_ROOM_RECENCY_KEY_MAX_SIZE
+	{
+		id::MAX_SIZE                   // user_id
+		+ 1                            // \0
+		+ 8                            // u64
+		+ id::MAX_SIZE                 // room_id
+	};
+
+	using user_room_recency_tuple = std::tuple<event::idx, string_view>;
+
+	user_room_recency_tuple
+	user_room_recency_key(const string_view &amalgam);
+
+	string_view
+	user_room_recency_key(const mutable_buffer &out,
+	                      const id::user &,
+	                      const event::idx &,
+	                      const id::room &);
+
+	string_view
+	user_room_recency_key(const mutable_buffer &out,
+	                      const id::user &);
+
+	// user_id | event_idx, room_id
+	extern db::domain user_room_recency;
+}
+
+namespace ircd::m::dbs::desc
+{
+	extern conf::item<size_t> user_room_recency__block__size;
+	extern conf::item<size_t> user_room_recency__meta_block__size;
+	extern conf::item<size_t> user_room_recency__cache__size;
+	extern conf::item<size_t> user_room_recency__cache_comp__size;
+	extern const db::prefix_transform user_room_recency__pfx;
+	extern const db::comparator user_room_recency__cmp;
+	extern const db::descriptor user_room_recency;
+}
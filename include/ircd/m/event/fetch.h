@@ -45,6 +45,7 @@ struct ircd::m::event::fetch
 
 	using keys = event::keys;
 	using view_closure = std::function<void (const string_view &)>;
+	using multi_closure = std::function<void (const size_t &, const event &)>;
 
 	static const opts default_opts;
 
@@ -110,3 +111,8 @@ struct ircd::m::event::fetch::opts
 	opts(const db::gopts &, const event::keys::selection & = {});
 	opts() noexcept;
 };
+
+namespace ircd::m
+{
+	size_t seek(std::nothrow_t, const vector_view<const event::idx> &, const event::fetch::multi_closure &, const event::fetch::opts & = event::fetch::default_opts);
+}
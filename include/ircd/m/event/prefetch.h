@@ -13,6 +13,9 @@
 
 namespace ircd::m
 {
+	size_t prefetch(const vector_view<const event::idx> &, const event::fetch::opts & = event::fetch::default_opts);
+	size_t prefetch(const vector_view<const event::idx> &, const string_view &key);
+
 	bool prefetch(const event::idx &, const event::fetch::opts & = event::fetch::default_opts);
 	bool prefetch(const event::idx &, const string_view &key);
 
@@ -46,6 +46,7 @@ struct ircd::m::event::refs
 
 	refs(const event::idx &idx) noexcept;
 
+	static size_t rebuild_auth_chain();
 	static void rebuild();
 };
 
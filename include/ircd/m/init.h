@@ -23,6 +23,18 @@ namespace ircd::m::init::backfill
 	void init(), fini() noexcept;
 }
 
+/// Internal use only; do not call
+namespace ircd::m::init::recent
+{
+	void init(), fini() noexcept;
+}
+
+/// Internal use only; do not call
+namespace ircd::m::init::search
+{
+	void init(), fini() noexcept;
+}
+
 /// Internal use only; do not call
 struct ircd::m::init::modules
 {
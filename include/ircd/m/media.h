@@ -23,6 +23,8 @@ namespace ircd::m::media::file
 	room::id room_id(room::id::buf &out, const mxc &);
 	room::id::buf room_id(const mxc &);
 
+	std::pair<uint64_t, size_t> seek(const room &, const size_t &offset);
+	size_t read(const room &, const size_t &offset, const size_t &length, const closure &);
 	size_t read(const room &, const closure &);
 	size_t write(const room &, const user::id &, const const_buffer &content, const string_view &content_type);
 
@@ -54,7 +56,7 @@ namespace ircd::m::media::block
 
 	void set(const string_view &hash, const const_buffer &block);
 	string_view set(const mutable_buffer &hashbuf, const const_buffer &block);
-	m::event::id::buf set(const room &, const user::id &, const const_buffer &block);
+	m::event::id::buf set(const room &, const user::id &, const const_buffer &block, const size_t &offset);
 }
 
 struct ircd::m::media::mxc
@@ -30,6 +30,7 @@ struct ircd::m::room::auth
 	static passfail check(const event &, hookdata &);
 	static passfail check(const event &, const vector_view<event::idx> &);
 	static passfail check(const event &, const room &);
+	static passfail check(const event &, const state::resolve &);
 	static passfail check_static(const event &);
 	static passfail check_present(const event &);
 	static passfail check_relative(const event &);
@@ -65,6 +66,9 @@ struct ircd::m::room::auth::refs
 	{}
 };
 
+/// Interface to the auth chain of an event. This is answered by the chain
+/// cover index in event_refs when the event's auth chain is covered by it;
+/// otherwise the auth_events are walked.
 struct ircd::m::room::auth::chain
 {
 	using closure = event::closure_idx_bool;
@@ -76,6 +80,9 @@ struct ircd::m::room::auth::chain
 	bool has(const string_view &type) const;
 	size_t depth() const;
 
+	// Events in the auth chain of some but not all of the events.
+	static bool difference(const vector_view<const event::idx> &, const closure &);
+
 	chain(const event::idx &idx)
 	:idx{idx}
 	{}
@@ -51,6 +51,7 @@ struct ircd::m::room::events
 	struct sounding;
 	struct horizon;
 	struct missing;
+	struct readahead;
 
 	static conf::item<ssize_t> viewport_size;
 
@@ -118,6 +119,38 @@ struct ircd::m::room::events
 	static size_t count(const event::idx_range &);
 };
 
+/// Read-ahead for an iteration of room events. A second iterator is kept up
+/// to `limit` positions ahead of the followed iterator in the same direction
+/// and the event data at each position is prefetched. Once an event is in
+/// cache and within half the lead, the membership state of its sender is
+/// prefetched too. Invoke once each time the followed iterator moves.
+///
+struct ircd::m::room::events::readahead
+{
+	static conf::item<size_t> max;
+
+	events it;
+	const event::fetch::opts *fopts {nullptr};
+	std::deque<event::idx> pending;
+	size_t limit {0};
+	size_t lead {0};
+	size_t staged {0};
+	bool backward {false};
+
+	size_t stage();
+	size_t fill();
+
+  public:
+	size_t operator()();
+
+	readahead(const events &followed,
+	          const size_t &limit,
+	          const bool &backward);
+
+	readahead(const readahead &) = delete;
+	readahead &operator=(const readahead &) = delete;
+};
+
 /// Find missing room events. This is a breadth-first iteration of missing
 /// references from the tophead (or at the event provided in the room arg)
 ///
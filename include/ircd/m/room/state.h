@@ -24,6 +24,7 @@ struct ircd::m::room::state
 	struct opts;
 	struct space;
 	struct history;
+	struct resolve;
 	struct rebuild;
 
 	using closure = std::function<void (const string_view &, const string_view &, const event::idx &)>;
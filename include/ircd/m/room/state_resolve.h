@@ -0,0 +1,54 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2019 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_M_ROOM_STATE_RESOLVE_H
+
+/// Interface to the state of a room resolved across several of its forks.
+/// The heads are the events whose states are merged, usually the prev_events
+/// of a new event; the state after each head is taken from the state-space
+/// bounded by the head's depth.
+///
+/// Cells on which all heads agree are the unconflicted state and are
+/// answered by state::history. The other cells are resolved (v2): the power
+/// events among them and the auth difference are ordered reverse
+/// topologically and authorized iteratively against the partial state, then
+/// the remaining events are applied in mainline order.
+///
+/// The resolution of the conflicted cells is memoized for each set of heads
+/// so later events on the same fork reuse it. The events between the
+/// shallowest and the deepest head are scanned for the cells which may
+/// differ; the scan is limited to the depth_max depths below the deepest.
+///
+/// This is not part of the authorization of an eval; auth::check(event,
+/// resolve) is for callers which want to check an event against it.
+///
+struct ircd::m::room::state::resolve
+{
+	using cells = std::map<std::string, event::idx, std::less<>>;
+
+	static conf::item<size_t> cache_max;
+	static conf::item<size_t> depth_max;
+
+	state::history history;
+	std::vector<event::idx> heads;
+	std::shared_ptr<const cells> resolved;
+
+  public:
+	bool for_each(const closure_bool &) const;
+	size_t count() const;
+
+	bool has(const string_view &type, const string_view &state_key) const;
+
+	event::idx get(std::nothrow_t, const string_view &type, const string_view &state_key) const;
+	event::idx get(const string_view &type, const string_view &state_key) const;
+
+	resolve(const m::room &, const vector_view<const event::idx> &heads);
+};
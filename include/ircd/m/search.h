@@ -14,6 +14,12 @@
 namespace ircd::m::search
 {
 	struct room_events;
+	struct query;
+
+	bool indexed(const room::id &);
+	size_t rebuild(const room::id &);
+
+	extern log::log log;
 }
 
 struct ircd::m::search::room_events
@@ -47,3 +53,41 @@ struct ircd::m::search::room_events
 {
 	using super_type::tuple;
 };
+
+/// Interface to the _room_search full-text index for one room. The terms of
+/// the search_term are normalized by the same tokenizer as the indexer and
+/// every term must be present in an event for it to match. Matches are
+/// iterated by descending event_idx (most recent first) from the upper bound;
+/// the rank given to the closure is the mean number of selected content
+/// fields each term was found in.
+///
+struct ircd::m::search::query
+{
+	using closure = std::function<bool (const event::idx &, const float &rank)>;
+
+	m::room::id room_id;
+	string_view search_term;
+	uint8_t fields {0xff};   // dbs::room_search_field mask
+	event::idx upper {-1UL}; // highest (inclusive)
+
+  public:
+	bool for_each(const closure &) const;
+	size_t count() const;
+	bool empty() const;
+
+	query(const m::room::id &,
+	      const string_view &search_term,
+	      const uint8_t &fields   = 0xff,
+	      const event::idx &upper = -1UL);
+};
+
+inline
+ircd::m::search::query::query(const m::room::id &room_id,
+                              const string_view &search_term,
+                              const uint8_t &fields,
+                              const event::idx &upper)
+:room_id{room_id}
+,search_term{search_term}
+,fields{fields}
+,upper{upper}
+{}
@@ -18,6 +18,7 @@ struct ircd::m::user::rooms
 
 	using closure = std::function<void (const m::room &, const string_view &)>;
 	using closure_bool = std::function<bool (const m::room &, const string_view &)>;
+	using closure_recent = std::function<bool (const m::room::id &, const event::idx &)>;
 
 	m::user user;
 
@@ -33,6 +34,10 @@ struct ircd::m::user::rooms
 	size_t count(const string_view &membership) const;
 	size_t count() const;
 
+	// Joined and invited rooms by descending index of their latest event
+	bool for_each_recent(const closure_recent &) const;
+	size_t rebuild_recent() const;
+
 	rooms(const m::user &user)
 	:user{user}
 	{}
@@ -44,6 +44,8 @@ namespace ircd::m::vm::sequence
 	extern uint64_t retired;      // already written; always monotonic
 	extern uint64_t committed;    // pending write; usually monotonic
 	extern uint64_t uncommitted;  // evaluating; not monotonic
+	extern conf::item<bool> pipeline;
+	extern bool pipelined;        // pipeline latched while evals are in flight
 	static size_t pending;
 
 	const uint64_t &get(const eval &);
@@ -81,6 +83,9 @@ struct ircd::m::vm::eval
 	std::shared_ptr<db::txn> txn;
 
 	vector_view<m::event> pdus;
+	std::vector<bool> pdus_verified; // parallel to pdus; set by mverify()
+	std::vector<bool> pdus_reported; // parallel to pdus; set by mverify()
+	std::vector<event::conforms> pdus_report; // valid where pdus_reported
 	const json::iov *issue {nullptr};
 	const event *event_ {nullptr};
 	string_view room_id;
@@ -95,6 +100,9 @@ struct ircd::m::vm::eval
 	static const event *find_pdu(const event::id &);
 
 	void mfetch_keys() const;
+	void mverify();
+	bool verified(const event &) const;
+	const event::conforms *reported(const event &) const;
 
   public:
 	operator const event::id::buf &() const;
@@ -124,6 +132,7 @@ struct ircd::m::vm::eval
 	static eval &get(const event::id &);
 	static bool sequnique(const uint64_t &seq);
 	static eval *seqnext(const uint64_t &seq);
+	static eval *seqnext(const uint64_t &seq, const string_view &room_id);
 	static eval *seqmax();
 	static eval *seqmin();
 	static void seqsort();
@@ -67,6 +67,9 @@ namespace ircd::net
 	const_buffer peer_cert_der(const mutable_buffer &, const socket &);
 	const_buffer peer_cert_der_sha256(const mutable_buffer &, const socket &);
 	string_view peer_cert_der_sha256_b64(const mutable_buffer &, const socket &);
+
+	// Protocol selected by ALPN in the handshake; empty if none.
+	string_view alpn(const socket &);
 }
 
 // Exports to ircd::
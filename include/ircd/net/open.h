@@ -113,6 +113,10 @@ struct ircd::net::open_opts
 
 	/// Option to allow expired certificates.
 	bool allow_expired { default_allow_expired };
+
+	/// Protocols offered by ALPN in the ClientHello in order of preference;
+	/// none are offered if empty. The selection is found by net::alpn().
+	vector_view<const string_view> alpn;
 };
 
 /// Constructor intended to provide implicit conversions (no-brackets required)
@@ -21,6 +21,7 @@ namespace ircd::net
 	extern conf::item<std::string> ssl_curve_list;
 	extern conf::item<std::string> ssl_cipher_list;
 	extern conf::item<std::string> ssl_cipher_blacklist;
+	extern conf::item<size_t> ssl_session_cache_max;
 	extern asio::ssl::context sslv23_client;
 }
 
@@ -52,6 +53,10 @@ struct ircd::net::socket
 	static stats::item total_bytes_out;
 	static stats::item total_calls_in;
 	static stats::item total_calls_out;
+	static stats::item total_ssl_resumed_in;
+	static stats::item total_ssl_resumed_out;
+	static stats::item total_ssl_full_in;
+	static stats::item total_ssl_full_out;
 
 	uint64_t id {++count};
 	ip::tcp::socket sd;
@@ -62,12 +67,14 @@ struct ircd::net::socket
 	bool timer_set {false};                      // boolean lockout
 	bool timedout {false};
 	bool fini {false};
+	std::string ssl_session_key;                 // outbound session cache key
 
 	void call_user(const eptr_handler &, const error_code &) noexcept;
 	void call_user(const ec_handler &, const error_code &) noexcept;
 	bool handle_verify(bool, asio::ssl::verify_context &, const open_opts &) noexcept;
+	bool handle_verify_resumed(const open_opts &) noexcept;
 	void handle_disconnect(std::shared_ptr<socket>, eptr_handler, error_code) noexcept;
-	void handle_handshake(std::weak_ptr<socket>, eptr_handler, error_code) noexcept;
+	void handle_handshake(std::weak_ptr<socket>, eptr_handler, const open_opts &, error_code) noexcept;
 	void handle_connect(std::weak_ptr<socket>, const open_opts &, eptr_handler, error_code) noexcept;
 	void handle_timeout(std::weak_ptr<socket>, ec_handler, error_code) noexcept;
 	void handle_ready(std::weak_ptr<socket>, ready, ec_handler, error_code) noexcept;
@@ -70,4 +70,5 @@ struct ircd::resource::method::stats
 	uint64_t timeouts {0};            // The method's timeout was exceeded.
 	uint64_t completions {0};         // The handler returned without throwing.
 	uint64_t internal_errors {0};     // The handler threw a very bad exception.
+	ircd::stats::histogram latency;   // Microseconds spent inside the method.
 };
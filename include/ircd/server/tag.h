@@ -38,7 +38,9 @@ struct ircd::server::tag
 		size_t content_length {0};     // fixed; or grows monotonic for chunked enc
 		size_t chunk_read {0};         // content read after last chunk head
 		size_t chunk_length {0};       // -1 for chunk header mode
+		uint32_t stream_id {0};        // HTTP/2 stream on the link
 		http::code status {(http::code)0};
+		steady_point sent;             // first byte transmitted to remote
 	}
 	state;
 	ctx::promise<http::code> p;
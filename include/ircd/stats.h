@@ -14,12 +14,14 @@
 namespace ircd::stats
 {
 	struct item;
+	struct histogram;
 	using value_type = int128_t;
 
 	IRCD_EXCEPTION(ircd::error, error)
 	IRCD_EXCEPTION(error, not_found)
 
 	extern std::map<string_view, item *> items;
+	extern std::map<string_view, histogram *> histograms;
 
 	const value_type &get(const item &);
 	value_type &get(item &);
@@ -29,6 +31,7 @@ namespace ircd::stats
 	value_type &set(item &, const value_type & = 0);
 
 	std::ostream &operator<<(std::ostream &, const item &);
+	std::ostream &operator<<(std::ostream &, const histogram &);
 }
 
 struct ircd::stats::item
@@ -57,6 +60,124 @@ struct ircd::stats::item
 	~item() noexcept;
 };
 
+/// Log-linear histogram of unsigned samples; latencies are recorded in
+/// microseconds. Each power of two is divided into 2^SUB_BITS linear buckets
+/// so a percentile is reported within 1/2^SUB_BITS of its true value.
+///
+/// Recording is a relaxed atomic increment so samples may come from any
+/// thread without a lock; readers see a snapshot which may be momentarily
+/// inconsistent between buckets. A histogram constructed without a name is
+/// not registered in stats::histograms and is reached by its owner.
+struct ircd::stats::histogram
+{
+	struct scope;
+
+	static constexpr const size_t SUB_BITS {3};
+	static constexpr const size_t BUCKETS {(64 - SUB_BITS + 1) << SUB_BITS};
+
+	json::strung feature_;
+	json::object feature;
+	string_view name;
+	std::atomic<uint64_t> total {0};
+	std::atomic<uint64_t> sum {0};
+	std::atomic<uint64_t> max {0};
+	std::array<std::atomic<uint64_t>, BUCKETS> bucket {};
+
+  public:
+	static size_t index(const uint64_t &) noexcept;
+	static uint64_t lower(const size_t &) noexcept;
+	static uint64_t upper(const size_t &) noexcept;
+
+	uint64_t count() const noexcept;
+	uint64_t mean() const noexcept;
+	uint64_t percentile(const long double &) const noexcept;
+
+	void operator()(const uint64_t &) noexcept;
+	void operator()(const microseconds &) noexcept;
+	void clear() noexcept;
+
+	histogram(const json::members &);
+	histogram() = default;
+	histogram(histogram &&) = delete;
+	histogram(const histogram &) = delete;
+	~histogram() noexcept;
+};
+
+/// Records the microseconds elapsed over the scope's lifetime.
+struct ircd::stats::histogram::scope
+{
+	histogram *h;
+	steady_point start;
+
+  public:
+	scope(histogram &);
+	scope(scope &&) = delete;
+	scope(const scope &) = delete;
+	~scope() noexcept;
+};
+
+inline
+ircd::stats::histogram::scope::scope(histogram &h)
+:h{&h}
+,start{now<steady_point>()}
+{
+}
+
+inline
+ircd::stats::histogram::scope::~scope()
+noexcept
+{
+	(*h)(duration_cast<microseconds>(now<steady_point>() - start));
+}
+
+inline void
+ircd::stats::histogram::operator()(const microseconds &us)
+noexcept
+{
+	operator()(uint64_t(std::max(us.count(), 0L)));
+}
+
+inline void
+ircd::stats::histogram::operator()(const uint64_t &val)
+noexcept
+{
+	bucket[index(val)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(val, std::memory_order_relaxed);
+
+	auto cur(max.load(std::memory_order_relaxed));
+	while(val > cur && !max.compare_exchange_weak(cur, val, std::memory_order_relaxed));
+}
+
+inline uint64_t
+ircd::stats::histogram::count()
+const noexcept
+{
+	return total.load(std::memory_order_relaxed);
+}
+
+/// Values below 2^SUB_BITS have a bucket each; above that the bucket is the
+/// position of the most significant bit followed by the next SUB_BITS bits.
+inline size_t
+ircd::stats::histogram::index(const uint64_t &val)
+noexcept
+{
+	if(val < (1UL << SUB_BITS))
+		return val;
+
+	const size_t msb
+	{
+		63UL - __builtin_clzl(val)
+	};
+
+	const size_t sub
+	{
+		(val >> (msb - SUB_BITS)) & ((1UL << SUB_BITS) - 1)
+	};
+
+	return ((msb - SUB_BITS + 1) << SUB_BITS) | sub;
+}
+
 inline ircd::stats::item &
 ircd::stats::item::operator--()
 {
@@ -118,6 +118,95 @@ decltype(ircd::util::instance_multimap<ircd::net::ipport, ircd::client, ircd::ne
 ircd::util::instance_multimap<ircd::net::ipport, ircd::client, ircd::net::ipport::cmp_ip>::map
 {};
 
+/// HTTP/2 connection (RFC 7540) of a client which selected "h2" by ALPN.
+///
+/// The client of the connection reads and handles frames on a request
+/// context when the socket is readable, the same way an HTTP/1 client reads
+/// its requests, and returns to async mode when there is no more to read.
+/// When a request on a stream is complete it is given to a client of its
+/// own sharing the socket, which is dispatched to the request pool. The
+/// resource handlers write their responses to the stream client as they do
+/// for HTTP/1; the HTTP/1 response is converted to frames for the stream as
+/// it is written.
+struct ircd::client::h2
+{
+	struct stream;
+
+	static ircd::conf::item<size_t> max_streams;
+	static ircd::conf::item<size_t> window_size;
+	static ircd::conf::item<size_t> content_max;
+	static ircd::conf::item<size_t> blocked_max;
+
+	std::shared_ptr<socket> sock;
+	http2::settings remote;                  // Settings of the peer
+	http2::hpack hpack;                      // Peer's header compression state
+	std::map<uint32_t, stream> streams;
+	unique_buffer<mutable_buffer> buf;       // Frames read off the socket
+	size_t buffered {0};                     // Bytes of buf awaiting handling
+	http2::block block;                      // Header block being received
+	uint32_t last_stream {0};                // Highest stream opened by the peer
+	int64_t send_window {65535};             // Connection flow control window
+	int64_t recv_window {65535};
+	size_t blocked {0};                      // Streams waiting on flow control
+	ctx::mutex mutex;                        // Serializes use of the TLS session
+	ctx::dock dock;                          // Notified on window updates
+	bool preface {false};                    // Received the connection preface
+	bool started {false};                    // Sent our settings
+	bool goaway {false};                     // Peer is going away
+
+	static uint32_t window();
+	uint32_t &setting(const http2::settings::code &);
+
+	// output
+	size_t write(const const_buffer &);
+	size_t write(const http2::frame::header &, const const_buffer &payload = {});
+	void write_window(const uint32_t &stream_id, const size_t &increment);
+	void write_settings(client &);
+	void write_data(client &, stream &, const_buffer, const bool &end);
+	void write_head(client &, stream &, const string_view &head);
+
+	// stream
+	void reset(const uint32_t &stream_id, const enum http2::error::code &);
+	void dispatch(client &, const uint32_t &stream_id);
+
+	// input
+	size_t read(const mutable_buffer &);
+	void handle_window(const http2::frame::header &, const const_buffer &);
+	void handle_settings(const http2::frame::header &, const const_buffer &);
+	void handle_data(client &, const http2::frame::header &, const_buffer);
+	void handle_headers(client &, const uint32_t &stream_id, const uint8_t &flags);
+	void handle(client &, const http2::frame::header &, const const_buffer &);
+
+  public:
+	size_t write(client &, const const_buffer &);
+	void finish(client &, const bool &ok) noexcept;
+	void close(client &);
+	bool main(client &);
+
+	h2(std::shared_ptr<socket>);
+};
+
+/// The request received on a stream and the state of its response.
+struct ircd::client::h2::stream
+{
+	enum http2::stream::state state {http2::stream::state::OPEN};
+	std::string head;                        // Request head as HTTP/1.1
+	std::string content;                     // Request content
+	int64_t send_window {0};
+	int64_t recv_window {0};
+	bool dispatched {false};                 // Handed to a stream client
+	bool reset {false};                      // RST_STREAM sent or received
+	bool cancel {false};                     // RST_STREAM to be sent by handler
+
+	// Conversion of the HTTP/1.1 response written by the handler.
+	std::string response;                    // Head until complete
+	bool headed {false};                     // HEADERS sent
+	bool ended {false};                      // END_STREAM sent
+	bool chunked {false};                    // Content has chunked encoding
+	size_t remain {0};                       // Content (or chunk) remaining
+	std::string chunk;                       // Chunk size line being received
+};
+
 //
 // init
 //
@@ -267,13 +356,27 @@ ircd::client::create(net::listener &,
 		std::make_shared<ircd::client>(sock)
 	};
 
+	if(net::alpn(*sock) == "h2")
+		client->h2 = std::make_shared<struct h2>(sock);
+
 	client->async();
 }
 
+/// Streams of HTTP/2 connections are not counted; they are limited by
+/// the connection.
 size_t
 ircd::client::count(const net::ipport &remote)
 {
-	return client::map.count(remote);
+	const auto range
+	{
+		client::map.equal_range(remote)
+	};
+
+	return std::count_if(range.first, range.second, []
+	(const auto &pair)
+	{
+		return !pair.second->stream_id;
+	});
 }
 
 ircd::parse::read_closure
@@ -331,6 +434,7 @@ namespace ircd
 	static bool handle_ec_eof(client &);
 	static bool handle_ec(client &, const error_code &);
 
+	static void handle_client_stream(std::shared_ptr<client>);
 	static void handle_client_request(std::shared_ptr<client>);
 	static void handle_client_ready(std::shared_ptr<client>, const error_code &ec);
 }
@@ -394,6 +498,22 @@ ircd::handle_client_ready(std::shared_ptr<client> client,
 	if(!handle_ec(*client, ec))
 		return;
 
+	// The frames of an HTTP/2 connection are read on a context of its own
+	// rather than the pool. Its streams run on the pool and may be waiting
+	// for the flow control frames read here.
+	if(client->h2 && !client->stream_id)
+	{
+		ctx::context
+		{
+			"client.h2",
+			size_t(client::settings.stack_size),
+			std::bind(ircd::handle_client_request, std::move(client)),
+			ctx::context::POST | ctx::context::DETACH,
+		};
+
+		return;
+	}
+
 	auto handler
 	{
 		std::bind(ircd::handle_client_request, std::move(client))
@@ -471,6 +591,40 @@ catch(const std::exception &e)
 	};
 }
 
+/// A request context has been dispatched for the request received on an
+/// HTTP/2 stream. Unlike the connection, the stream client does not return
+/// to async mode; it's finished after the one request.
+void
+ircd::handle_client_stream(std::shared_ptr<client> client)
+{
+	assert(ctx::current);
+	assert(client->h2 && client->stream_id);
+	client->reqctx = ctx::current;
+	client->ready_count++;
+	const unwind reset{[&client]
+	{
+		client->reqctx = nullptr;
+		if(client::pool.avail() <= 1)
+			client::dock.notify_all();
+	}};
+
+	bool ok {false}; try
+	{
+		ok = client->main();
+	}
+	catch(const std::exception &e)
+	{
+		log::error
+		{
+			client::log, "%s fault :%s",
+			client->loghead(),
+			e.what()
+		};
+	}
+
+	client->h2->finish(*client, ok);
+}
+
 bool
 ircd::handle_ec(client &client,
                 const error_code &ec)
@@ -643,6 +797,45 @@ ircd::client::client(std::shared_ptr<socket> sock)
 	assert(size(head_buffer) >= 8_KiB);
 }
 
+/// Client for one request on an HTTP/2 connection; the head (translated to
+/// HTTP/1.1) and the content of the request are already received.
+ircd::client::client(std::shared_ptr<struct h2> h2,
+                     const uint32_t &stream_id,
+                     const string_view &head,
+                     const string_view &content)
+:instance_multimap{[&h2]
+() -> net::ipport
+{
+	assert(bool(h2) && bool(h2->sock));
+	const auto &ep(h2->sock->remote());
+	return { ep.address(), ep.port() };
+}()}
+,head_buffer
+{
+	size(head) + size(content)
+}
+,sock
+{
+	h2->sock
+}
+,local
+{
+	net::local_ipport(*this->sock)
+}
+,h2
+{
+	std::move(h2)
+}
+,stream_id
+{
+	stream_id
+}
+{
+	mutable_buffer buf{head_buffer};
+	consume(buf, copy(buf, head));
+	consume(buf, copy(buf, content));
+}
+
 ircd::client::~client()
 noexcept try
 {
@@ -687,8 +880,20 @@ bool
 ircd::client::main()
 try
 {
+	if(h2 && !stream_id)
+		return h2->main(*this);
+
+	// The request on a stream is already entirely in the buffer.
 	parse::buffer pb{head_buffer};
-	parse::capstan pc{pb, read_closure(*this)}; do
+	if(stream_id)
+		pb.read = pb.stop;
+
+	parse::capstan pc
+	{
+		pb, !stream_id? read_closure(*this) : parse::read_closure{}
+	};
+
+	do
 	{
 		if(!handle_request(pc))
 			return false;
@@ -755,10 +960,14 @@ try
 
 	// This timeout covers the reception of a complete HTTP head. If the
 	// head was fragmented and has not entirely arrived yet this function
-	// will block this request context below. The timeout limits that.
+	// will block this request context below. The timeout limits that. The
+	// socket of a stream is shared by the connection, which has received
+	// the request already.
 	net::scope_timeout timeout
 	{
-		*sock, conf->request_timeout
+		!stream_id?
+			net::scope_timeout{*sock, conf->request_timeout}:
+			net::scope_timeout{}
 	};
 
 	// This is the first read off the wire. The headers are entirely read and
@@ -995,6 +1204,13 @@ ircd::client::discard_unconsumed(const http::request::head &head)
 ircd::ctx::future<void>
 ircd::client::close(const net::close_opts &opts)
 {
+	// Closing a stream resets the stream rather than the connection.
+	if(stream_id)
+	{
+		h2->close(*this);
+		return ctx::already;
+	}
+
 	return likely(sock) && !sock->fini?
 		net::close(*sock, opts):
 		ctx::already;
@@ -1010,6 +1226,12 @@ ircd::client::close(const net::close_opts &opts,
 	if(sock->fini)
 		return callback({});
 
+	if(stream_id)
+	{
+		h2->close(*this);
+		return callback({});
+	}
+
 	net::close(*sock, opts, std::move(callback));
 }
 
@@ -1028,6 +1250,9 @@ ircd::client::write_all(const const_buffer &buf)
 			make_error_code(std::errc::not_connected)
 		};
 
+	if(stream_id)
+		return h2->write(*this, buf);
+
 	return net::write_all(*sock, buf);
 }
 
@@ -1054,3 +1279,928 @@ const
 		request_count
 	};
 }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// client::h2
+//
+
+decltype(ircd::client::h2::max_streams)
+ircd::client::h2::max_streams
+{
+	{ "name",     "ircd.client.http2.max_streams" },
+	{ "default",  32L                             },
+};
+
+decltype(ircd::client::h2::window_size)
+ircd::client::h2::window_size
+{
+	{ "name",     "ircd.client.http2.window_size" },
+	{ "default",  long(1_MiB)                     },
+};
+
+decltype(ircd::client::h2::content_max)
+ircd::client::h2::content_max
+{
+	{ "name",     "ircd.client.http2.content_max" },
+	{ "default",  long(64_MiB)                    },
+};
+
+/// Streams beyond this waiting for the peer to open its window are
+/// canceled; each one holds a request context while it waits.
+decltype(ircd::client::h2::blocked_max)
+ircd::client::h2::blocked_max
+{
+	{ "name",     "ircd.client.http2.blocked_max" },
+	{ "default",  4L                              },
+};
+
+ircd::client::h2::h2(std::shared_ptr<socket> sock)
+:sock
+{
+	std::move(sock)
+}
+,buf
+{
+	http2::frame::SIZE + 64_KiB
+}
+{
+}
+
+/// Read and handle the frames available on the socket. Returns false to
+/// close the connection.
+bool
+ircd::client::h2::main(client &client)
+try
+{
+	if(!started)
+		write_settings(client);
+
+	while(1)
+	{
+		const mutable_buffer space
+		{
+			data(buf) + buffered, size(buf) - buffered
+		};
+
+		const size_t got
+		{
+			read(space)
+		};
+
+		buffered += got;
+		const_buffer in
+		{
+			data(buf), buffered
+		};
+
+		if(!preface && size(in) >= size(http2::connection_preface))
+		{
+			if(string_view(data(in), size(http2::connection_preface)) != http2::connection_preface)
+				throw http2::error
+				{
+					http2::error::PROTOCOL_ERROR, "Invalid connection preface."
+				};
+
+			consume(in, size(http2::connection_preface));
+			preface = true;
+		}
+
+		if(preface)
+			http2::read_frames(in, [this, &client]
+			(const http2::frame::header &header, const const_buffer &payload)
+			{
+				handle(client, header, payload);
+			});
+
+		// Move the partial frame to the front for the next read.
+		buffered = size(in);
+		memmove(data(buf), data(in), buffered);
+		if(got < size(space))
+			break;
+	}
+
+	return true;
+}
+catch(const http2::error &e)
+{
+	log::derror
+	{
+		log, "%s HTTP/2 :%s",
+		client.loghead(),
+		e.what(),
+	};
+
+	char buf[8];
+	const const_buffer payload
+	{
+		http2::write_goaway(buf, last_stream, e.code)
+	};
+
+	write({uint32_t(size(payload)), http2::frame::GOAWAY, 0, 0}, payload);
+	return false;
+}
+
+size_t
+ircd::client::h2::read(const mutable_buffer &buf)
+{
+	const std::lock_guard lock
+	{
+		mutex
+	};
+
+	return net::read_any(*sock, buf);
+}
+
+void
+ircd::client::h2::handle(client &client,
+                         const http2::frame::header &header,
+                         const const_buffer &payload)
+{
+	using http2::frame;
+	using http2::error;
+
+	block.expect(header);
+	switch(header.type)
+	{
+		case frame::DATA:
+			return handle_data(client, header, payload);
+
+		case frame::HEADERS:
+		case frame::CONTINUATION:
+			if(block(header, payload, client.conf->header_max_size * 2))
+				handle_headers(client, header.stream_id, block.flags);
+
+			return;
+
+		case frame::RST_STREAM:
+		{
+			http2::read_reset(header, payload);
+			const auto it(streams.find(header.stream_id));
+			if(it == end(streams))
+				return;
+
+			auto &stream(it->second);
+			stream.reset = true;
+			stream.state = http2::stream::state::CLOSED;
+			if(!stream.dispatched)
+				streams.erase(it);
+
+			dock.notify_all();
+			return;
+		}
+
+		case frame::SETTINGS:
+			return handle_settings(header, payload);
+
+		case frame::PING:
+		{
+			if(unlikely(size(payload) != 8 || header.stream_id))
+				throw error
+				{
+					error::PROTOCOL_ERROR, "Invalid PING."
+				};
+
+			if(~header.flags & frame::ACK)
+				write({8, frame::PING, frame::ACK, 0}, payload);
+
+			return;
+		}
+
+		case frame::GOAWAY:
+			http2::read_goaway(header, payload);
+			goaway = true;
+			return;
+
+		case frame::WINDOW_UPDATE:
+			return handle_window(header, payload);
+
+		case frame::PUSH_PROMISE:
+			throw error
+			{
+				error::PROTOCOL_ERROR, "PUSH_PROMISE from client."
+			};
+
+		case frame::PRIORITY:
+		default:
+			return;
+	}
+}
+
+void
+ircd::client::h2::handle_headers(client &client,
+                                 const uint32_t &stream_id,
+                                 const uint8_t &flags)
+{
+	using http2::frame;
+	using http2::error;
+
+	const bool end_stream
+	{
+		bool(flags & frame::END_STREAM)
+	};
+
+	// Trailers of a request; the block is decoded for the state of the
+	// table, then ignored.
+	const auto it(streams.find(stream_id));
+	if(it != end(streams) || stream_id <= last_stream)
+	{
+		hpack(const_buffer{block.buf}, [](const auto &, const auto &) {}, client.conf->header_max_size);
+		if(it != end(streams) && end_stream && it->second.state == http2::stream::state::OPEN)
+			dispatch(client, stream_id);
+
+		return;
+	}
+
+	if(unlikely(stream_id % 2 == 0))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "Client opened even stream %u.", stream_id
+		};
+
+
+	last_stream = stream_id;
+
+	// The fields are copied into an HTTP/1.1 head, so anything which could
+	// break out of its place there makes the request malformed (8.1.2.6).
+	bool malformed(false), regular(false), scheme(false);
+	std::string method, path, authority, headers;
+	const bool within_max
+	{
+		hpack(const_buffer{block.buf}, [&malformed, &regular, &scheme, &method, &path, &authority, &headers]
+		(const string_view &name, const string_view &value)
+		{
+			if(malformed)
+				return;
+
+			if(!http2::valid_field_name(name) || !http2::valid_field_value(value))
+			{
+				malformed = true;
+				return;
+			}
+
+			// Pseudo-headers come first, each once, and only those defined
+			// for requests (8.1.2.1, 8.1.2.3).
+			if(startswith(name, ':'))
+			{
+				std::string *const pseudo
+				{
+					name == ":method"? &method:
+					name == ":path"? &path:
+					name == ":authority"? &authority:
+					nullptr
+				};
+
+				const bool dup
+				{
+					pseudo? !empty(*pseudo) : name == ":scheme" && scheme
+				};
+
+				malformed |= regular || dup || (!pseudo && name != ":scheme");
+				malformed |= pseudo && (empty(value) || has(value, ' '));
+				scheme |= name == ":scheme";
+				if(pseudo && !malformed)
+					*pseudo = value;
+
+				return;
+			}
+
+			regular = true;
+
+			// The length is given again when the content is known; the others
+			// are not meaningful in HTTP/2.
+			if(name == "content-length" || name == "connection" || name == "te")
+				return;
+
+			headers.append(name);
+			headers.append(": ");
+			headers.append(value);
+			headers.append("\r\n");
+		}, client.conf->header_max_size)
+	};
+
+	block.buf.clear();
+	if(unlikely(!within_max))
+		return reset(stream_id, error::ENHANCE_YOUR_CALM);
+
+	if(unlikely(malformed || empty(method) || empty(path)))
+		return reset(stream_id, error::PROTOCOL_ERROR);
+
+	if(streams.size() >= size_t(max_streams) || goaway)
+		return reset(stream_id, error::REFUSED_STREAM);
+
+	auto &stream
+	{
+		streams[stream_id]
+	};
+
+	stream.send_window = setting(http2::settings::code::INITIAL_WINDOW_SIZE);
+	stream.recv_window = window();
+	stream.head.reserve(size(method) + size(path) + size(authority) + size(headers) + 64);
+	stream.head.append(method);
+	stream.head.append(" ");
+	stream.head.append(path);
+	stream.head.append(" HTTP/1.1\r\n");
+	if(!empty(authority))
+	{
+		stream.head.append("Host: ");
+		stream.head.append(authority);
+		stream.head.append("\r\n");
+	}
+
+	stream.head.append(headers);
+	if(end_stream)
+		dispatch(client, stream_id);
+}
+
+void
+ircd::client::h2::handle_data(client &client,
+                              const http2::frame::header &header,
+                              const_buffer payload)
+{
+	using http2::frame;
+	using http2::error;
+
+	payload = http2::read_data(header, payload);
+
+	// The whole frame counts against flow control including the padding.
+	if(unlikely(header.len > recv_window))
+		throw error
+		{
+			error::FLOW_CONTROL_ERROR, "DATA of %u bytes exceeds the window.",
+			uint(header.len),
+		};
+
+	// The window is replenished as soon as the data is taken; the content
+	// is limited by content_max instead.
+	recv_window -= header.len;
+	const auto it(streams.find(header.stream_id));
+	if(it == end(streams) || it->second.state != http2::stream::state::OPEN)
+	{
+		if(unlikely(header.stream_id > last_stream))
+			throw error
+			{
+				error::PROTOCOL_ERROR, "DATA on idle stream %u.", header.stream_id
+			};
+
+		write_window(0, header.len);
+		return;
+	}
+
+	auto &stream(it->second);
+	const uint32_t stream_id(header.stream_id);
+	write_window(0, header.len);
+	if(unlikely(header.len > stream.recv_window))
+		return reset(stream_id, error::FLOW_CONTROL_ERROR);
+
+	stream.recv_window -= header.len;
+
+	if(unlikely(stream.content.size() + size(payload) > size_t(content_max)))
+		return reset(stream_id, error::CANCEL);
+
+	stream.content.append(data(payload), size(payload));
+	if(header.flags & frame::END_STREAM)
+		return dispatch(client, stream_id);
+
+	if(header.len)
+		write_window(stream_id, header.len);
+}
+
+void
+ircd::client::h2::handle_settings(const http2::frame::header &header,
+                                  const const_buffer &payload)
+{
+	using http2::frame;
+	using code = http2::settings::code;
+
+	// The difference of the initial window applies to all open streams.
+	const bool ack
+	{
+		!http2::read_settings(remote, header, payload, [this]
+		(const code &id, const uint32_t &value)
+		{
+			if(id != code::INITIAL_WINDOW_SIZE)
+				return;
+
+			const int64_t delta
+			{
+				int64_t(value) - int64_t(setting(code::INITIAL_WINDOW_SIZE))
+			};
+
+			for(auto &[id, stream] : streams)
+				stream.send_window += delta;
+		})
+	};
+
+	if(ack)
+		return;
+
+	write({0, frame::SETTINGS, frame::ACK, 0});
+	dock.notify_all();
+}
+
+void
+ircd::client::h2::handle_window(const http2::frame::header &header,
+                                const const_buffer &payload)
+{
+	using http2::error;
+
+	const uint32_t increment
+	{
+		http2::read_window(header, payload)
+	};
+
+	if(!header.stream_id)
+	{
+		if(unlikely(!increment))
+			throw error
+			{
+				error::PROTOCOL_ERROR, "WINDOW_UPDATE of zero."
+			};
+
+		send_window += increment;
+		if(unlikely(send_window > 0x7fffffffL))
+			throw error
+			{
+				error::FLOW_CONTROL_ERROR, "Connection window overflow."
+			};
+
+		dock.notify_all();
+		return;
+	}
+
+	const auto it(streams.find(header.stream_id));
+	if(it == end(streams))
+		return;
+
+	auto &stream(it->second);
+	stream.send_window += increment;
+	if(unlikely(!increment))
+		return reset(header.stream_id, error::PROTOCOL_ERROR);
+
+	if(unlikely(stream.send_window > 0x7fffffffL))
+		return reset(header.stream_id, error::FLOW_CONTROL_ERROR);
+
+	dock.notify_all();
+}
+
+/// Hand the complete request on the stream to a client of its own which is
+/// run on the request pool.
+void
+ircd::client::h2::dispatch(client &client,
+                           const uint32_t &stream_id)
+{
+	auto &stream
+	{
+		streams.at(stream_id)
+	};
+
+	stream.state = http2::stream::state::HALF_CLOSED_REMOTE;
+	stream.dispatched = true;
+	stream.head.append("Content-Length: ");
+	stream.head.append(lex_cast(stream.content.size()));
+	stream.head.append("\r\n\r\n");
+
+	auto handler
+	{
+		std::bind(ircd::handle_client_stream, std::make_shared<ircd::client>
+		(
+			client.h2, stream_id, stream.head, stream.content
+		))
+	};
+
+	stream.head = std::string{};
+	stream.content = std::string{};
+	ircd::client::pool(std::move(handler));
+}
+
+/// The handler of the stream returned. The stream is forgotten; if the
+/// response was not completed the peer is told so.
+void
+ircd::client::h2::finish(client &client,
+                         const bool &ok)
+noexcept try
+{
+	const auto it(streams.find(client.stream_id));
+	if(it == end(streams))
+		return;
+
+	auto &stream(it->second);
+	if(!stream.ended && (!stream.reset || stream.cancel) && !sock->fini)
+	{
+		if(stream.cancel)
+			reset(client.stream_id, http2::error::CANCEL);
+		else if(ok && stream.headed && !stream.chunked)
+			write_data(client, stream, {}, true);
+		else
+			reset(client.stream_id, http2::error::INTERNAL_ERROR);
+	}
+
+	// Only the handler erases a dispatched stream, so it is still there
+	// after the writes above.
+	streams.erase(client.stream_id);
+	dock.notify_all();
+}
+catch(const std::exception &e)
+{
+	streams.erase(client.stream_id);
+	dock.notify_all();
+	log::derror
+	{
+		log, "%s HTTP/2 stream %u :%s",
+		client.loghead(),
+		client.stream_id,
+		e.what(),
+	};
+}
+
+/// Closing the client of a stream cancels the stream. This may be called
+/// off a request context so nothing is written here; the handler sees the
+/// reset on its next write and the RST_STREAM is sent when it finishes.
+void
+ircd::client::h2::close(client &client)
+{
+	const auto it(streams.find(client.stream_id));
+	if(it == end(streams) || it->second.ended || it->second.reset)
+		return;
+
+	it->second.reset = true;
+	it->second.cancel = true;
+	dock.notify_all();
+}
+
+void
+ircd::client::h2::reset(const uint32_t &stream_id,
+                        const enum http2::error::code &code)
+{
+	const auto it(streams.find(stream_id));
+	if(it != end(streams))
+	{
+		auto &stream(it->second);
+		stream.reset = true;
+		stream.state = http2::stream::state::CLOSED;
+		if(!stream.dispatched)
+			streams.erase(it);
+	}
+
+	char buf[4];
+	dock.notify_all();
+	write({4, http2::frame::RST_STREAM, 0, stream_id}, http2::write_reset(buf, code));
+}
+
+/// Convert the HTTP/1.1 response written by the handler of a stream into
+/// frames. The head is collected until it is complete; the content is sent
+/// in DATA frames, decoding any chunked encoding.
+size_t
+ircd::client::h2::write(client &client,
+                        const const_buffer &buf)
+{
+	const auto it(streams.find(client.stream_id));
+	if(unlikely(it == end(streams) || it->second.reset))
+		throw std::system_error
+		{
+			make_error_code(std::errc::connection_reset)
+		};
+
+	auto &stream(it->second);
+	const_buffer in{buf};
+	if(!stream.headed)
+	{
+		const size_t have(stream.response.size());
+		stream.response.append(data(in), size(in));
+		const auto pos
+		{
+			stream.response.find(http::headers::terminator)
+		};
+
+		if(pos == std::string::npos)
+		{
+			if(unlikely(stream.response.size() > 64_KiB))
+				throw http2::error
+				{
+					"Response head exceeds 64 KiB."
+				};
+
+			return size(buf);
+		}
+
+		const size_t head_length(pos + size(http::headers::terminator));
+		consume(in, head_length - have);
+		stream.response.resize(head_length);
+		write_head(client, stream, stream.response);
+		stream.response = std::string{};
+	}
+
+	while(!empty(in) && !stream.ended)
+	{
+		if(!stream.chunked)
+		{
+			const size_t len(std::min(size(in), stream.remain));
+			stream.remain -= len;
+			write_data(client, stream, {data(in), len}, !stream.remain);
+			consume(in, len);
+			continue;
+		}
+
+		// Within a chunk; remain includes the CRLF after the data which is
+		// discarded.
+		if(stream.remain)
+		{
+			const size_t len(std::min(size(in), stream.remain));
+			const size_t content
+			{
+				std::min(len, stream.remain > 2? stream.remain - 2 : 0UL)
+			};
+
+			if(content)
+				write_data(client, stream, {data(in), content}, false);
+
+			stream.remain -= len;
+			consume(in, len);
+			continue;
+		}
+
+		// The chunk size line; a zero size ends the content and any
+		// trailers after it are discarded.
+		stream.chunk.push_back(*data(in));
+		consume(in, 1);
+		if(!endswith(stream.chunk, "\r\n"))
+		{
+			if(unlikely(stream.chunk.size() > 64))
+				throw http2::error
+				{
+					"Invalid chunk size in response."
+				};
+
+			continue;
+		}
+
+		const size_t len
+		{
+			std::strtoul(stream.chunk.c_str(), nullptr, 16)
+		};
+
+		stream.chunk.clear();
+		if(!len)
+			write_data(client, stream, {}, true);
+		else
+			stream.remain = len + 2;
+	}
+
+	return size(buf);
+}
+
+void
+ircd::client::h2::write_head(client &client,
+                             stream &stream,
+                             const string_view &head)
+{
+	using http2::frame;
+	using http2::hpack;
+
+	// Literal encoding adds at most a few bytes to each line of the head.
+	const unique_buffer<mutable_buffer> buf
+	{
+		size(head) * 2 + 64
+	};
+
+	mutable_buffer out{buf};
+	consume(out, http2::frame::SIZE);
+
+	// :status is first; it is filled in after the head is parsed, with room
+	// for a literal of its three digits.
+	char status_buf[8];
+	mutable_buffer fields{out};
+	consume(fields, sizeof(status_buf));
+
+	parse::buffer pb{const_buffer{head}};
+	parse::capstan pc{pb};
+	const http::response::head response
+	{
+		pc, [&fields](const http::header &header)
+		{
+			const auto &[name, value] {header};
+			if(iequals(name, "connection"_sv)
+			|| iequals(name, "keep-alive"_sv)
+			|| iequals(name, "transfer-encoding"_sv)
+			|| iequals(name, "proxy-connection"_sv)
+			|| iequals(name, "upgrade"_sv))
+				return;
+
+			consume(fields, hpack::write_literal(fields, name, value));
+		}
+	};
+
+	// Indexes of :status in the static table.
+	const uint8_t index
+	{
+		response.status == "200"? uint8_t(8):
+		response.status == "204"? uint8_t(9):
+		response.status == "206"? uint8_t(10):
+		response.status == "304"? uint8_t(11):
+		response.status == "400"? uint8_t(12):
+		response.status == "404"? uint8_t(13):
+		response.status == "500"? uint8_t(14):
+		uint8_t(0)
+	};
+
+	const size_t status_len
+	{
+		index?
+			hpack::write_integer(status_buf, 0x80, 7, index):
+			hpack::write_literal(status_buf, uint8_t(8), response.status)
+	};
+
+	// Move the status up against the fields.
+	char *const block_start
+	{
+		data(out) + sizeof(status_buf) - status_len
+	};
+
+	memcpy(block_start, status_buf, status_len);
+	const string_view block
+	{
+		block_start, data(fields)
+	};
+
+	stream.chunked = iequals(response.transfer_encoding, "chunked"_sv);
+	stream.remain = response.content_length;
+	const bool end
+	{
+		!stream.chunked && !stream.remain
+	};
+
+	// The frames of the block are written together so no other frame can
+	// come between.
+	std::string frames;
+	http2::write_headers(frames, block, client.stream_id, setting(http2::settings::code::MAX_FRAME_SIZE), end);
+	write(const_buffer{frames});
+	stream.headed = true;
+	if(end)
+	{
+		stream.ended = true;
+		stream.state = http2::stream::state::CLOSED;
+	}
+}
+
+void
+ircd::client::h2::write_data(client &client,
+                             stream &stream,
+                             const_buffer buf,
+                             const bool &end)
+{
+	using http2::frame;
+
+	if(empty(buf) && !end)
+		return;
+
+	const auto writable{[this, &stream, &buf]
+	{
+		return stream.reset || sock->fini || empty(buf) ||
+			std::min(send_window, stream.send_window) > 0;
+	}};
+
+	do
+	{
+		if(!writable())
+		{
+			if(unlikely(blocked >= size_t(blocked_max)))
+			{
+				stream.reset = true;
+				stream.cancel = true;
+				throw std::system_error
+				{
+					make_error_code(std::errc::connection_reset)
+				};
+			}
+
+			const scope_count blocking
+			{
+				blocked
+			};
+
+			if(unlikely(!dock.wait_for(seconds(client.conf->request_timeout), writable)))
+				throw std::system_error
+				{
+					make_error_code(std::errc::timed_out)
+				};
+		}
+
+		if(unlikely(stream.reset))
+			throw std::system_error
+			{
+				make_error_code(std::errc::connection_reset)
+			};
+
+		const size_t len
+		{
+			std::min
+			({
+				size(buf),
+				size_t(setting(http2::settings::code::MAX_FRAME_SIZE)),
+				size_t(std::max(std::min(send_window, stream.send_window), 0L)),
+			})
+		};
+
+		// The windows are taken before the write yields so another stream
+		// can't spend them too.
+		send_window -= len;
+		stream.send_window -= len;
+		const bool last(end && len == size(buf));
+		const uint8_t flags(last? frame::END_STREAM : 0);
+		write({uint32_t(len), frame::DATA, flags, client.stream_id}, {data(buf), len});
+		consume(buf, len);
+	}
+	while(!empty(buf));
+
+	if(end)
+	{
+		stream.ended = true;
+		stream.state = http2::stream::state::CLOSED;
+	}
+}
+
+void
+ircd::client::h2::write_settings(client &client)
+{
+	using http2::frame;
+	using code = http2::settings::code;
+
+	const struct frame::settings::param param[]
+	{
+		{ code::ENABLE_PUSH,               0                    },
+		{ code::MAX_CONCURRENT_STREAMS,    uint32_t(max_streams) },
+		{ code::INITIAL_WINDOW_SIZE,       window()             },
+		{ code::MAX_HEADER_LIST_SIZE,      uint32_t(client.conf->header_max_size) },
+	};
+
+	char buf[sizeof(param) / sizeof(param[0]) * 6];
+	const const_buffer payload
+	{
+		http2::write_settings(buf, {param, sizeof(param) / sizeof(param[0])})
+	};
+
+	started = true;
+	write({uint32_t(size(payload)), frame::SETTINGS, 0, 0}, payload);
+
+	// The connection window isn't covered by the setting.
+	write_window(0, window() - recv_window);
+}
+
+void
+ircd::client::h2::write_window(const uint32_t &stream_id,
+                               const size_t &increment)
+{
+	if(!increment)
+		return;
+
+	if(!stream_id)
+		recv_window += increment;
+	else if(const auto it(streams.find(stream_id)); it != end(streams))
+		it->second.recv_window += increment;
+
+	char buf[4];
+	write({4, http2::frame::WINDOW_UPDATE, 0, stream_id}, http2::write_window(buf, increment));
+}
+
+size_t
+ircd::client::h2::write(const http2::frame::header &header,
+                        const const_buffer &payload)
+{
+	char buf[http2::frame::SIZE];
+	const const_buffer buffers[]
+	{
+		http2::write(buf, header), payload
+	};
+
+	const std::lock_guard lock
+	{
+		mutex
+	};
+
+	return net::write_all(*sock, buffers);
+}
+
+size_t
+ircd::client::h2::write(const const_buffer &buf)
+{
+	const std::lock_guard lock
+	{
+		mutex
+	};
+
+	return net::write_all(*sock, buf);
+}
+
+uint32_t &
+ircd::client::h2::setting(const http2::settings::code &code)
+{
+	assert(code > 0 && code < http2::settings::code::_NUM_);
+	return remote.at(code - 1);
+}
+
+uint32_t
+ircd::client::h2::window()
+{
+	return std::min(size_t(window_size), size_t(0x7fffffffU));
+}
@@ -62,25 +62,28 @@ ircd::ctx::ole::offload::offload(const opts &opts,
                                  const function &func)
 {
 	assert(current);
-	assert(opts.concurrency == 1); // not yet implemented
+	assert(opts.concurrency >= 1);
 
 	// Prepare the offload package on our stack here. These objects will
-	// remain here for the duration of the offload.
-	latch latch{1};
+	// remain here for the duration of the offload. The function is queued
+	// once for each unit of concurrency; the latch is released when the last
+	// of them has returned and the first exception is the one rethrown.
+	latch latch(opts.concurrency);
 	std::exception_ptr eptr;
 	auto *const context(current);
-	auto closure{[&func, &latch, &eptr, &context]
+	const auto closure{[&func, &latch, &eptr, &context]
 	() noexcept
 	{
+		std::exception_ptr thrown;
 		try
 		{
 			func();
 		}
 		catch(...)
 		{
-			// Note that the write to eptr is taking place on a different
-			// thread from where we created the eptr.
-			eptr = std::current_exception();
+			// Note that the exception is captured on a different thread from
+			// where eptr lives; it is only transferred back within the signal.
+			thrown = std::current_exception();
 		}
 
 		// The ctx::signal() is a special device which executes the closure
@@ -88,8 +91,11 @@ ircd::ctx::ole::offload::offload(const opts &opts,
 		// thread. This has the ability to provide the cross-thread
 		// synchronization we need to hit the latch from this thread.
 		assert(context);
-		signal(*context, [&latch]
+		signal(*context, [&latch, &eptr, thrown(std::move(thrown))]
 		{
+			if(thrown && !eptr)
+				eptr = thrown;
+
 			assert(!latch.is_ready());
 			latch.count_down();
 		});
@@ -101,7 +107,9 @@ ircd::ctx::ole::offload::offload(const opts &opts,
 	// capable of throwing an interrupt that was received during this scope.
 	const uninterruptible uninterruptible;
 
-	ole::push(std::move(closure));       // scope address required for clang-7
+	for(size_t i(0); i < opts.concurrency; ++i)
+		ole::push(offload::function{closure});
+
 	latch.wait();
 
 	// Don't throw any exception if there is a pending interrupt for this ctx.
@@ -111,6 +119,7 @@ ircd::ctx::ole::offload::offload(const opts &opts,
 		if(unlikely(eptr))
 			std::rethrow_exception(eptr);
 }
+
 void
 ircd::ctx::ole::push(offload::function &&func)
 {
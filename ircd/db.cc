@@ -78,6 +78,14 @@ ircd::db::request
 decltype(ircd::db::write_mutex)
 ircd::db::write_mutex;
 
+/// Point reads: the seek of an iterator to a key, and each chunk of keys
+/// submitted to MultiGet.
+decltype(ircd::db::read_latency)
+ircd::db::read_latency
+{
+	{ "name",     "ircd.db.read.latency" },
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // init
@@ -3935,6 +3943,38 @@ ircd::db::prefetcher;
 //
 // db::prefetcher
 //
+decltype(ircd::db::prefetcher::depth_min)
+ircd::db::prefetcher::depth_min
+{
+	{ "name",     "ircd.db.prefetcher.depth.min" },
+	{ "default",  1L                             },
+};
+
+decltype(ircd::db::prefetcher::depth_max)
+ircd::db::prefetcher::depth_max
+{
+	{ "name",     "ircd.db.prefetcher.depth.max" },
+	{ "default",  16L                            },
+};
+
+/// A lane widens while the average latency is within this multiple of the
+/// baseline latency.
+decltype(ircd::db::prefetcher::widen)
+ircd::db::prefetcher::widen
+{
+	{ "name",     "ircd.db.prefetcher.widen" },
+	{ "default",  2L                         },
+};
+
+/// A lane narrows while the average latency is beyond this multiple of the
+/// baseline latency.
+decltype(ircd::db::prefetcher::throttle)
+ircd::db::prefetcher::throttle
+{
+	{ "name",     "ircd.db.prefetcher.throttle" },
+	{ "default",  4L                            },
+};
+
 ircd::db::prefetcher::prefetcher()
 :ticker
 {
@@ -3953,68 +3993,108 @@ ircd::db::prefetcher::prefetcher()
 ircd::db::prefetcher::~prefetcher()
 noexcept
 {
-	while(!queue.empty())
+	while(size())
 	{
 		log::warning
 		{
 			log, "Prefetcher waiting for %zu requests to clear...",
-			queue.size(),
+			size(),
 		};
 
 		dock.wait_for(seconds(5), [this]
 		{
-			return queue.empty();
+			return !size();
 		});
 	}
 
-	assert(queue.empty());
+	assert(!size());
 }
 
 bool
 ircd::db::prefetcher::operator()(column &c,
                                  const string_view &key,
                                  const gopts &opts)
+{
+	const string_view keys[]
+	{
+		key
+	};
+
+	return operator()(c, vector_view<const string_view>(keys), opts);
+}
+
+size_t
+ircd::db::prefetcher::operator()(column &c,
+                                 const vector_view<const string_view> &keys,
+                                 const gopts &opts)
 {
 	auto &d
 	{
 		static_cast<database &>(c)
 	};
 
+	auto &lane
+	{
+		get(d, c)
+	};
+
 	assert(ticker);
-	ticker->queries++;
-	if(db::cached(c, key, opts))
+	size_t ret(0);
+	for(const auto &key : keys)
 	{
-		ticker->rejects++;
-		return false;
+		ticker->queries++;
+		if(db::cached(c, key, opts))
+		{
+			ticker->rejects++;
+			continue;
+		}
+
+		lane.queue.emplace_back(d, c, key);
+		lane.queue.back().snd = now<steady_point>();
+		lane.pending++;
+		ticker->request++;
+		ret++;
 	}
 
-	queue.emplace_back(d, c, key);
-	queue.back().snd = now<steady_point>();
-	ticker->request++;
+	if(ret)
+		dispatch(lane, opts);
+
+	return ret;
+}
 
+/// Dispatch workers for the lane up to its depth. Requests beyond the depth
+/// remain queued until completions make room.
+bool
+ircd::db::prefetcher::dispatch(lane &lane,
+                               const gopts &opts)
+{
 	// Branch here based on whether it's not possible to directly dispatch
 	// a db::request worker. If all request workers are busy we notify our own
 	// prefetcher worker, and then it blocks on submitting to the request
 	// worker instead of us blocking here. This is done to avoid use and growth
 	// of any request pool queue, and allow for more direct submission.
-	if(db::request.wouldblock())
+	while(lane.ready())
 	{
-		dock.notify_one();
+		if(db::request.wouldblock())
+		{
+			dock.notify_one();
 
-		// If the user sets NO_BLOCKING we honor their request to not
-		// context switch for a prefetch. However by default we want to
-		// control queue growth, so we insert voluntary yield here to allow
-		// prefetch operations to at least be processed before returning to
-		// the user submitting more prefetches.
-		if(likely(!test(opts, db::get::NO_BLOCKING)))
-			ctx::yield();
+			// If the user sets NO_BLOCKING we honor their request to not
+			// context switch for a prefetch. However by default we want to
+			// control queue growth, so we insert voluntary yield here to allow
+			// prefetch operations to at least be processed before returning to
+			// the user submitting more prefetches.
+			if(likely(!test(opts, db::get::NO_BLOCKING)))
+				ctx::yield();
 
-		return true;
+			return false;
+		}
+
+		const ctx::critical_assertion ca;
+		ticker->directs++;
+		this->handle(lane);
 	}
 
-	const ctx::critical_assertion ca;
-	ticker->directs++;
-	this->handle();
 	return true;
 }
 
@@ -4042,23 +4122,29 @@ size_t
 ircd::db::prefetcher::cancel(const closure &closure)
 {
 	size_t canceled(0);
-	for(auto &request : queue)
+	for(auto &it : lanes)
 	{
-		// already finished
-		if(request.fin != steady_point::min())
-			continue;
-
-		// in progress; can't cancel
-		if(request.req != steady_point::min())
-			continue;
-
-		// allow user to accept or reject
-		if(!closure(request))
-			continue;
-
-		// cancel by precociously setting the finish time.
-		request.fin = now<steady_point>();
-		++canceled;
+		auto &lane(it.second);
+		for(auto &request : lane.queue)
+		{
+			// already finished
+			if(request.fin != steady_point::min())
+				continue;
+
+			// in progress; can't cancel
+			if(request.req != steady_point::min())
+				continue;
+
+			// allow user to accept or reject
+			if(!closure(request))
+				continue;
+
+			// cancel by precociously setting the finish time.
+			request.fin = now<steady_point>();
+			assert(lane.pending > 0);
+			lane.pending--;
+			++canceled;
+		}
 	}
 
 	if(canceled)
@@ -4069,6 +4155,54 @@ ircd::db::prefetcher::cancel(const closure &closure)
 	return canceled;
 }
 
+size_t
+ircd::db::prefetcher::size()
+const
+{
+	return std::accumulate(begin(lanes), end(lanes), size_t(0), []
+	(auto ret, const auto &lane)
+	{
+		return ret += lane.second.queue.size();
+	});
+}
+
+ircd::db::prefetcher::lane &
+ircd::db::prefetcher::get(database &d,
+                          const column &c)
+{
+	const auto &[it, inserted]
+	{
+		lanes.try_emplace(lane_id{std::addressof(d), db::id(c)})
+	};
+
+	auto &lane(it->second);
+	if(inserted)
+		lane.depth = std::max(size_t(depth_min), 1UL);
+
+	return lane;
+}
+
+/// Find the next lane with a request to dispatch; lanes are visited in turn
+/// so a storm of requests to one column doesn't hold up another.
+ircd::db::prefetcher::lane *
+ircd::db::prefetcher::next()
+{
+	auto it(lanes.upper_bound(cursor));
+	for(size_t i(0); i < lanes.size(); ++i, ++it)
+	{
+		if(it == end(lanes))
+			it = begin(lanes);
+
+		if(!it->second.ready())
+			continue;
+
+		cursor = it->first;
+		return &it->second;
+	}
+
+	return nullptr;
+}
+
 void
 ircd::db::prefetcher::worker()
 try
@@ -4077,17 +4211,16 @@ try
 	{
 		dock.wait([this]
 		{
-			if(queue.empty())
-				return false;
-
-			assert(ticker);
-			if(ticker->request <= ticker->handles)
-				return false;
-
-			return true;
+			return next() != nullptr;
 		});
 
-		handle();
+		lane *const lane
+		{
+			next()
+		};
+
+		if(likely(lane))
+			handle(*lane);
 	}
 }
 catch(const std::exception &e)
@@ -4100,20 +4233,26 @@ catch(const std::exception &e)
 }
 
 void
-ircd::db::prefetcher::handle()
+ircd::db::prefetcher::handle(lane &lane)
 {
 	auto handler
 	{
-		std::bind(&prefetcher::request_worker, this)
+		std::bind(&prefetcher::request_worker, this, std::ref(lane))
 	};
 
+	const unwind_exceptional undispatch{[&lane]
+	{
+		lane.dispatched--;
+	}};
+
+	lane.dispatched++;
 	ticker->handles++;
 	db::request(std::move(handler));
 	ticker->handled++;
 }
 
 void
-ircd::db::prefetcher::request_worker()
+ircd::db::prefetcher::request_worker(lane &lane)
 {
 	const ctx::scope_notify notify
 	{
@@ -4125,74 +4264,91 @@ ircd::db::prefetcher::request_worker()
 		this->request_workers
 	};
 
+	const unwind undispatch{[&lane]
+	{
+		assert(lane.dispatched > 0);
+		lane.dispatched--;
+	}};
+
 	// Garbage collection of the queue invoked unconditionally on unwind.
-	const unwind cleanup_on_leave
+	const unwind cleanup_on_leave{[this, &lane]
 	{
-		std::bind(&prefetcher::request_cleanup, this)
-	};
+		request_cleanup(lane);
+	}};
 
 	// GC the queue here to get rid of any cancelled requests which have
 	// arrived at the front so they don't become our request.
 	const size_t cleanup_on_enter
 	{
-		request_cleanup()
+		request_cleanup(lane)
 	};
 
 	// Find the first request in the queue which does not have its req
 	// timestamp sent.
-	auto request
+	const auto it
 	{
-		std::find_if(begin(queue), end(queue), []
+		std::find_if(begin(lane.queue), end(lane.queue), []
 		(const auto &request)
 		{
-			return request.req == steady_point::min();
+			return request.req == steady_point::min() && request.fin == steady_point::min();
 		})
 	};
 
-	if(request == end(queue))
+	if(it == end(lane.queue))
 		return;
 
+	// The queue may grow while this request is in progress; only the
+	// reference to the element is stable.
+	auto &request(*it);
+	const scope_count active
+	{
+		lane.active
+	};
+
 	assert(ticker);
-	assert(request->fin == steady_point::min());
-	request->req = now<steady_point>();
-	ticker->last_snd_req = duration_cast<microseconds>(request->req - request->snd);
+	assert(lane.pending > 0);
+	lane.pending--;
+	request.req = now<steady_point>();
+	ticker->last_snd_req = duration_cast<microseconds>(request.req - request.snd);
 	ticker->accum_snd_req += ticker->last_snd_req;
 
 	ticker->fetches++;
-	request_handle(*request);
-	assert(request->fin != steady_point::min());
+	request_handle(lane, request);
+	assert(request.fin != steady_point::min());
 	ticker->fetched++;
 
 	#ifdef IRCD_DB_DEBUG_PREFETCH
 	log::debug
 	{
-		log, "prefetcher reject:%zu request:%zu handle:%zu fetch:%zu direct:%zu cancel:%zu queue:%zu rw:%zu",
+		log, "prefetcher reject:%zu request:%zu handle:%zu fetch:%zu direct:%zu cancel:%zu queue:%zu rw:%zu depth:%zu",
 		ticker->rejects,
 		ticker->request,
 		ticker->handles,
 		ticker->fetches,
 		ticker->directs,
 		ticker->cancels,
-		queue.size(),
+		lane.queue.size(),
 		this->request_workers,
+		lane.depth,
 	};
 	#endif
 }
 
 size_t
-ircd::db::prefetcher::request_cleanup()
+ircd::db::prefetcher::request_cleanup(lane &lane)
 noexcept
 {
 	size_t removed(0);
 	const ctx::critical_assertion ca;
-	for(; !queue.empty() && queue.front().fin != steady_point::min(); ++removed)
-		queue.pop_front();
+	for(; !lane.queue.empty() && lane.queue.front().fin != steady_point::min(); ++removed)
+		lane.queue.pop_front();
 
 	return removed;
 }
 
 void
-ircd::db::prefetcher::request_handle(request &request)
+ircd::db::prefetcher::request_handle(lane &lane,
+                                     request &request)
 try
 {
 	assert(request.d);
@@ -4215,6 +4371,7 @@ try
 	request.fin = now<steady_point>();
 	ticker->last_req_fin = duration_cast<microseconds>(request.fin - request.req);
 	ticker->accum_req_fin += ticker->last_req_fin;
+	lane.sample(ticker->last_req_fin);
 	const bool lte
 	{
 		valid_lte(*it, key)
@@ -4230,7 +4387,7 @@ try
 	char pbuf[3][32];
 	log::debug
 	{
-		log, "[%s][%s] completed prefetch len:%zu lte:%b k:%zu v:%zu snd-req:%s req-fin:%s snd-fin:%s queue:%zu",
+		log, "[%s][%s] completed prefetch len:%zu lte:%b k:%zu v:%zu snd-req:%s req-fin:%s snd-fin:%s queue:%zu depth:%zu",
 		name(*request.d),
 		name(column),
 		size(key),
@@ -4240,7 +4397,8 @@ try
 		pretty(pbuf[0], request.req - request.snd, 1),
 		pretty(pbuf[1], request.fin - request.req, 1),
 		pretty(pbuf[2], request.fin - request.snd, 1),
-		queue.size(),
+		lane.queue.size(),
+		lane.depth,
 	};
 	#endif
 }
@@ -4285,6 +4443,54 @@ ircd::db::prefetcher::wait_pending()
 	return fetched_target - fetched_counter;
 }
 
+//
+// prefetcher::lane
+//
+
+bool
+ircd::db::prefetcher::lane::ready()
+const
+{
+	assert(dispatched >= active);
+	const size_t waiting
+	{
+		dispatched - active
+	};
+
+	return pending > waiting && dispatched < depth;
+}
+
+void
+ircd::db::prefetcher::lane::sample(const microseconds &req_fin)
+{
+	latency = latency != 0us?
+		(latency * 7 + req_fin) / 8:
+		req_fin;
+
+	// The baseline follows the lowest latency but creeps toward the average
+	// so a single fast result doesn't become the measure forever.
+	if(baseline == 0us || req_fin < baseline)
+		baseline = req_fin;
+	else if(latency > baseline)
+		baseline += (latency - baseline) / 64;
+
+	if(latency >= baseline * long(throttle))
+	{
+		depth = std::max(depth - 1, std::max(size_t(depth_min), 1UL));
+		credit = 0;
+		return;
+	}
+
+	if(latency > baseline * long(widen))
+		return;
+
+	if(++credit < depth)
+		return;
+
+	depth = std::min(depth + 1, std::max(size_t(depth_max), 1UL));
+	credit = 0;
+}
+
 //
 // prefetcher::request
 //
@@ -6404,6 +6610,20 @@ ircd::db::prefetch(column &column,
 	return (*prefetcher)(column, key, gopts);
 }
 
+size_t
+ircd::db::prefetch(column &column,
+                   const vector_view<const string_view> &keys,
+                   const gopts &gopts)
+{
+	static construction instance
+	{
+		[] { prefetcher = new struct prefetcher(); }
+	};
+
+	assert(prefetcher);
+	return (*prefetcher)(column, keys, gopts);
+}
+
 //
 // db::cached
 //
@@ -6587,6 +6807,107 @@ ircd::db::column::operator()(const string_view &key,
 	return true;
 }
 
+/// The keys are submitted to RocksDB's MultiGet in chunks, which lets it
+/// coalesce the block reads of the whole chunk rather than seeking an
+/// iterator for each key in turn. Each chunk costs one round of IO instead
+/// of one per key on a cache miss. A key which fails to read is logged and
+/// skipped like one not found; the rest of the batch is still read.
+size_t
+ircd::db::column::operator()(const vector_view<const string_view> &keys,
+                             const std::nothrow_t,
+                             const multi_closure &func,
+                             const gopts &gopts)
+{
+	#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 4)
+	database &d(*this);
+	database::column &c(*this);
+	rocksdb::ColumnFamilyHandle *const &cf(c);
+	const auto opts
+	{
+		make_opts(gopts)
+	};
+
+	static const size_t max {32};
+	rocksdb::Slice key[max];
+	rocksdb::PinnableSlice val[max];
+	rocksdb::Status status[max];
+
+	size_t ret(0);
+	for(size_t i(0); i < keys.size(); i += max)
+	{
+		const size_t num
+		{
+			std::min(keys.size() - i, max)
+		};
+
+		for(size_t j(0); j < num; ++j)
+		{
+			key[j] = slice(keys[i + j]);
+			val[j].Reset();
+		}
+
+		{
+			const ctx::uninterruptible::nothrow ui;
+			const ircd::stats::histogram::scope latency
+			{
+				read_latency
+			};
+
+			d.d->MultiGet(opts, cf, num, key, val, status, false);
+		}
+
+		for(size_t j(0); j < num; ++j)
+		{
+			if(status[j].IsNotFound())
+				continue;
+
+			if(unlikely(!status[j].ok()))
+			{
+				log::error
+				{
+					log, "[%s] '%s' multi-get key %zu of %zu :%s",
+					name(d),
+					name(c),
+					i + j,
+					keys.size(),
+					status[j].ToString(),
+				};
+
+				continue;
+			}
+
+			func(i + j, slice(val[j]));
+			++ret;
+		}
+	}
+
+	return ret;
+	#else
+	size_t ret(0);
+	for(size_t i(0); i < keys.size(); ++i) try
+	{
+		ret += operator()(keys[i], std::nothrow, [&func, &i]
+		(const string_view &val)
+		{
+			func(i, val);
+		}, gopts);
+	}
+	catch(const error &e)
+	{
+		log::error
+		{
+			log, "'%s' multi-get key %zu of %zu :%s",
+			name(*this),
+			i,
+			keys.size(),
+			e.what(),
+		};
+	}
+
+	return ret;
+	#endif
+}
+
 ircd::db::cell
 ircd::db::column::operator[](const string_view &key)
 const
@@ -7758,13 +8079,14 @@ ircd::db::_seek(database::column &c,
 try
 {
 	const ctx::uninterruptible ui;
+	const ircd::timer timer;
 
 	#ifdef RB_DEBUG_DB_SEEK
 	database &d(*c.d);
-	const ircd::timer timer;
 	#endif
 
 	_seek_(it, p);
+	read_latency(timer.at<microseconds>());
 
 	#ifdef RB_DEBUG_DB_SEEK
 	log::debug
@@ -3416,6 +3416,97 @@ catch(const std::exception &e)
 	return error_to_status{e};
 }
 
+/// The reads of a MultiRead are submitted to fs::read() as one batch so
+/// they are all in flight together; with io_uring the ctx yields once for
+/// the batch. The status of each read is reported in its request.
+#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 4)
+rocksdb::Status
+ircd::db::database::env::random_access_file::MultiRead(rocksdb::ReadRequest *const reqs,
+                                                       size_t num_reqs)
+noexcept try
+{
+	const ctx::uninterruptible::nothrow ui;
+
+	assert(reqs || !num_reqs);
+	#ifdef RB_DEBUG_DB_ENV
+	log::debug
+	{
+		log, "[%s] rfile:%p multiread:%p num:%zu",
+		d.name,
+		this,
+		reqs,
+		num_reqs,
+	};
+	#endif
+
+	std::vector<fs::read_opts> opts(num_reqs);
+	std::vector<fs::read_op> op(num_reqs);
+	for(size_t i(0); i < num_reqs; ++i)
+	{
+		opts[i].offset = reqs[i].offset;
+		opts[i].priority = ionice;
+		opts[i].aio = this->aio;
+		opts[i].all = !this->opts.direct;
+
+		op[i].fd = &fd;
+		op[i].opts = &opts[i];
+		op[i].buf = mutable_buffer
+		{
+			reqs[i].scratch, reqs[i].len
+		};
+
+		assert(reqs[i].scratch);
+		assert(!this->opts.direct || buffer::aligned(op[i].buf, _buffer_align));
+	}
+
+	fs::read(op);
+	for(size_t i(0); i < num_reqs; ++i) try
+	{
+		if(op[i].eptr)
+			std::rethrow_exception(op[i].eptr);
+
+		reqs[i].result = slice(const_buffer
+		{
+			reqs[i].scratch, op[i].ret
+		});
+
+		reqs[i].status = Status::OK();
+	}
+	catch(const std::system_error &e)
+	{
+		log::error
+		{
+			log, "[%s] rfile:%p multiread:%p offset:%zu length:%zu scratch:%p :%s",
+			d.name,
+			this,
+			reqs,
+			reqs[i].offset,
+			reqs[i].len,
+			reqs[i].scratch,
+			e.what()
+		};
+
+		reqs[i].status = error_to_status{e};
+	}
+
+	return Status::OK();
+}
+catch(const std::exception &e)
+{
+	log::critical
+	{
+		log, "[%s] rfile:%p multiread:%p num:%zu :%s",
+		d.name,
+		this,
+		reqs,
+		num_reqs,
+		e.what()
+	};
+
+	return error_to_status{e};
+}
+#endif
+
 rocksdb::Status
 ircd::db::database::env::random_access_file::InvalidateCache(size_t offset,
                                                              size_t length)
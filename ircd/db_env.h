@@ -138,6 +138,9 @@ struct ircd::db::database::env::random_access_file final
 	Status InvalidateCache(size_t offset, size_t length) noexcept override;
 	Status Read(uint64_t offset, size_t n, Slice *result, char *scratch) const noexcept override;
 	Status Prefetch(uint64_t offset, size_t n) noexcept override;
+	#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 4)
+	Status MultiRead(rocksdb::ReadRequest *reqs, size_t num_reqs) noexcept override;
+	#endif
 
 	random_access_file(database *const &d, const std::string &name, const EnvOptions &);
 	~random_access_file() noexcept;
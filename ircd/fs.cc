@@ -24,9 +24,6 @@
 	#include "fs_iou.h"
 #endif
 
-// TODO: prevents use until io_uring support implemented
-#undef IRCD_USE_IOU
-
 decltype(ircd::fs::log)
 ircd::fs::log
 {
@@ -761,6 +758,67 @@ ircd::fs::fincore(void *const &map,
 	return std::find(vec, vec + vec_size, 0UL) == vec + vec_size;
 }
 
+/// Read a batch. With io_uring every read of the batch is placed on the
+/// submit queue before one submission and the ctx yields once for all of
+/// them; otherwise the reads are conducted in turn. A short read from the
+/// batch with read_opts.all is finished by the incremental read loop. An
+/// error only fails its own op.
+size_t
+ircd::fs::read(const vector_view<read_op> &ops)
+{
+	#ifdef IRCD_USE_IOU
+	const bool batch
+	{
+		iou::system && std::all_of(begin(ops), end(ops), []
+		(const auto &op)
+		{
+			assert(op.opts);
+			return op.opts->aio;
+		})
+	};
+
+	if(likely(batch))
+		iou::read(ops);
+	#else
+	const bool batch
+	{
+		false
+	};
+	#endif
+
+	size_t ret(0);
+	for(size_t i(0); i < ops.size(); ++i) try
+	{
+		auto &op(ops[i]);
+		assert(op.fd && op.opts);
+		if(op.eptr)
+			continue;
+
+		const bool remain
+		{
+			!batch || (op.opts->all && op.ret > 0 && op.ret < size(op.buf))
+		};
+
+		if(remain)
+		{
+			read_opts opts(*op.opts);
+			opts.offset += op.ret;
+
+			mutable_buffer buf(op.buf);
+			consume(buf, op.ret);
+			op.ret += size(read(*op.fd, buf, opts));
+		}
+
+		++ret;
+	}
+	catch(...)
+	{
+		ops[i].eptr = std::current_exception();
+	}
+
+	return ret;
+}
+
 std::string
 ircd::fs::read(const string_view &path,
                const read_opts &opts)
@@ -1571,7 +1629,7 @@ decltype(ircd::fs::iou::enable)
 ircd::fs::iou::enable
 {
 	{ "name",     "ircd.fs.iou.enable"  },
-	{ "default",  false                 },
+	{ "default",  true                  },
 	{ "persist",  false                 },
 };
 
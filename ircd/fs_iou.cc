@@ -12,6 +12,13 @@
 #include <sys/eventfd.h>
 #include "fs_iou.h"
 
+namespace ircd::fs::iou
+{
+	static int rw_flags(const request &);
+	static size_t execute(request &);
+	static size_t result(const request &);
+}
+
 decltype(ircd::fs::iou::MAX_EVENTS)
 ircd::fs::iou::MAX_EVENTS
 {
@@ -38,10 +45,14 @@ ircd::fs::iou::max_submit
 // init
 //
 
+/// The ring is set up when the kernel supports it; when it can't be (e.g.
+/// the syscall is filtered) the error is logged and AIO or the synchronous
+/// calls are used instead.
 ircd::fs::iou::init::init()
+try
 {
 	assert(!system);
-	if(!iou::enable)
+	if(!iou::enable || !iou::support)
 		return;
 
 	system = new struct iou::system
@@ -50,6 +61,14 @@ ircd::fs::iou::init::init()
 		size_t(max_submit)
 	);
 }
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "io_uring unavailable; falling back :%s",
+		e.what(),
+	};
+}
 
 ircd::fs::iou::init::~init()
 noexcept
@@ -92,27 +111,74 @@ ircd::fs::iou::translate(const int &val)
 size_t
 ircd::fs::iou::count(const op &op)
 {
-	return 0;
+	size_t ret(0);
+	for_each([&op, &ret]
+	(const request &request)
+	{
+		ret += request.op == op;
+		return true;
+	});
+
+	return ret;
 }
 
 size_t
 ircd::fs::iou::count(const state &state)
 {
-	return 0;
+	size_t ret(0);
+	for_each(state, [&ret]
+	(const request &request)
+	{
+		++ret;
+		return true;
+	});
+
+	return ret;
 }
 
 size_t
 ircd::fs::iou::count(const state &state,
                      const op &op)
 {
-	return 0;
+	size_t ret(0);
+	for_each(state, [&op, &ret]
+	(const request &request)
+	{
+		ret += request.op == op;
+		return true;
+	});
+
+	return ret;
 }
 
+/// Only requests still on the submit queue can be iterated; the kernel
+/// holds no reference to requests once they have been consumed.
 bool
 ircd::fs::iou::for_each(const state &state,
                         const std::function<bool (const request &)> &closure)
 {
 	assert(system);
+	if(state != state::QUEUED)
+		return true;
+
+	const auto &mask(*system->ring_mask[0]);
+	uint32_t head(__atomic_load_n(system->head[0], __ATOMIC_ACQUIRE));
+	for(; head != system->sq_tail; ++head)
+	{
+		const auto &sqe
+		{
+			system->sqe[system->sq[head & mask]]
+		};
+
+		const auto *const request
+		{
+			reinterpret_cast<const iou::request *>(sqe.user_data)
+		};
+
+		if(request && !closure(*request))
+			return false;
+	}
+
 	return true;
 }
 
@@ -120,45 +186,35 @@ bool
 ircd::fs::iou::for_each(const std::function<bool (const request &)> &closure)
 {
 	assert(system);
-	return true;
+	return for_each(state::QUEUED, closure);
 }
 
 struct ::io_uring_sqe &
 ircd::fs::iou::sqe(request &request)
 {
 	assert(system);
-	::io_uring_sqe *const ret
-	{
-		nullptr
-	};
-
 	if(request.id < 0)
 		throw std::out_of_range
 		{
 			"request has no entry on the submit queue."
 		};
 
-	assert(ret);
-	return *ret;
+	assert(uint32_t(request.id) < *system->ring_entries[0]);
+	return system->sqe[request.id];
 }
 
 const struct ::io_uring_sqe &
 ircd::fs::iou::sqe(const request &request)
 {
 	assert(system);
-	const ::io_uring_sqe *const ret
-	{
-		nullptr
-	};
-
 	if(request.id < 0)
 		throw std::out_of_range
 		{
 			"request has no entry on the submit queue."
 		};
 
-	assert(ret);
-	return *ret;
+	assert(uint32_t(request.id) < *system->ring_entries[0]);
+	return system->sqe[request.id];
 }
 
 ircd::string_view
@@ -179,10 +235,278 @@ ircd::fs::iou::reflect(const state &s)
 ircd::fs::const_iovec_view
 ircd::fs::iou::iovec(const request &request)
 {
-	return
+	return request.iov;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// fs_iou.h
+//
+
+void
+ircd::fs::iou::fsync(const fd &fd,
+                     const sync_opts &opts)
+{
+	ctx::dock waiter;
+	iou::request request
+	{
+		fd, {}, &opts
+	};
+
+	request.waiter = &waiter;
+	execute(request);
+}
+
+size_t
+ircd::fs::iou::read(const fd &fd,
+                    const const_iovec_view &iov,
+                    const read_opts &opts)
+{
+	ctx::dock waiter;
+	iou::request request
+	{
+		fd, iov, &opts
+	};
+
+	request.waiter = &waiter;
+	const scope_count cur_reads{stats.cur_reads};
+	stats.max_reads = std::max(stats.max_reads, stats.cur_reads);
+
+	const size_t bytes
 	{
-		//reinterpret_cast<const ::iovec *>(iou_buf), iou_nbytes
+		execute(request)
 	};
+
+	stats.bytes_read += bytes;
+	stats.reads++;
+	return bytes;
+}
+
+/// Every read of the batch is placed on the submit queue before a single
+/// io_uring_enter(2) for all of them; the ctx then sleeps on one dock until
+/// the last completion is reaped. A read which is cut short is left for
+/// the caller; an error only fails its own op.
+size_t
+ircd::fs::iou::read(const vector_view<read_op> &ops)
+{
+	assert(system);
+	assert(ctx::current);
+
+	std::vector<::iovec> iov(ops.size());
+	std::deque<request> req;
+	ctx::dock waiter;
+
+	// When the ctx is interrupted nothing can be abandoned to the kernel;
+	// requests still on the submit queue are canceled and the rest must
+	// be waited for.
+	const unwind_exceptional cancel{[&req]
+	{
+		const ctx::uninterruptible::nothrow ui;
+		for(auto &request : req)
+		{
+			if(request.state == state::QUEUED)
+				system->cancel(request);
+
+			while(!system->wait(request));
+		}
+	}};
+
+	stats.cur_reads += ops.size();
+	stats.max_reads = std::max(stats.max_reads, stats.cur_reads);
+	const unwind dec{[&ops]
+	{
+		stats.cur_reads -= ops.size();
+	}};
+	for(size_t i(0); i < ops.size(); ++i)
+	{
+		assert(ops[i].fd);
+		assert(ops[i].opts);
+		iov[i].iov_base = data(ops[i].buf);
+		iov[i].iov_len = size(ops[i].buf);
+		auto &request
+		{
+			req.emplace_back(*ops[i].fd, const_iovec_view{&iov[i], 1}, ops[i].opts)
+		};
+
+		request.waiter = &waiter;
+		stats.bytes_requests += iov[i].iov_len;
+		stats.requests++;
+
+		system->dock.wait([]
+		{
+			return system->request_avail() > 0;
+		});
+
+		system->submit(request);
+	}
+
+	// Flush the queue here rather than wait for the chaser.
+	if(system->qcount)
+		system->submit();
+
+	size_t ret(0);
+	for(size_t i(0); i < ops.size(); ++i) try
+	{
+		while(!system->wait(req[i]));
+		ops[i].ret = result(req[i]);
+		stats.bytes_read += ops[i].ret;
+		stats.reads++;
+		++ret;
+	}
+	catch(const std::system_error &)
+	{
+		ops[i].eptr = std::current_exception();
+	}
+
+	return ret;
+}
+
+size_t
+ircd::fs::iou::write(const fd &fd,
+                     const const_iovec_view &iov,
+                     const write_opts &opts)
+{
+	ctx::dock waiter;
+	iou::request request
+	{
+		fd, iov, &opts
+	};
+
+	request.waiter = &waiter;
+	const size_t req_bytes
+	{
+		fs::bytes(iov)
+	};
+
+	const scope_count cur_writes{stats.cur_writes};
+	stats.max_writes = std::max(stats.max_writes, stats.cur_writes);
+
+	stats.cur_bytes_write += req_bytes;
+	const unwind dec{[&req_bytes]
+	{
+		stats.cur_bytes_write -= req_bytes;
+	}};
+
+	const size_t bytes
+	{
+		execute(request)
+	};
+
+	stats.bytes_write += bytes;
+	stats.writes++;
+	return bytes;
+}
+
+/// Submit a request and properly yield the ircd::ctx. When this returns the
+/// result will be available or an exception will be thrown.
+size_t
+ircd::fs::iou::execute(request &request)
+{
+	assert(system);
+	assert(ctx::current);
+	assert(request.waiter);
+
+	const size_t submitted_bytes
+	{
+		bytes(request.iov)
+	};
+
+	stats.bytes_requests += submitted_bytes;
+	stats.requests++;
+
+	const uint16_t &curcnt(stats.requests - stats.complete);
+	stats.max_requests = std::max(stats.max_requests, curcnt);
+
+	// Wait here until there's room to submit a request
+	system->dock.wait([]
+	{
+		return system->request_avail() > 0;
+	});
+
+	system->submit(request);
+	while(!system->wait(request));
+	return result(request);
+}
+
+size_t
+ircd::fs::iou::result(const request &request)
+{
+	assert(request.state == state::COMPLETED);
+	assert(request.opts);
+
+	const size_t submitted_bytes
+	{
+		bytes(request.iov)
+	};
+
+	stats.bytes_complete += submitted_bytes;
+	stats.complete++;
+
+	if(likely(request.res >= 0))
+		return size_t(request.res);
+
+	static_assert(EAGAIN == EWOULDBLOCK);
+	if(!request.opts->blocking && request.res == -EAGAIN)
+		return 0UL;
+
+	stats.errors++;
+	stats.bytes_errors += submitted_bytes;
+	thread_local char errbuf[512]; fmt::sprintf
+	{
+		errbuf, "fd:%d size:%zu off:%zd op:%u #%d",
+		request.fd,
+		submitted_bytes,
+		request.opts->offset,
+		uint(request.op),
+		-request.res,
+	};
+
+	throw std::system_error
+	{
+		request.ec, errbuf
+	};
+}
+
+int
+ircd::fs::iou::rw_flags(const request &request)
+{
+	int ret{0};
+	assert(request.opts);
+
+	#if defined(RWF_NOWAIT)
+	if(support::nowait && !request.opts->blocking)
+		ret |= RWF_NOWAIT;
+	#endif
+
+	if(request.op != op::WRITE)
+		return ret;
+
+	const auto &opts
+	{
+		*static_cast<const write_opts *>(request.opts)
+	};
+
+	#if defined(RWF_APPEND)
+	if(support::append && opts.offset == -1)
+		ret |= RWF_APPEND;
+	#endif
+
+	#if defined(RWF_DSYNC)
+	if(support::dsync && opts.sync && !opts.metadata)
+		ret |= RWF_DSYNC;
+	#endif
+
+	#if defined(RWF_SYNC)
+	if(support::sync && opts.sync && opts.metadata)
+		ret |= RWF_SYNC;
+	#endif
+
+	#ifdef RWF_WRITE_LIFE_SHIFT
+	if(support::rwf_write_life && opts.write_life)
+		ret |= (opts.write_life << (RWF_WRITE_LIFE_SHIFT));
+	#endif
+
+	return ret;
 }
 
 //
@@ -198,14 +522,26 @@ ircd::fs::iou::request::request(const fs::fd &fd,
 }
 ,op
 {
-	fs::op::NOOP
+	opts->op
 }
+,fd
+{
+	int(fd)
+}
+,iov
 {
+	iov
+}
+{
+	assert(system);
+	assert(ctx::current);
 }
 
 ircd::fs::iou::request::~request()
 noexcept
 {
+	assert(state != state::QUEUED);
+	assert(state != state::SUBMITTED);
 }
 
 //
@@ -354,6 +690,10 @@ try
 {
 	reinterpret_cast<::io_uring_cqe *>(cq_p.get() + p.cq_off.cqes)
 }
+,submit_max
+{
+	std::min(max_submit?: size_t(p.sq_entries), size_t(p.sq_entries))
+}
 ,ev_count
 {
 	0
@@ -419,7 +759,14 @@ try
 		cq_len,
 	};
 
-	assert(0);
+	// Completions are signaled on the eventfd integrated with the ircd
+	// event loop; it is read once for any number of completions.
+	const int ev_fd_
+	{
+		int(ev_fd.native_handle())
+	};
+
+	syscall<__NR_io_uring_register>(int(fd), IORING_REGISTER_EVENTFD, &ev_fd_, 1);
 }
 catch(const std::exception &e)
 {
@@ -434,6 +781,7 @@ catch(const std::exception &e)
 ircd::fs::iou::system::~system()
 noexcept try
 {
+	assert(qcount == 0);
 	const ctx::uninterruptible::nothrow ui;
 
 	interrupt();
@@ -482,9 +830,258 @@ ircd::fs::iou::system::wait()
 		return ev_count == uint64_t(-1);
 	});
 
+	assert(request_count() == 0);
+	return true;
+}
+
+/// Cancel a request. Only a request still on the submit queue can be
+/// canceled; its entry is replaced with a no-op the kernel will complete
+/// without a reference to the request.
+bool
+ircd::fs::iou::system::cancel(request &request)
+{
+	if(request.state != state::QUEUED)
+		return false;
+
+	assert(request.id >= 0);
+	auto &sqe(iou::sqe(request));
+	assert(sqe.user_data == uintptr_t(&request));
+	sqe.opcode = IORING_OP_NOP;
+	sqe.user_data = 0;
+
+	request.id = -1;
+	request.res = -ECANCELED;
+	request.ec = make_error_code(ECANCELED);
+	request.state = state::COMPLETED;
+	if(request.waiter)
+		request.waiter->notify_one();
+
+	stats.bytes_cancel += bytes(request.iov);
+	stats.cancel++;
+	return true;
+}
+
+/// Block the current context while waiting for results.
+///
+/// This function returns true when the request completes and it's safe to
+/// continue. If the ctx is interrupted a request still on the submit queue
+/// is canceled before rethrowing. If this function returns false the kernel
+/// still owns the request and it *must* be called again until it no longer
+/// returns false.
+bool
+ircd::fs::iou::system::wait(request &request)
+try
+{
+	assert(request.waiter);
+	request.waiter->wait([&request]
+	{
+		return request.state == state::COMPLETED;
+	});
+
+	return true;
+}
+catch(...)
+{
+	if(request.state == state::COMPLETED)
+		throw;
+
+	if(request.state == state::QUEUED)
+	{
+		cancel(request);
+		throw;
+	}
+
+	return false;
+}
+
+/// Write the request into the next entry of the submission ring. The entry
+/// is not seen by the kernel until the tail is published by submit().
+bool
+ircd::fs::iou::system::submit(request &request)
+{
+	assert(request.opts);
+	assert(request.state == state::INVALID);
+	assert(request_avail() > 0);
+	const ctx::critical_assertion ca;
+
+	const auto &mask(*ring_mask[0]);
+	const uint32_t idx(sq_tail & mask);
+	auto &sqe(this->sqe[idx]);
+	sqe = {0};
+	sqe.fd = request.fd;
+	sqe.user_data = uintptr_t(&request);
+	switch(request.op)
+	{
+		case op::READ:
+			sqe.opcode = IORING_OP_READV;
+			sqe.addr = uintptr_t(request.iov.data());
+			sqe.len = request.iov.size();
+			sqe.off = request.opts->offset;
+			sqe.rw_flags = rw_flags(request);
+			break;
+
+		case op::WRITE:
+			sqe.opcode = IORING_OP_WRITEV;
+			sqe.addr = uintptr_t(request.iov.data());
+			sqe.len = request.iov.size();
+			sqe.rw_flags = rw_flags(request);
+			sqe.off = request.opts->offset;
+			#if defined(RWF_APPEND)
+			if(sqe.rw_flags & RWF_APPEND)
+				sqe.off = 0;
+			#endif
+			break;
+
+		case op::SYNC:
+			sqe.opcode = IORING_OP_FSYNC;
+			sqe.fsync_flags = static_cast<const sync_opts *>(request.opts)->metadata?
+				0U: IORING_FSYNC_DATASYNC;
+			break;
+
+		default:
+			sqe.opcode = IORING_OP_NOP;
+			break;
+	}
+
+	sq[idx] = idx;
+	request.id = idx;
+	request.state = state::QUEUED;
+	++sq_tail;
+	++qcount;
+	stats.cur_queued++;
+	stats.max_queued = std::max(stats.max_queued, stats.cur_queued);
+
+	// Determine whether this request will trigger a flush of the queue
+	// and be submitted itself as well.
+	const bool submit_now
+	{
+		false
+		|| !aio::submit_coalesce
+		|| request.opts->nodelay
+		|| qcount >= max_submit()
+	};
+
+	if(submit_now)
+		submit();
+
+	// Only post the chaser when the queue has one item. If it has more
+	// items the chaser was already posted after the first item and will
+	// flush the whole queue down to 0.
+	if(qcount == 1)
+	{
+		static ios::descriptor descriptor
+		{
+			"ircd::fs::iou chase"
+		};
+
+		auto handler(std::bind(&system::chase, this));
+		ircd::post(descriptor, std::move(handler));
+	}
+
 	return true;
 }
 
+/// The chaser is posted to the IRCd event loop after the first request.
+/// Ideally more requests will queue up before the chaser reaches the front
+/// of the IRCd event queue and executes.
+void
+ircd::fs::iou::system::chase()
+noexcept try
+{
+	if(!qcount)
+		return;
+
+	submit();
+	stats.chases++;
+	assert(!qcount);
+}
+catch(const std::exception &e)
+{
+	terminate
+	{
+		panic
+		{
+			"iou(%p) system::chase() qcount:%zu :%s", this, qcount, e.what()
+		}
+	};
+}
+
+/// Publish everything on the submission ring to the kernel with a single
+/// io_uring_enter(2) and mark the consumed requests submitted.
+size_t
+ircd::fs::iou::system::submit()
+noexcept try
+{
+	assert(qcount > 0);
+	assert(in_flight + qcount <= max_events());
+	const bool idle
+	{
+		in_flight == 0
+	};
+
+	const auto &mask(*ring_mask[0]);
+	uint32_t head(__atomic_load_n(this->head[0], __ATOMIC_ACQUIRE));
+	__atomic_store_n(tail[0], sq_tail, __ATOMIC_RELEASE);
+
+	size_t submitted(0);
+	while(qcount > submitted)
+		submitted += enter();
+
+	const uint32_t consumed(__atomic_load_n(this->head[0], __ATOMIC_ACQUIRE));
+	for(; head != consumed; ++head)
+	{
+		auto *const request
+		{
+			reinterpret_cast<iou::request *>(sqe[sq[head & mask]].user_data)
+		};
+
+		if(!request)
+			continue;
+
+		assert(request->state == state::QUEUED);
+		request->state = state::SUBMITTED;
+		request->id = -1;
+	}
+
+	in_flight += submitted;
+	qcount -= submitted;
+	assert(!qcount);
+
+	stats.submits += bool(submitted);
+	stats.cur_queued -= submitted;
+	stats.cur_submits += submitted;
+	stats.max_submits = std::max(stats.max_submits, stats.cur_submits);
+
+	if(idle && submitted > 0 && !handle_set)
+		set_handle();
+
+	return submitted;
+}
+catch(const std::exception &e)
+{
+	ircd::terminate{ircd::error
+	{
+		"iou(%p) system::submit() qcount:%zu :%s",
+		this,
+		qcount,
+		e.what()
+	}};
+
+	__builtin_unreachable();
+}
+
+size_t
+ircd::fs::iou::system::enter()
+{
+	assert(qcount > 0);
+	const auto ret
+	{
+		syscall_nointr<__NR_io_uring_enter>(int(fd), qcount, 0, 0, nullptr, 0)
+	};
+
+	return ret;
+}
+
 void
 ircd::fs::iou::system::set_handle()
 try
@@ -570,7 +1167,8 @@ noexcept try
 			__builtin_unreachable();
 	}
 
-	set_handle();
+	if(in_flight > 0 && !handle_set)
+		set_handle();
 }
 catch(const ctx::interrupted &)
 {
@@ -589,7 +1187,24 @@ noexcept try
 {
 	assert(!ctx::current);
 
+	// Everything between our head and the kernel's tail is complete. The
+	// entries are read directly from the shared ring.
+	const auto &mask(*ring_mask[1]);
+	uint32_t head(*this->head[1]);
+	const uint32_t tail(__atomic_load_n(this->tail[1], __ATOMIC_ACQUIRE));
 
+	size_t count(0);
+	for(; head != tail; ++head, ++count)
+		handle_event(cqe[head & mask]);
+
+	__atomic_store_n(this->head[1], head, __ATOMIC_RELEASE);
+
+	assert(in_flight >= count);
+	in_flight -= count;
+	stats.cur_submits -= count;
+	stats.handles++;
+	if(likely(count))
+		dock.notify_all();
 }
 catch(const std::exception &e)
 {
@@ -600,3 +1215,69 @@ catch(const std::exception &e)
 		e.what()
 	};
 }
+
+void
+ircd::fs::iou::system::handle_event(const ::io_uring_cqe &cqe)
+noexcept try
+{
+	// Canceled entries were submitted as no-ops without a request.
+	auto *const request
+	{
+		reinterpret_cast<iou::request *>(cqe.user_data)
+	};
+
+	if(!request)
+		return;
+
+	assert(request->state == state::SUBMITTED);
+	request->res = cqe.res;
+	request->ec = cqe.res < 0?
+		make_error_code(-cqe.res):
+		std::error_code{};
+
+	// Notify the waiting context. Note that we are on the main async stack
+	// but it is safe to notify from here.
+	request->state = state::COMPLETED;
+	assert(request->waiter);
+	request->waiter->notify_one();
+	stats.events++;
+}
+catch(const std::exception &e)
+{
+	log::critical
+	{
+		log, "Unhandled request(%lu) event(%p) error: %s",
+		cqe.user_data,
+		&cqe,
+		e.what()
+	};
+}
+
+size_t
+ircd::fs::iou::system::request_avail()
+const
+{
+	assert(request_count() <= max_events());
+	return max_events() - request_count();
+}
+
+size_t
+ircd::fs::iou::system::request_count()
+const
+{
+	return qcount + in_flight;
+}
+
+size_t
+ircd::fs::iou::system::max_submit()
+const
+{
+	return submit_max;
+}
+
+size_t
+ircd::fs::iou::system::max_events()
+const
+{
+	return p.sq_entries;
+}
@@ -19,9 +19,16 @@ namespace ircd::fs::iou
 
 	size_t write(const fd &, const const_iovec_view &, const write_opts &);
 	size_t read(const fd &, const const_iovec_view &, const read_opts &);
+	size_t read(const vector_view<read_op> &);
 	void fsync(const fd &, const sync_opts &);
 }
 
+/// io_uring instance from the system. Like fs::aio this is a singleton
+/// maintained by fs::iou::init. Requests are written directly into the
+/// submission ring; the ring tail is published and io_uring_enter(2) is
+/// called once for everything queued by the time the chaser runs. Completions
+/// are reaped from the shared completion ring when the registered eventfd
+/// is notified, without a system call per request.
 struct ircd::fs::iou::system
 {
 	ctx::dock dock;
@@ -41,6 +48,11 @@ struct ircd::fs::iou::system
 	::io_uring_sqe *sqe;
 	::io_uring_cqe *cqe;
 
+	size_t submit_max;
+	uint32_t sq_tail {0};
+	size_t qcount {0};
+	size_t in_flight {0};
+
 	size_t ev_count;
 	asio::posix::stream_descriptor ev_fd;
 	bool handle_set;
@@ -48,10 +60,24 @@ struct ircd::fs::iou::system
 	std::unique_ptr<uint8_t[]> handle_data;
 	static ios::descriptor handle_descriptor;
 
+	size_t max_events() const;
+	size_t max_submit() const;
+	size_t request_count() const; // qcount + in_flight
+	size_t request_avail() const; // max_events - request_count()
+
+	void handle_event(const ::io_uring_cqe &) noexcept;
 	void handle_events() noexcept;
 	void handle(const boost::system::error_code &ec, const size_t bytes) noexcept;
 	void set_handle();
 
+	size_t enter();
+	size_t submit() noexcept;
+	void chase() noexcept;
+
+	bool submit(request &);
+	bool cancel(request &);
+	bool wait(request &);
+
 	bool interrupt();
 	bool wait();
 
@@ -81,6 +81,130 @@ ircd::http2::reflect(const frame::settings::code &code)
 	return "??????";
 }
 
+/// Validate a SETTINGS frame and store its values. The closure sees each
+/// known setting before it's stored, so the previous value is still there.
+/// Returns false for an acknowledgment, which has no values; otherwise the
+/// caller owes the peer an acknowledgment.
+bool
+ircd::http2::read_settings(settings &settings,
+                           const frame::header &header,
+                           const const_buffer &payload,
+                           const settings_closure &closure)
+{
+	using code = frame::settings::code;
+
+	if(unlikely(header.stream_id))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "SETTINGS on stream %u.", header.stream_id
+		};
+
+	if(header.flags & frame::settings::flag::ACK)
+	{
+		if(unlikely(!empty(payload)))
+			throw error
+			{
+				error::FRAME_SIZE_ERROR, "SETTINGS acknowledgment with payload."
+			};
+
+		return false;
+	}
+
+	if(unlikely(size(payload) % 6))
+		throw error
+		{
+			error::FRAME_SIZE_ERROR, "SETTINGS of %zu bytes.", size(payload)
+		};
+
+	const auto *const b
+	{
+		reinterpret_cast<const uint8_t *>(data(payload))
+	};
+
+	for(size_t i(0); i < size(payload); i += 6)
+	{
+		const uint16_t id
+		{
+			uint16_t(b[i] << 8 | b[i + 1])
+		};
+
+		const uint32_t value
+		{
+			uint32_t(b[i + 2]) << 24 | uint32_t(b[i + 3]) << 16 | uint32_t(b[i + 4]) << 8 | b[i + 5]
+		};
+
+		switch(id)
+		{
+			case code::ENABLE_PUSH:
+				if(unlikely(value > 1))
+					throw error
+					{
+						error::PROTOCOL_ERROR, "Invalid ENABLE_PUSH %u.", value
+					};
+				break;
+
+			case code::INITIAL_WINDOW_SIZE:
+				if(unlikely(value > 0x7fffffffU))
+					throw error
+					{
+						error::FLOW_CONTROL_ERROR, "Invalid INITIAL_WINDOW_SIZE %u.", value
+					};
+				break;
+
+			case code::MAX_FRAME_SIZE:
+				if(unlikely(value < 16384 || value > 16777215))
+					throw error
+					{
+						error::PROTOCOL_ERROR, "Invalid MAX_FRAME_SIZE %u.", value
+					};
+				break;
+
+			default:
+				break;
+		}
+
+		// Unknown settings are ignored.
+		if(!id || id >= code::_NUM_)
+			continue;
+
+		if(closure)
+			closure(code(id), value);
+
+		settings.at(id - 1) = value;
+	}
+
+	return true;
+}
+
+ircd::const_buffer
+ircd::http2::write_settings(const mutable_buffer &buf,
+                            const vector_view<const struct frame::settings::param> &params)
+{
+	assert(size(buf) >= params.size() * 6);
+	auto *const b
+	{
+		reinterpret_cast<uint8_t *>(data(buf))
+	};
+
+	size_t i(0);
+	for(const auto &param : params)
+	{
+		const uint16_t id(param.id);
+		const uint32_t value(param.value);
+		b[i++] = id >> 8;
+		b[i++] = id;
+		b[i++] = value >> 24;
+		b[i++] = value >> 16;
+		b[i++] = value >> 8;
+		b[i++] = value;
+	}
+
+	return const_buffer
+	{
+		data(buf), i
+	};
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // frame.h
@@ -88,9 +212,990 @@ ircd::http2::reflect(const frame::settings::code &code)
 
 static_assert
 (
-    sizeof(ircd::http2::frame::header) == 9
+    sizeof(ircd::http2::frame::header) == ircd::http2::frame::SIZE
 );
 
+ircd::http2::frame::header::header(const uint32_t &len,
+                                   const enum type &type,
+                                   const uint8_t &flags,
+                                   const uint32_t &stream_id)
+:len{len}
+,type{type}
+,flags{flags}
+,stream_id{stream_id}
+{
+	assert(len < (1U << 24));
+	assert(stream_id < (1U << 31));
+}
+
+ircd::http2::frame::header::header(const const_buffer &buf)
+{
+	assert(size(buf) >= frame::SIZE);
+	const auto *const b
+	{
+		reinterpret_cast<const uint8_t *>(data(buf))
+	};
+
+	len = (uint32_t(b[0]) << 16) | (uint32_t(b[1]) << 8) | b[2];
+	type = static_cast<enum type>(b[3]);
+	flags = b[4];
+	stream_id = ((uint32_t(b[5]) << 24) | (uint32_t(b[6]) << 16) | (uint32_t(b[7]) << 8) | b[8]) & 0x7fffffffU;
+}
+
+ircd::const_buffer
+ircd::http2::write(const mutable_buffer &buf,
+                   const frame::header &header)
+{
+	assert(size(buf) >= frame::SIZE);
+	auto *const b
+	{
+		reinterpret_cast<uint8_t *>(data(buf))
+	};
+
+	b[0] = header.len >> 16;
+	b[1] = header.len >> 8;
+	b[2] = header.len;
+	b[3] = header.type;
+	b[4] = header.flags;
+	b[5] = header.stream_id >> 24;
+	b[6] = header.stream_id >> 16;
+	b[7] = header.stream_id >> 8;
+	b[8] = header.stream_id;
+	return const_buffer
+	{
+		data(buf), frame::SIZE
+	};
+}
+
+/// Append a frame to the output.
+void
+ircd::http2::write(std::string &out,
+                   const frame::header &header,
+                   const const_buffer &payload)
+{
+	assert(header.len == size(payload));
+	char buf[frame::SIZE];
+	out.append(data(write(buf, header)), frame::SIZE);
+	out.append(data(payload), size(payload));
+}
+
+/// Append a header block split into a HEADERS frame and CONTINUATION frames
+/// of the peer's maximum; the frames must be written together so no other
+/// frame comes between them.
+void
+ircd::http2::write_headers(std::string &out,
+                           const const_buffer &block,
+                           const uint32_t &stream_id,
+                           const size_t &max_frame,
+                           const bool &end_stream)
+{
+	assert(max_frame);
+	out.reserve(out.size() + size(block) + (size(block) / max_frame + 1) * frame::SIZE);
+	for(size_t off(0); !off || off < size(block); off += max_frame)
+	{
+		const size_t len(std::min(size(block) - off, max_frame));
+		const bool last(off + len == size(block));
+		const uint8_t flags
+		(
+			(last? frame::END_HEADERS : 0) |
+			(!off && end_stream? frame::END_STREAM : 0)
+		);
+
+		const frame::type type(!off? frame::HEADERS : frame::CONTINUATION);
+		write(out, {uint32_t(len), type, flags, stream_id}, {data(block) + off, len});
+		if(last)
+			break;
+	}
+}
+
+ircd::const_buffer
+ircd::http2::write_window(const mutable_buffer &buf,
+                          const uint32_t &increment)
+{
+	assert(size(buf) >= 4);
+	assert(increment && increment <= 0x7fffffffU);
+	auto *const b
+	{
+		reinterpret_cast<uint8_t *>(data(buf))
+	};
+
+	b[0] = increment >> 24;
+	b[1] = increment >> 16;
+	b[2] = increment >> 8;
+	b[3] = increment;
+	return const_buffer
+	{
+		data(buf), 4
+	};
+}
+
+ircd::const_buffer
+ircd::http2::write_reset(const mutable_buffer &buf,
+                         const enum error::code &code)
+{
+	assert(size(buf) >= 4);
+	auto *const b
+	{
+		reinterpret_cast<uint8_t *>(data(buf))
+	};
+
+	b[0] = code >> 24;
+	b[1] = code >> 16;
+	b[2] = code >> 8;
+	b[3] = code;
+	return const_buffer
+	{
+		data(buf), 4
+	};
+}
+
+ircd::const_buffer
+ircd::http2::write_goaway(const mutable_buffer &buf,
+                          const uint32_t &last_stream,
+                          const enum error::code &code)
+{
+	assert(size(buf) >= 8);
+	auto *const b
+	{
+		reinterpret_cast<uint8_t *>(data(buf))
+	};
+
+	b[0] = last_stream >> 24;
+	b[1] = last_stream >> 16;
+	b[2] = last_stream >> 8;
+	b[3] = last_stream;
+	write_reset(mutable_buffer{data(buf) + 4, 4}, code);
+	return const_buffer
+	{
+		data(buf), 8
+	};
+}
+
+/// Give each complete frame at the front of the buffer to the closure,
+/// consuming it; a partial frame is left in the buffer for more input.
+/// We don't raise MAX_FRAME_SIZE from the default, so a larger frame is
+/// an error of the connection.
+size_t
+ircd::http2::read_frames(const_buffer &in,
+                         const frame_closure &closure)
+{
+	size_t ret(0);
+	while(size(in) >= frame::SIZE)
+	{
+		const frame::header header
+		{
+			in
+		};
+
+		if(unlikely(header.len > 16384))
+			throw error
+			{
+				error::FRAME_SIZE_ERROR, "Frame of %u bytes exceeds the maximum.",
+				uint(header.len),
+			};
+
+		if(size(in) < frame::SIZE + header.len)
+			break;
+
+		const const_buffer payload
+		{
+			data(in) + frame::SIZE, header.len
+		};
+
+		consume(in, frame::SIZE + header.len);
+		closure(header, payload);
+		++ret;
+	}
+
+	return ret;
+}
+
+/// The content of a DATA frame without its padding.
+ircd::const_buffer
+ircd::http2::read_data(const frame::header &header,
+                       const const_buffer &payload)
+{
+	if(unlikely(!header.stream_id))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "DATA on stream 0."
+		};
+
+	if(~header.flags & frame::PADDED)
+		return payload;
+
+	const size_t pad
+	{
+		!empty(payload)? uint8_t(*data(payload)) : 0U
+	};
+
+	if(unlikely(empty(payload) || pad >= size(payload)))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "Padding exceeds DATA."
+		};
+
+	return const_buffer
+	{
+		data(payload) + 1, size(payload) - 1 - pad
+	};
+}
+
+/// The increment of a WINDOW_UPDATE frame; zero is left to the caller,
+/// which is an error of the connection or of the stream.
+uint32_t
+ircd::http2::read_window(const frame::header &header,
+                         const const_buffer &payload)
+{
+	if(unlikely(size(payload) != 4))
+		throw error
+		{
+			error::FRAME_SIZE_ERROR, "WINDOW_UPDATE of %zu bytes.", size(payload)
+		};
+
+	const auto *const b
+	{
+		reinterpret_cast<const uint8_t *>(data(payload))
+	};
+
+	return (uint32_t(b[0]) << 24 | uint32_t(b[1]) << 16 | uint32_t(b[2]) << 8 | b[3]) & 0x7fffffffU;
+}
+
+enum ircd::http2::error::code
+ircd::http2::read_reset(const frame::header &header,
+                        const const_buffer &payload)
+{
+	if(unlikely(size(payload) != 4 || !header.stream_id))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "Invalid RST_STREAM."
+		};
+
+	const auto *const b
+	{
+		reinterpret_cast<const uint8_t *>(data(payload))
+	};
+
+	return (enum error::code)(uint32_t(b[0]) << 24 | uint32_t(b[1]) << 16 | uint32_t(b[2]) << 8 | b[3]);
+}
+
+/// The last stream processed by a peer going away.
+uint32_t
+ircd::http2::read_goaway(const frame::header &header,
+                         const const_buffer &payload)
+{
+	if(unlikely(size(payload) < 8 || header.stream_id))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "Invalid GOAWAY."
+		};
+
+	const auto *const b
+	{
+		reinterpret_cast<const uint8_t *>(data(payload))
+	};
+
+	return (uint32_t(b[0]) << 24 | uint32_t(b[1]) << 16 | uint32_t(b[2]) << 8 | b[3]) & 0x7fffffffU;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// block.h
+//
+
+void
+ircd::http2::block::expect(const frame::header &header)
+const
+{
+	if(stream_id && (header.type != frame::CONTINUATION || header.stream_id != stream_id))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "Expected CONTINUATION of stream %u.", stream_id
+		};
+}
+
+/// Take a HEADERS or CONTINUATION frame; true when the block is complete.
+/// A block larger than max is an error of the connection since the state
+/// of the decoder depends on every block.
+bool
+ircd::http2::block::operator()(const frame::header &header,
+                               const const_buffer &payload,
+                               const size_t &max)
+{
+	expect(header);
+	if(header.type == frame::CONTINUATION)
+	{
+		if(unlikely(!stream_id))
+			throw error
+			{
+				error::PROTOCOL_ERROR, "Unexpected CONTINUATION."
+			};
+
+		if(unlikely(buf.size() + size(payload) > max))
+			throw error
+			{
+				error::ENHANCE_YOUR_CALM, "Header block too large."
+			};
+
+		buf.append(data(payload), size(payload));
+		if(header.flags & frame::END_HEADERS)
+			stream_id = 0;
+
+		return !stream_id;
+	}
+
+	assert(header.type == frame::HEADERS);
+	if(unlikely(!header.stream_id))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "HEADERS on stream 0."
+		};
+
+	const_buffer fragment{payload};
+	size_t pad(0);
+	if(header.flags & frame::PADDED)
+	{
+		if(unlikely(empty(fragment)))
+			throw error
+			{
+				error::PROTOCOL_ERROR, "Truncated HEADERS."
+			};
+
+		pad = uint8_t(*data(fragment));
+		consume(fragment, 1);
+	}
+
+	if(header.flags & frame::PRIORITIZED)
+	{
+		if(unlikely(size(fragment) < 5))
+			throw error
+			{
+				error::PROTOCOL_ERROR, "Truncated HEADERS."
+			};
+
+		consume(fragment, 5);
+	}
+
+	if(unlikely(pad > size(fragment)))
+		throw error
+		{
+			error::PROTOCOL_ERROR, "Padding exceeds HEADERS."
+		};
+
+	if(unlikely(size(fragment) - pad > max))
+		throw error
+		{
+			error::ENHANCE_YOUR_CALM, "Header block too large."
+		};
+
+	buf.assign(data(fragment), size(fragment) - pad);
+	flags = header.flags;
+	stream_id = header.flags & frame::END_HEADERS? 0U : uint32_t(header.stream_id);
+	return !stream_id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// hpack.h
+//
+
+namespace ircd::http2
+{
+	struct huffman;
+
+	extern const std::pair<uint32_t, uint8_t> huffman_code[257];
+	extern const huffman huffman_table;
+}
+
+/// The code of RFC 7541 Appendix B is canonical: the codes of each length
+/// are consecutive and ordered by symbol. Decoding only needs the first code
+/// and first symbol of each length.
+struct ircd::http2::huffman
+{
+	static constexpr const size_t LEN_MAX {30};
+
+	std::array<uint16_t, 257> symbol {0};
+	std::array<uint32_t, LEN_MAX + 1> first_code {0};
+	std::array<uint16_t, LEN_MAX + 1> first_index {0};
+	std::array<uint16_t, LEN_MAX + 1> count {0};
+
+	string_view operator()(const const_buffer &in, std::string &out) const;
+
+	huffman();
+};
+
+decltype(ircd::http2::huffman_table)
+ircd::http2::huffman_table;
+
+ircd::http2::huffman::huffman()
+{
+	for(size_t i(0); i < 257; ++i)
+		count.at(huffman_code[i].second)++;
+
+	size_t idx(0);
+	for(size_t len(1); len <= LEN_MAX; ++len)
+	{
+		first_index[len] = idx;
+		first_code[len] = -1U;
+		for(size_t i(0); i < 257; ++i)
+			if(huffman_code[i].second == len)
+			{
+				first_code[len] = std::min(first_code[len], huffman_code[i].first);
+				symbol[idx++] = i;
+			}
+	}
+
+	assert(idx == 257);
+}
+
+ircd::string_view
+ircd::http2::huffman::operator()(const const_buffer &in,
+                                 std::string &out)
+const
+{
+	out.clear();
+	out.reserve(size(in) * 8 / 5);
+
+	uint32_t code(0);
+	size_t len(0);
+	for(size_t i(0); i < size(in); ++i)
+		for(int bit(7); bit >= 0; --bit)
+		{
+			code = (code << 1) | ((uint8_t(data(in)[i]) >> bit) & 1U);
+			++len;
+			if(len > LEN_MAX)
+				throw error
+				{
+					error::COMPRESSION_ERROR, "Invalid huffman code."
+				};
+
+			if(!count[len] || code < first_code[len] || code - first_code[len] >= count[len])
+				continue;
+
+			const auto &sym
+			{
+				symbol[first_index[len] + code - first_code[len]]
+			};
+
+			if(unlikely(sym == 256))
+				throw error
+				{
+					error::COMPRESSION_ERROR, "EOS in huffman string."
+				};
+
+			out.push_back(char(sym));
+			code = 0;
+			len = 0;
+		}
+
+	// RFC 7541 5.2 padding is the most significant bits of EOS and shorter
+	// than one octet.
+	if(unlikely(len > 7 || code != (1U << len) - 1))
+		throw error
+		{
+			error::COMPRESSION_ERROR, "Invalid huffman padding."
+		};
+
+	return out;
+}
+
+decltype(ircd::http2::huffman_code)
+ircd::http2::huffman_code
+{
+	{ 0x00001ff8, 13 }, { 0x007fffd8, 23 }, { 0x0fffffe2, 28 }, { 0x0fffffe3, 28 },
+	{ 0x0fffffe4, 28 }, { 0x0fffffe5, 28 }, { 0x0fffffe6, 28 }, { 0x0fffffe7, 28 },
+	{ 0x0fffffe8, 28 }, { 0x00ffffea, 24 }, { 0x3ffffffc, 30 }, { 0x0fffffe9, 28 },
+	{ 0x0fffffea, 28 }, { 0x3ffffffd, 30 }, { 0x0fffffeb, 28 }, { 0x0fffffec, 28 },
+	{ 0x0fffffed, 28 }, { 0x0fffffee, 28 }, { 0x0fffffef, 28 }, { 0x0ffffff0, 28 },
+	{ 0x0ffffff1, 28 }, { 0x0ffffff2, 28 }, { 0x3ffffffe, 30 }, { 0x0ffffff3, 28 },
+	{ 0x0ffffff4, 28 }, { 0x0ffffff5, 28 }, { 0x0ffffff6, 28 }, { 0x0ffffff7, 28 },
+	{ 0x0ffffff8, 28 }, { 0x0ffffff9, 28 }, { 0x0ffffffa, 28 }, { 0x0ffffffb, 28 },
+	{ 0x00000014,  6 }, { 0x000003f8, 10 }, { 0x000003f9, 10 }, { 0x00000ffa, 12 },
+	{ 0x00001ff9, 13 }, { 0x00000015,  6 }, { 0x000000f8,  8 }, { 0x000007fa, 11 },
+	{ 0x000003fa, 10 }, { 0x000003fb, 10 }, { 0x000000f9,  8 }, { 0x000007fb, 11 },
+	{ 0x000000fa,  8 }, { 0x00000016,  6 }, { 0x00000017,  6 }, { 0x00000018,  6 },
+	{ 0x00000000,  5 }, { 0x00000001,  5 }, { 0x00000002,  5 }, { 0x00000019,  6 },
+	{ 0x0000001a,  6 }, { 0x0000001b,  6 }, { 0x0000001c,  6 }, { 0x0000001d,  6 },
+	{ 0x0000001e,  6 }, { 0x0000001f,  6 }, { 0x0000005c,  7 }, { 0x000000fb,  8 },
+	{ 0x00007ffc, 15 }, { 0x00000020,  6 }, { 0x00000ffb, 12 }, { 0x000003fc, 10 },
+	{ 0x00001ffa, 13 }, { 0x00000021,  6 }, { 0x0000005d,  7 }, { 0x0000005e,  7 },
+	{ 0x0000005f,  7 }, { 0x00000060,  7 }, { 0x00000061,  7 }, { 0x00000062,  7 },
+	{ 0x00000063,  7 }, { 0x00000064,  7 }, { 0x00000065,  7 }, { 0x00000066,  7 },
+	{ 0x00000067,  7 }, { 0x00000068,  7 }, { 0x00000069,  7 }, { 0x0000006a,  7 },
+	{ 0x0000006b,  7 }, { 0x0000006c,  7 }, { 0x0000006d,  7 }, { 0x0000006e,  7 },
+	{ 0x0000006f,  7 }, { 0x00000070,  7 }, { 0x00000071,  7 }, { 0x00000072,  7 },
+	{ 0x000000fc,  8 }, { 0x00000073,  7 }, { 0x000000fd,  8 }, { 0x00001ffb, 13 },
+	{ 0x0007fff0, 19 }, { 0x00001ffc, 13 }, { 0x00003ffc, 14 }, { 0x00000022,  6 },
+	{ 0x00007ffd, 15 }, { 0x00000003,  5 }, { 0x00000023,  6 }, { 0x00000004,  5 },
+	{ 0x00000024,  6 }, { 0x00000005,  5 }, { 0x00000025,  6 }, { 0x00000026,  6 },
+	{ 0x00000027,  6 }, { 0x00000006,  5 }, { 0x00000074,  7 }, { 0x00000075,  7 },
+	{ 0x00000028,  6 }, { 0x00000029,  6 }, { 0x0000002a,  6 }, { 0x00000007,  5 },
+	{ 0x0000002b,  6 }, { 0x00000076,  7 }, { 0x0000002c,  6 }, { 0x00000008,  5 },
+	{ 0x00000009,  5 }, { 0x0000002d,  6 }, { 0x00000077,  7 }, { 0x00000078,  7 },
+	{ 0x00000079,  7 }, { 0x0000007a,  7 }, { 0x0000007b,  7 }, { 0x00007ffe, 15 },
+	{ 0x000007fc, 11 }, { 0x00003ffd, 14 }, { 0x00001ffd, 13 }, { 0x0ffffffc, 28 },
+	{ 0x000fffe6, 20 }, { 0x003fffd2, 22 }, { 0x000fffe7, 20 }, { 0x000fffe8, 20 },
+	{ 0x003fffd3, 22 }, { 0x003fffd4, 22 }, { 0x003fffd5, 22 }, { 0x007fffd9, 23 },
+	{ 0x003fffd6, 22 }, { 0x007fffda, 23 }, { 0x007fffdb, 23 }, { 0x007fffdc, 23 },
+	{ 0x007fffdd, 23 }, { 0x007fffde, 23 }, { 0x00ffffeb, 24 }, { 0x007fffdf, 23 },
+	{ 0x00ffffec, 24 }, { 0x00ffffed, 24 }, { 0x003fffd7, 22 }, { 0x007fffe0, 23 },
+	{ 0x00ffffee, 24 }, { 0x007fffe1, 23 }, { 0x007fffe2, 23 }, { 0x007fffe3, 23 },
+	{ 0x007fffe4, 23 }, { 0x001fffdc, 21 }, { 0x003fffd8, 22 }, { 0x007fffe5, 23 },
+	{ 0x003fffd9, 22 }, { 0x007fffe6, 23 }, { 0x007fffe7, 23 }, { 0x00ffffef, 24 },
+	{ 0x003fffda, 22 }, { 0x001fffdd, 21 }, { 0x000fffe9, 20 }, { 0x003fffdb, 22 },
+	{ 0x003fffdc, 22 }, { 0x007fffe8, 23 }, { 0x007fffe9, 23 }, { 0x001fffde, 21 },
+	{ 0x007fffea, 23 }, { 0x003fffdd, 22 }, { 0x003fffde, 22 }, { 0x00fffff0, 24 },
+	{ 0x001fffdf, 21 }, { 0x003fffdf, 22 }, { 0x007fffeb, 23 }, { 0x007fffec, 23 },
+	{ 0x001fffe0, 21 }, { 0x001fffe1, 21 }, { 0x003fffe0, 22 }, { 0x001fffe2, 21 },
+	{ 0x007fffed, 23 }, { 0x003fffe1, 22 }, { 0x007fffee, 23 }, { 0x007fffef, 23 },
+	{ 0x000fffea, 20 }, { 0x003fffe2, 22 }, { 0x003fffe3, 22 }, { 0x003fffe4, 22 },
+	{ 0x007ffff0, 23 }, { 0x003fffe5, 22 }, { 0x003fffe6, 22 }, { 0x007ffff1, 23 },
+	{ 0x03ffffe0, 26 }, { 0x03ffffe1, 26 }, { 0x000fffeb, 20 }, { 0x0007fff1, 19 },
+	{ 0x003fffe7, 22 }, { 0x007ffff2, 23 }, { 0x003fffe8, 22 }, { 0x01ffffec, 25 },
+	{ 0x03ffffe2, 26 }, { 0x03ffffe3, 26 }, { 0x03ffffe4, 26 }, { 0x07ffffde, 27 },
+	{ 0x07ffffdf, 27 }, { 0x03ffffe5, 26 }, { 0x00fffff1, 24 }, { 0x01ffffed, 25 },
+	{ 0x0007fff2, 19 }, { 0x001fffe3, 21 }, { 0x03ffffe6, 26 }, { 0x07ffffe0, 27 },
+	{ 0x07ffffe1, 27 }, { 0x03ffffe7, 26 }, { 0x07ffffe2, 27 }, { 0x00fffff2, 24 },
+	{ 0x001fffe4, 21 }, { 0x001fffe5, 21 }, { 0x03ffffe8, 26 }, { 0x03ffffe9, 26 },
+	{ 0x0ffffffd, 28 }, { 0x07ffffe3, 27 }, { 0x07ffffe4, 27 }, { 0x07ffffe5, 27 },
+	{ 0x000fffec, 20 }, { 0x00fffff3, 24 }, { 0x000fffed, 20 }, { 0x001fffe6, 21 },
+	{ 0x003fffe9, 22 }, { 0x001fffe7, 21 }, { 0x001fffe8, 21 }, { 0x007ffff3, 23 },
+	{ 0x003fffea, 22 }, { 0x003fffeb, 22 }, { 0x01ffffee, 25 }, { 0x01ffffef, 25 },
+	{ 0x00fffff4, 24 }, { 0x00fffff5, 24 }, { 0x03ffffea, 26 }, { 0x007ffff4, 23 },
+	{ 0x03ffffeb, 26 }, { 0x07ffffe6, 27 }, { 0x03ffffec, 26 }, { 0x03ffffed, 26 },
+	{ 0x07ffffe7, 27 }, { 0x07ffffe8, 27 }, { 0x07ffffe9, 27 }, { 0x07ffffea, 27 },
+	{ 0x07ffffeb, 27 }, { 0x0ffffffe, 28 }, { 0x07ffffec, 27 }, { 0x07ffffed, 27 },
+	{ 0x07ffffee, 27 }, { 0x07ffffef, 27 }, { 0x07fffff0, 27 }, { 0x03ffffee, 26 },
+	{ 0x3fffffff, 30 },
+};
+
+decltype(ircd::http2::hpack::static_table)
+ircd::http2::hpack::static_table
+{
+	{ ":authority",                  ""               },
+	{ ":method",                     "GET"            },
+	{ ":method",                     "POST"           },
+	{ ":path",                       "/"              },
+	{ ":path",                       "/index.html"    },
+	{ ":scheme",                     "http"           },
+	{ ":scheme",                     "https"          },
+	{ ":status",                     "200"            },
+	{ ":status",                     "204"            },
+	{ ":status",                     "206"            },
+	{ ":status",                     "304"            },
+	{ ":status",                     "400"            },
+	{ ":status",                     "404"            },
+	{ ":status",                     "500"            },
+	{ "accept-charset",              ""               },
+	{ "accept-encoding",             "gzip, deflate"  },
+	{ "accept-language",             ""               },
+	{ "accept-ranges",               ""               },
+	{ "accept",                      ""               },
+	{ "access-control-allow-origin", ""               },
+	{ "age",                         ""               },
+	{ "allow",                       ""               },
+	{ "authorization",               ""               },
+	{ "cache-control",               ""               },
+	{ "content-disposition",         ""               },
+	{ "content-encoding",            ""               },
+	{ "content-language",            ""               },
+	{ "content-length",              ""               },
+	{ "content-location",            ""               },
+	{ "content-range",               ""               },
+	{ "content-type",                ""               },
+	{ "cookie",                      ""               },
+	{ "date",                        ""               },
+	{ "etag",                        ""               },
+	{ "expect",                      ""               },
+	{ "expires",                     ""               },
+	{ "from",                        ""               },
+	{ "host",                        ""               },
+	{ "if-match",                    ""               },
+	{ "if-modified-since",           ""               },
+	{ "if-none-match",               ""               },
+	{ "if-range",                    ""               },
+	{ "if-unmodified-since",         ""               },
+	{ "last-modified",               ""               },
+	{ "link",                        ""               },
+	{ "location",                    ""               },
+	{ "max-forwards",                ""               },
+	{ "proxy-authenticate",          ""               },
+	{ "proxy-authorization",         ""               },
+	{ "range",                       ""               },
+	{ "referer",                     ""               },
+	{ "refresh",                     ""               },
+	{ "retry-after",                 ""               },
+	{ "server",                      ""               },
+	{ "set-cookie",                  ""               },
+	{ "strict-transport-security",   ""               },
+	{ "transfer-encoding",           ""               },
+	{ "user-agent",                  ""               },
+	{ "vary",                        ""               },
+	{ "via",                         ""               },
+	{ "www-authenticate",            ""               },
+};
+
+/// Decode the header block; the closure is called with each field. The
+/// views given to the closure are only valid for the call.
+bool
+ircd::http2::hpack::operator()(const const_buffer &block,
+                               const closure &closure,
+                               const size_t &list_max)
+{
+	std::string namebuf, valbuf;
+	const_buffer in{block};
+	size_t list_size(0);
+	const auto field{[&closure, &list_max, &list_size]
+	(const string_view &name, const string_view &value)
+	{
+		list_size += size(name) + size(value) + 32;
+		if(likely(list_size <= list_max))
+			closure(name, value);
+	}};
+
+	bool first(true);
+	while(!empty(in))
+	{
+		const uint8_t &byte(*data(in));
+
+		// 6.1 Indexed Header Field
+		if(byte & 0x80)
+		{
+			const auto &[name, value]
+			{
+				at(read_integer(in, 7))
+			};
+
+			field(name, value);
+			first = false;
+			continue;
+		}
+
+		// 6.3 Dynamic Table Size Update; only at the start of the block.
+		if((byte & 0xe0) == 0x20)
+		{
+			const auto max
+			{
+				read_integer(in, 5)
+			};
+
+			if(unlikely(!first || max > dynamic_limit))
+				throw error
+				{
+					error::COMPRESSION_ERROR, "Invalid dynamic table size update."
+				};
+
+			dynamic_max = max;
+			evict(dynamic_max);
+			continue;
+		}
+
+		// 6.2.1 Literal with Incremental Indexing; 6.2.2 without indexing;
+		// 6.2.3 never indexed.
+		const bool indexing
+		{
+			(byte & 0xc0) == 0x40
+		};
+
+		const auto index
+		{
+			read_integer(in, indexing? 6 : 4)
+		};
+
+		const string_view name
+		{
+			index?
+				at(index).first:
+				read_string(in, namebuf)
+		};
+
+		if(index)
+			namebuf.assign(begin(name), end(name));
+
+		const string_view value
+		{
+			read_string(in, valbuf)
+		};
+
+		if(indexing)
+			insert(namebuf, value);
+
+		field(namebuf, value);
+		first = false;
+	}
+
+	return list_size <= list_max;
+}
+
+/// A token of lowercase characters, or a pseudo-header: a token after a
+/// leading colon.
+bool
+ircd::http2::valid_field_name(const string_view &name)
+{
+	const string_view token
+	{
+		startswith(name, ':')?
+			string_view{name.substr(1)}:
+			name
+	};
+
+	if(unlikely(empty(token)))
+		return false;
+
+	return std::all_of(begin(token), end(token), []
+	(const char &c)
+	{
+		return c > 0x20 && c < 0x7f && !(c >= 'A' && c <= 'Z') &&
+			!strchr("\"(),/:;<=>?@[\\]{}", c);
+	});
+}
+
+/// Values can't break out of their line once the message is translated to
+/// HTTP/1.1.
+bool
+ircd::http2::valid_field_value(const string_view &value)
+{
+	return std::none_of(begin(value), end(value), []
+	(const char &c)
+	{
+		return c == '\0' || c == '\r' || c == '\n';
+	});
+}
+
+ircd::http2::hpack::field
+ircd::http2::hpack::at(const size_t &index)
+const
+{
+	if(likely(index && index <= std::size(static_table)))
+		return static_table[index - 1];
+
+	const size_t pos
+	{
+		index - std::size(static_table) - 1
+	};
+
+	if(unlikely(!index || pos >= dynamic.size()))
+		throw error
+		{
+			error::COMPRESSION_ERROR, "Header index %zu out of range.", index
+		};
+
+	return dynamic.at(pos);
+}
+
+void
+ircd::http2::hpack::insert(const string_view &name,
+                           const string_view &value)
+{
+	// RFC 7541 4.1 the size of an entry includes 32 octets of overhead.
+	const size_t size
+	{
+		ircd::size(name) + ircd::size(value) + 32
+	};
+
+	// 4.4 an entry larger than the table empties it and is not added.
+	evict(size <= dynamic_max? dynamic_max - size : 0);
+	if(size > dynamic_max)
+		return;
+
+	dynamic.emplace_front(std::string(name), std::string(value));
+	dynamic_size += size;
+}
+
+void
+ircd::http2::hpack::evict(const size_t &max)
+{
+	while(dynamic_size > max && !dynamic.empty())
+	{
+		const auto &[name, value]
+		{
+			dynamic.back()
+		};
+
+		dynamic_size -= ircd::size(name) + ircd::size(value) + 32;
+		dynamic.pop_back();
+	}
+}
+
+uint64_t
+ircd::http2::hpack::read_integer(const_buffer &in,
+                                 const uint8_t &bits)
+{
+	const uint8_t mask
+	{
+		uint8_t((1U << bits) - 1)
+	};
+
+	if(unlikely(empty(in)))
+		throw error
+		{
+			error::COMPRESSION_ERROR, "Truncated integer."
+		};
+
+	uint64_t ret(uint8_t(*data(in)) & mask);
+	consume(in, 1);
+	if(ret < mask)
+		return ret;
+
+	for(uint m(0); m <= 56; m += 7)
+	{
+		if(unlikely(empty(in)))
+			break;
+
+		const uint8_t &byte(*data(in));
+		consume(in, 1);
+		ret += uint64_t(byte & 0x7f) << m;
+		if(~byte & 0x80)
+			return ret;
+	}
+
+	throw error
+	{
+		error::COMPRESSION_ERROR, "Invalid integer."
+	};
+}
+
+ircd::string_view
+ircd::http2::hpack::read_string(const_buffer &in,
+                                std::string &buf)
+{
+	if(unlikely(empty(in)))
+		throw error
+		{
+			error::COMPRESSION_ERROR, "Truncated string."
+		};
+
+	const bool huffman
+	{
+		bool(*data(in) & 0x80)
+	};
+
+	const auto len
+	{
+		read_integer(in, 7)
+	};
+
+	if(unlikely(len > size(in)))
+		throw error
+		{
+			error::COMPRESSION_ERROR, "String length %lu exceeds the block.", len
+		};
+
+	const const_buffer str
+	{
+		data(in), len
+	};
+
+	consume(in, len);
+	if(huffman)
+		return huffman_table(str, buf);
+
+	buf.assign(data(str), size(str));
+	return buf;
+}
+
+size_t
+ircd::http2::hpack::write_integer(const mutable_buffer &out,
+                                  const uint8_t &prefix,
+                                  const uint8_t &bits,
+                                  const uint64_t &value)
+{
+	const uint8_t mask
+	{
+		uint8_t((1U << bits) - 1)
+	};
+
+	size_t i(0);
+	auto *const b
+	{
+		reinterpret_cast<uint8_t *>(data(out))
+	};
+
+	if(unlikely(size(out) < 1))
+		throw error
+		{
+			"Insufficient buffer for header integer."
+		};
+
+	if(value < mask)
+	{
+		b[i++] = prefix | value;
+		return i;
+	}
+
+	b[i++] = prefix | mask;
+	uint64_t rem(value - mask);
+	for(; rem >= 0x80; rem >>= 7)
+	{
+		if(unlikely(i >= size(out)))
+			throw error
+			{
+				"Insufficient buffer for header integer."
+			};
+
+		b[i++] = 0x80 | (rem & 0x7f);
+	}
+
+	if(unlikely(i >= size(out)))
+		throw error
+		{
+			"Insufficient buffer for header integer."
+		};
+
+	b[i++] = rem;
+	return i;
+}
+
+/// 6.2.2 Literal Header Field without Indexing -- New Name
+size_t
+ircd::http2::hpack::write_literal(const mutable_buffer &out_,
+                                  const string_view &name,
+                                  const string_view &value)
+{
+	mutable_buffer out{out_};
+	consume(out, write_integer(out, 0x00, 4, 0));
+	consume(out, write_integer(out, 0x00, 7, size(name)));
+	if(unlikely(size(out) < size(name)))
+		throw error
+		{
+			"Insufficient buffer for header name."
+		};
+
+	// Header names are lowercase in HTTP/2.
+	for(size_t i(0); i < size(name); ++i)
+		data(out)[i] = tolower(name[i]);
+
+	consume(out, size(name));
+	consume(out, write_integer(out, 0x00, 7, size(value)));
+	if(unlikely(size(out) < size(value)))
+		throw error
+		{
+			"Insufficient buffer for header value."
+		};
+
+	consume(out, copy(out, value));
+	return std::distance(data(out_), data(out));
+}
+
+/// 6.2.2 Literal Header Field without Indexing -- Indexed Name
+size_t
+ircd::http2::hpack::write_literal(const mutable_buffer &out_,
+                                  const uint8_t &index,
+                                  const string_view &value)
+{
+	mutable_buffer out{out_};
+	consume(out, write_integer(out, 0x00, 4, index));
+	consume(out, write_integer(out, 0x00, 7, size(value)));
+	if(unlikely(size(out) < size(value)))
+		throw error
+		{
+			"Insufficient buffer for header value."
+		};
+
+	consume(out, copy(out, value));
+	return std::distance(data(out_), data(out));
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //
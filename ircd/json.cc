@@ -8,6 +8,8 @@
 // copyright notice and this permission notice is present in all copies. The
 // full license for this software is available in the LICENSE file.
 
+#include <ircd/simd.h>
+
 namespace ircd { namespace json
 __attribute__((visibility("hidden")))
 {
@@ -16,6 +18,18 @@ __attribute__((visibility("hidden")))
 	struct input;
 	struct output;
 
+	// Structural scanner
+	#if defined(IRCD_SIMD) && defined(__AVX2__)
+	using structural_block = u256x1;
+	#elif defined(IRCD_SIMD) && defined(__SSE2__)
+	using structural_block = u128x1;
+	#else
+	using structural_block = u64;
+	#endif
+	static u64 structural(const char *, const char *);
+	static const char *scan(const char *, const char *);
+	static string_view scan_value(const char *&, const char *);
+
 	// Instantiations of the grammars
 	struct parser extern const parser;
 	struct printer extern const printer;
@@ -2443,6 +2457,183 @@ const
 	return { string_view::end(), string_view::end() };
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// json/scan (internal)
+//
+
+/// Yields a mask with a bit set for each quote, backslash, brace or bracket
+/// in the block at start; the block is the width of the widest vector the
+/// target supports, or less at the end of the input.
+ircd::u64
+ircd::json::structural(const char *const start,
+                       const char *const stop)
+{
+	const size_t count
+	{
+		std::min(size_t(stop - start), sizeof(structural_block))
+	};
+
+	#if defined(IRCD_SIMD) && defined(__AVX2__)
+	if(likely(count == sizeof(u256x1)))
+	{
+		// '[' and ']' are folded into '{' and '}' by setting bit 5.
+		const u256x1 in     { _mm256_loadu_si256(reinterpret_cast<const u256x1_u *>(start)) };
+		const u256x1 fold   { _mm256_or_si256(in, _mm256_set1_epi8(0x20))                   };
+		const u256x1 quote  { _mm256_cmpeq_epi8(in, _mm256_set1_epi8('"'))                   };
+		const u256x1 escape { _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\\'))                  };
+		const u256x1 open   { _mm256_cmpeq_epi8(fold, _mm256_set1_epi8('{'))                 };
+		const u256x1 close  { _mm256_cmpeq_epi8(fold, _mm256_set1_epi8('}'))                 };
+		const u256x1 str    { _mm256_or_si256(quote, escape)                                 };
+		const u256x1 nest   { _mm256_or_si256(open, close)                                   };
+		return u32(_mm256_movemask_epi8(_mm256_or_si256(str, nest)));
+	}
+	#elif defined(IRCD_SIMD) && defined(__SSE2__)
+	if(likely(count == sizeof(u128x1)))
+	{
+		// '[' and ']' are folded into '{' and '}' by setting bit 5.
+		const u128x1 in     { _mm_loadu_si128(reinterpret_cast<const u128x1_u *>(start))    };
+		const u128x1 fold   { _mm_or_si128(in, _mm_set1_epi8(0x20))                         };
+		const u128x1 quote  { _mm_cmpeq_epi8(in, _mm_set1_epi8('"'))                         };
+		const u128x1 escape { _mm_cmpeq_epi8(in, _mm_set1_epi8('\\'))                        };
+		const u128x1 open   { _mm_cmpeq_epi8(fold, _mm_set1_epi8('{'))                       };
+		const u128x1 close  { _mm_cmpeq_epi8(fold, _mm_set1_epi8('}'))                       };
+		const u128x1 str    { _mm_or_si128(quote, escape)                                    };
+		const u128x1 nest   { _mm_or_si128(open, close)                                      };
+		return u16(_mm_movemask_epi8(_mm_or_si128(str, nest)));
+	}
+	#endif
+
+	u64 ret(0);
+	for(size_t i(0); i < count; ++i)
+		switch(start[i])
+		{
+			case '"':
+			case '\\':
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+				ret |= u64(1) << i;
+				continue;
+		}
+
+	return ret;
+}
+
+/// Find the end of the string, object or array starting at start. Only the
+/// structural characters are visited: the input is indexed a block at a time
+/// and the bits of each block's mask are walked to track the string state and
+/// nesting depth. Nothing else is validated. Returns nullptr if the value is
+/// not terminated before stop.
+const char *
+ircd::json::scan(const char *const start,
+                 const char *const stop)
+{
+	assert(start < stop);
+	assert(*start == '"' || *start == '{' || *start == '[');
+
+	ssize_t depth(0);
+	bool quoted(false);
+	const char *escaped(nullptr);
+	for(auto block(start); block < stop; block += sizeof(structural_block))
+	{
+		for(u64 mask(structural(block, stop)); mask; mask &= mask - 1)
+		{
+			const char *const pos
+			{
+				block + __builtin_ctzll(mask)
+			};
+
+			if(quoted)
+			{
+				if(pos == escaped)
+					continue;
+
+				if(*pos == '\\')
+					escaped = pos + 1;
+
+				else if(*pos == '"')
+					quoted = false;
+
+				else
+					continue;
+
+				if(!quoted && depth == 0)
+					return pos + 1;
+
+				continue;
+			}
+
+			switch(*pos)
+			{
+				case '"':
+					quoted = true;
+					continue;
+
+				case '{':
+				case '[':
+					++depth;
+					continue;
+
+				case '}':
+				case ']':
+					if(--depth == 0)
+						return pos + 1;
+
+					if(unlikely(depth < 0))
+						return nullptr;
+
+					continue;
+
+				default:
+					return nullptr;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+/// Parse the value at start and advance start past it. Strings, objects and
+/// arrays are delimited by the structural scan; their content is not parsed
+/// until accessed. Other values are parsed by the grammar.
+ircd::string_view
+ircd::json::scan_value(const char *&start,
+                       const char *const stop)
+{
+	string_view ret;
+	if(likely(start < stop) && (*start == '"' || *start == '{' || *start == '['))
+	{
+		const char *const end
+		{
+			scan(start, stop)
+		};
+
+		if(unlikely(!end))
+			throw parse_error
+			{
+				"Unterminated %s",
+				*start == '"'? "string":
+				*start == '{'? "object":
+				               "array"
+			};
+
+		ret = string_view{start, end};
+		start = end;
+		return ret;
+	}
+
+	static const parser::rule<string_view> value
+	{
+		raw[parser.value(0)]
+		,"value"
+	};
+
+	qi::parse(start, stop, eps > value, ret);
+	return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // json/object.h
@@ -2638,16 +2829,22 @@ const try
 		parser.ws
 	};
 
-	static const parser::rule<json::object::member> object_member
+	static const parser::rule<> parse_begin
 	{
-		parser.name >> -ws >> parser.name_sep >> -ws >> raw[parser.value(0)]
-		,"object member"
+		-ws >> parser.object_begin >> -ws
+		,"object begin"
 	};
 
-	static const parser::rule<json::object::member> parse_begin
+	static const parser::rule<> parse_end
 	{
-		-ws >> parser.object_begin >> -ws >> (parser.object_end | object_member) >> -ws
-		,"object begin and member or end"
+		parser.object_end >> -ws
+		,"object end"
+	};
+
+	static const parser::rule<string_view> parse_name
+	{
+		parser.name >> -ws >> parser.name_sep >> -ws
+		,"object member"
 	};
 
 	const_iterator ret
@@ -2655,9 +2852,19 @@ const try
 		string_view::begin(), string_view::end()
 	};
 
-	if(!string_view{*this}.empty())
-		qi::parse(ret.start, ret.stop, eps > parse_begin, ret.state);
+	if(string_view{*this}.empty())
+		return ret;
 
+	qi::parse(ret.start, ret.stop, eps > parse_begin);
+	if(ret.start < ret.stop && *ret.start == '}')
+	{
+		qi::parse(ret.start, ret.stop, eps > parse_end);
+		return ret;
+	}
+
+	qi::parse(ret.start, ret.stop, eps > parse_name, ret.state.first);
+	ret.state.second = scan_value(ret.start, ret.stop);
+	qi::parse(ret.start, ret.stop, -ws);
 	return ret;
 }
 catch(const qi::expectation_failure<const char *> &e)
@@ -2692,21 +2899,29 @@ try
 		parser.ws
 	};
 
-	static const parser::rule<json::object::member> member
+	static const parser::rule<> parse_end
 	{
-		parser.name >> -ws >> parser.name_sep >> -ws >> raw[parser.value(0)]
-		,"next object member"
+		parser.object_end >> -ws
+		,"object end"
 	};
 
-	static const parser::rule<json::object::member> parse_next
+	static const parser::rule<string_view> parse_name
 	{
-		(parser.object_end | (parser.value_sep >> -ws >> member)) >> -ws
+		parser.value_sep >> -ws >> parser.name >> -ws >> parser.name_sep >> -ws
 		,"next object member or end"
 	};
 
 	state.first = string_view{};
 	state.second = string_view{};
-	qi::parse(start, stop, eps > parse_next, state);
+	if(start < stop && *start == '}')
+	{
+		qi::parse(start, stop, eps > parse_end);
+		return *this;
+	}
+
+	qi::parse(start, stop, eps > parse_name, state.first);
+	state.second = scan_value(start, stop);
+	qi::parse(start, stop, -ws);
 	return *this;
 }
 catch(const qi::expectation_failure<const char *> &e)
@@ -2952,16 +3167,16 @@ const try
 		parser.ws
 	};
 
-	static const parser::rule<string_view> value
+	static const parser::rule<> parse_begin
 	{
-		raw[parser.value(0)]
-		,"array element"
+		-ws >> parser.array_begin >> -ws
+		,"array begin"
 	};
 
-	static const parser::rule<string_view> parse_begin
+	static const parser::rule<> parse_end
 	{
-		-ws >> parser.array_begin >> -ws >> (parser.array_end | value) >> -ws
-		,"array begin and element or end"
+		parser.array_end >> -ws
+		,"array end"
 	};
 
 	const_iterator ret
@@ -2969,9 +3184,18 @@ const try
 		string_view::begin(), string_view::end()
 	};
 
-	if(!string_view{*this}.empty())
-		qi::parse(ret.start, ret.stop, eps > parse_begin, ret.state);
+	if(string_view{*this}.empty())
+		return ret;
+
+	qi::parse(ret.start, ret.stop, eps > parse_begin);
+	if(ret.start < ret.stop && *ret.start == ']')
+	{
+		qi::parse(ret.start, ret.stop, eps > parse_end);
+		return ret;
+	}
 
+	ret.state = scan_value(ret.start, ret.stop);
+	qi::parse(ret.start, ret.stop, -ws);
 	return ret;
 }
 catch(const qi::expectation_failure<const char *> &e)
@@ -3053,20 +3277,28 @@ try
 		parser.ws
 	};
 
-	static const parser::rule<string_view> value
+	static const parser::rule<> parse_end
 	{
-		raw[parser.value(0)]
-		,"array element"
+		parser.array_end >> -ws
+		,"array end"
 	};
 
-	static const parser::rule<string_view> parse_next
+	static const parser::rule<> parse_next
 	{
-		(parser.array_end | (parser.value_sep >> -ws >> value)) >> -ws
+		parser.value_sep >> -ws
 		,"next array element or end"
 	};
 
 	state = string_view{};
-	qi::parse(start, stop, eps > parse_next, state);
+	if(start < stop && *start == ']')
+	{
+		qi::parse(start, stop, eps > parse_end);
+		return *this;
+	}
+
+	qi::parse(start, stop, eps > parse_next);
+	state = scan_value(start, stop);
+	qi::parse(start, stop, -ws);
 	return *this;
 }
 catch(const qi::expectation_failure<const char *> &e)
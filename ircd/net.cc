@@ -13,10 +13,19 @@ namespace ircd::net
 	ctx::dock dock;
 	std::optional<dns::init> _dns_;
 
+	using ssl_session_ptr = std::unique_ptr<SSL_SESSION, void (*)(SSL_SESSION *)>;
+
 	static void init_ipv6();
 	static void wait_close_sockets();
+	static void ssl_session_put(const string_view &key, SSL_SESSION &);
+	static bool ssl_session_get(const string_view &key, SSL &);
+
+	extern std::map<std::string, ssl_session_ptr, std::less<>> ssl_sessions;
+	extern int ssl_socket_index;
 }
 
+static int ircd_net_socket_handle_session(SSL *, SSL_SESSION *) noexcept;
+
 void
 ircd::net::wait_close_sockets()
 {
@@ -71,6 +80,12 @@ ircd::net::init::init()
 	init_ipv6();
 	sslv23_client.set_verify_mode(asio::ssl::verify_peer);
 	sslv23_client.set_default_verify_paths();
+
+	// Sessions are kept by net::ssl_sessions rather than by the context;
+	// OpenSSL offers them from the callback when they're established.
+	ssl_socket_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+	SSL_CTX_set_session_cache_mode(sslv23_client.native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(sslv23_client.native_handle(), ircd_net_socket_handle_session);
 	_dns_.emplace();
 }
 
@@ -80,6 +95,7 @@ noexcept
 {
 	_dns_.reset();
 	wait_close_sockets();
+	ssl_sessions.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -143,6 +159,19 @@ ircd::net::peer_cert_der_sha256(const mutable_buffer &buf,
 	};
 }
 
+ircd::string_view
+ircd::net::alpn(const socket &socket)
+{
+	const SSL &ssl(socket);
+	const unsigned char *data {nullptr};
+	unsigned int len {0};
+	SSL_get0_alpn_selected(&ssl, &data, &len);
+	return string_view
+	{
+		reinterpret_cast<const char *>(data), len
+	};
+}
+
 ircd::const_buffer
 ircd::net::peer_cert_der(const mutable_buffer &buf,
                          const socket &socket)
@@ -1195,6 +1224,15 @@ ircd::net::acceptor::timeout
 	{ "default",  12000L                      },
 };
 
+/// Whether listeners offer HTTP/2 by ALPN; a listener's "http2" option
+/// overrides this.
+decltype(ircd::net::acceptor::http2)
+ircd::net::acceptor::http2
+{
+	{ "name",     "ircd.net.acceptor.http2" },
+	{ "default",  false                     },
+};
+
 /// The number of simultaneous handshakes we conduct across all clients.
 decltype(ircd::net::acceptor::handshaking_max)
 ircd::net::acceptor::handshaking_max
@@ -1799,6 +1837,7 @@ noexcept try
 	handshaking.erase(it);
 	check_handshake_error(ec, *sock);
 	sock->cancel_timeout();
+	++(openssl::session_reused(*sock)? socket::total_ssl_resumed_in : socket::total_ssl_full_in);
 	assert(bool(cb));
 
 	// Toggles the behavior of non-async functions; see func comment
@@ -1910,6 +1949,29 @@ ircd::net::acceptor::handle_alpn(SSL &ssl,
 	}
 	#endif IRCD_NET_ACCEPTOR_DEBUG_ALPN
 
+	const bool h2
+	{
+		json::object(opts).get<bool>("http2", bool(acceptor::http2))
+	};
+
+	// Our preference is taken over the order offered by the client; the
+	// selection must point into the offered list.
+	const auto it
+	{
+		std::find(begin(in), end(in), "h2"_sv)
+	};
+
+	if(h2 && it != end(in))
+		return *it;
+
+	const auto jt
+	{
+		std::find(begin(in), end(in), "http/1.1"_sv)
+	};
+
+	if(jt != end(in))
+		return *jt;
+
 	return {};
 }
 
@@ -1937,7 +1999,7 @@ noexcept try
 	while(i < inlen && p < PROTOS_MAX)
 	{
 		const uint8_t &len(in[i++]);
-		if(unlikely(!len || i + len >= inlen))
+		if(unlikely(!len || i + len > inlen))
 			break;
 
 		protos[p++] = ircd::string_view
@@ -2104,6 +2166,11 @@ ircd::net::acceptor::configure(const json::object &opts)
 	configure_curves(opts);
 	configure_certs(opts);
 
+	// Sessions are resumed by the server's cache or by tickets encrypted
+	// with the rotating keys shared by every listener.
+	openssl::set_session_id_context(*ssl.native_handle(), name);
+	openssl::set_session_tickets(*ssl.native_handle());
+
 	SSL_CTX_set_alpn_select_cb(ssl.native_handle(), ircd_net_acceptor_handle_alpn, this);
 	SSL_CTX_set_tlsext_servername_callback(ssl.native_handle(), ircd_net_acceptor_handle_sni);
 	SSL_CTX_set_tlsext_servername_arg(ssl.native_handle(), this);
@@ -2681,6 +2748,22 @@ ircd::net::sslv23_client
 	boost::asio::ssl::context::method::sslv23_client
 };
 
+decltype(ircd::net::ssl_session_cache_max)
+ircd::net::ssl_session_cache_max
+{
+	{ "name",     "ircd.net.ssl.session.cache.max" },
+	{ "default",  4096L                            },
+};
+
+decltype(ircd::net::ssl_sessions)
+ircd::net::ssl_sessions;
+
+decltype(ircd::net::ssl_socket_index)
+ircd::net::ssl_socket_index
+{
+	-1
+};
+
 decltype(ircd::net::socket::count)
 ircd::net::socket::count
 {};
@@ -2717,6 +2800,139 @@ ircd::net::socket::total_calls_out
 	{ "desc", "The total number of write operations on all sockets"  },
 };
 
+decltype(ircd::net::socket::total_ssl_resumed_in)
+ircd::net::socket::total_ssl_resumed_in
+{
+	{ "name", "ircd.net.socket.in.total.ssl.resumed"                    },
+	{ "desc", "The number of inbound handshakes resuming a session"     },
+};
+
+decltype(ircd::net::socket::total_ssl_resumed_out)
+ircd::net::socket::total_ssl_resumed_out
+{
+	{ "name", "ircd.net.socket.out.total.ssl.resumed"                   },
+	{ "desc", "The number of outbound handshakes resuming a session"    },
+};
+
+decltype(ircd::net::socket::total_ssl_full_in)
+ircd::net::socket::total_ssl_full_in
+{
+	{ "name", "ircd.net.socket.in.total.ssl.full"                       },
+	{ "desc", "The number of inbound handshakes without resumption"     },
+};
+
+decltype(ircd::net::socket::total_ssl_full_out)
+ircd::net::socket::total_ssl_full_out
+{
+	{ "name", "ircd.net.socket.out.total.ssl.full"                      },
+	{ "desc", "The number of outbound handshakes without resumption"    },
+};
+
+//
+// ssl session cache
+//
+
+/// A TLS 1.3 session is taken out of the cache when offered since its
+/// ticket should be used once; the server sends a fresh one over the new
+/// connection. Sessions of earlier versions stay until replaced.
+bool
+ircd::net::ssl_session_get(const string_view &key,
+                           SSL &ssl)
+{
+	const auto it
+	{
+		ssl_sessions.find(key)
+	};
+
+	if(it == end(ssl_sessions))
+		return false;
+
+	SSL_SESSION &session
+	{
+		*it->second
+	};
+
+	const bool expired
+	{
+		SSL_SESSION_get_time(&session) + SSL_SESSION_get_timeout(&session) < ircd::time()
+	};
+
+	if(expired || !SSL_SESSION_is_resumable(&session))
+	{
+		ssl_sessions.erase(it);
+		return false;
+	}
+
+	openssl::set_session(ssl, session);
+	if(SSL_SESSION_get_protocol_version(&session) >= TLS1_3_VERSION)
+		ssl_sessions.erase(it);
+
+	return true;
+}
+
+/// The oldest sessions are dropped past the configured maximum.
+void
+ircd::net::ssl_session_put(const string_view &key,
+                           SSL_SESSION &session)
+{
+	SSL_SESSION_up_ref(&session);
+	ssl_session_ptr ptr
+	{
+		&session, SSL_SESSION_free
+	};
+
+	auto it
+	{
+		ssl_sessions.lower_bound(key)
+	};
+
+	if(it != end(ssl_sessions) && it->first == key)
+		it->second = std::move(ptr);
+	else
+		ssl_sessions.emplace_hint(it, std::string(key), std::move(ptr));
+
+	while(ssl_sessions.size() > size_t(ssl_session_cache_max))
+		ssl_sessions.erase(std::min_element(begin(ssl_sessions), end(ssl_sessions), []
+		(const auto &a, const auto &b)
+		{
+			return SSL_SESSION_get_time(a.second.get()) < SSL_SESSION_get_time(b.second.get());
+		}));
+}
+
+/// The session is not retained by OpenSSL after returning zero here; the
+/// cache holds its own reference. Sessions whose certificate did not pass
+/// full verification are not cached.
+static int
+ircd_net_socket_handle_session(SSL *const ssl,
+                               SSL_SESSION *const session)
+noexcept try
+{
+	const auto *const socket
+	{
+		reinterpret_cast<const ircd::net::socket *>(SSL_get_ex_data(ssl, ircd::net::ssl_socket_index))
+	};
+
+	if(unlikely(!socket || !session || socket->ssl_session_key.empty()))
+		return 0;
+
+	if(SSL_get_verify_result(ssl) != X509_V_OK)
+		return 0;
+
+	ircd::net::ssl_session_put(socket->ssl_session_key, *session);
+
+	return 0;
+}
+catch(const std::exception &e)
+{
+	ircd::log::error
+	{
+		ircd::net::log, "Failed to cache SSL session :%s",
+		e.what(),
+	};
+
+	return 0;
+}
+
 //
 // socket
 //
@@ -2830,7 +3046,7 @@ ircd::net::socket::handshake(const open_opts &opts,
 
 	auto handshake_handler
 	{
-		std::bind(&socket::handle_handshake, this, weak_from(*this), std::move(callback), ph::_1)
+		std::bind(&socket::handle_handshake, this, weak_from(*this), std::move(callback), opts, ph::_1)
 	};
 
 	auto verify_handler
@@ -2844,6 +3060,57 @@ ircd::net::socket::handshake(const open_opts &opts,
 	if(opts.send_sni && server_name(opts))
 		openssl::server_name(*this, server_name(opts));
 
+	// Offer a session from an earlier connection to the same remote; new
+	// sessions are put in the cache by the callback with this key. The key
+	// includes the verification options so a session is only offered by a
+	// connection with the same requirements as the one which established it.
+	if(size_t(ssl_session_cache_max) && common_name(opts))
+	{
+		const uint verify_flags
+		{
+			uint(opts.verify_certificate) << 0 |
+			uint(opts.allow_self_signed) << 1 |
+			uint(opts.allow_self_chain) << 2 |
+			uint(opts.allow_expired) << 3 |
+			uint(opts.verify_common_name) << 4 |
+			uint(opts.verify_self_signed_common_name) << 5
+		};
+
+		ssl_session_key = fmt::snstringf
+		{
+			rfc3986::DOMAIN_BUFSIZE + 16, "%s:%u:%x",
+			common_name(opts),
+			net::port(opts.ipport)?: net::port(opts.hostport),
+			verify_flags,
+		};
+
+		SSL_set_ex_data(ssl.native_handle(), ssl_socket_index, this);
+		ssl_session_get(ssl_session_key, *ssl.native_handle());
+	}
+
+	if(!empty(opts.alpn))
+	{
+		// The list is sent as length-prefixed strings.
+		uint8_t protos[256];
+		size_t len(0);
+		for(const auto &proto : opts.alpn)
+		{
+			if(unlikely(empty(proto) || len + 1 + size(proto) > sizeof(protos)))
+				continue;
+
+			protos[len++] = size(proto);
+			memcpy(protos + len, data(proto), size(proto));
+			len += size(proto);
+		}
+
+		// Returns zero on success, unlike the rest of the API.
+		if(unlikely(SSL_set_alpn_protos(ssl.native_handle(), protos, len) != 0))
+			throw error
+			{
+				"Failed to set ALPN protocols for the handshake."
+			};
+	}
+
 	ssl.set_verify_callback(std::move(verify_handler));
 	ssl.async_handshake(handshake_type::client, ios::handle(desc, std::move(handshake_handler)));
 }
@@ -3737,6 +4004,7 @@ catch(const std::exception &e)
 void
 ircd::net::socket::handle_handshake(std::weak_ptr<socket> wp,
                                     eptr_handler callback,
+                                    const open_opts &opts,
                                     error_code ec)
 noexcept try
 {
@@ -3770,6 +4038,13 @@ noexcept try
 	};
 	#endif
 
+	// The verify callback is not run for a resumed session.
+	if(!ec && openssl::session_reused(*this) && !handle_verify_resumed(opts))
+		ec = make_error_code(errc::permission_denied);
+
+	if(!ec)
+		++(openssl::session_reused(*this)? total_ssl_resumed_out : total_ssl_full_out);
+
 	// Toggles the behavior of non-async functions; see func comment
 	if(!ec)
 		blocking(*this, false);
@@ -3813,6 +4088,58 @@ catch(const std::exception &e)
 	call_user(callback, ec);
 }
 
+/// Only sessions which passed full verification are cached, so the stored
+/// result is expected to be X509_V_OK; the host is checked again since the
+/// session may have been established for another name.
+bool
+ircd::net::socket::handle_verify_resumed(const open_opts &opts)
+noexcept try
+{
+	if(!opts.verify_certificate)
+		return true;
+
+	const auto result
+	{
+		openssl::verify_result(*ssl.native_handle())
+	};
+
+	if(unlikely(result != X509_V_OK))
+		throw inauthentic
+		{
+			"%s resumed session #%ld: %s",
+			common_name(opts),
+			result,
+			X509_verify_cert_error_string(result),
+		};
+
+	if(opts.verify_common_name && !openssl::check_host(openssl::peer_cert(*ssl.native_handle()), common_name(opts)))
+		throw inauthentic
+		{
+			"%s resumed session certificate does not match the target host",
+			common_name(opts),
+		};
+
+	return true;
+}
+catch(const inauthentic &e)
+{
+	log::error
+	{
+		log, "Certificate rejected :%s", e.what()
+	};
+
+	return false;
+}
+catch(const std::exception &e)
+{
+	log::critical
+	{
+		log, "Certificate error :%s", e.what()
+	};
+
+	return false;
+}
+
 bool
 ircd::net::socket::handle_verify(const bool valid,
                                  asio::ssl::verify_context &vc,
@@ -16,10 +16,12 @@
 #include <RB_INC_OPENSSL_EC_H
 #include <RB_INC_OPENSSL_RSA_H
 #include <RB_INC_OPENSSL_X509_H
+#include <RB_INC_OPENSSL_X509V3_H
 #include <RB_INC_OPENSSL_EVP_H
 #include <RB_INC_OPENSSL_RIPEMD_H
 #include <RB_INC_OPENSSL_DH_H
 #include <RB_INC_OPENSSL_TLS1_H
+#include <RB_INC_OPENSSL_RAND_H
 
 // Metaconditions for which OpenSSL API to use. This produces a single #define
 // to simplify further #ifdef's throught this definition file.
@@ -49,6 +51,12 @@ namespace ircd::openssl
 	static int call(function&& f, args&&... a);
 
 	static int genprime_cb(const int, const int, BN_GENCB *const) noexcept;
+
+	struct ticket_key;
+	extern std::array<ticket_key, 2> ticket_keys;
+	extern conf::item<seconds> ticket_key_interval;
+	static void ticket_key_rotate();
+	static const ticket_key *ticket_key_find(const uint8_t *const &name);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -96,6 +104,248 @@ ircd::openssl::server_name(const SSL &ssl)
 	return ::SSL_get_servername(&ssl, type);
 }
 
+//
+// Session resumption
+//
+
+/// Keys for the session tickets issued by all listeners. The first is the
+/// current key issuing tickets; the second is the one it replaced, which
+/// still accepts its tickets until the next rotation.
+struct ircd::openssl::ticket_key
+{
+	uint8_t name[16];
+	uint8_t hmac[32];
+	uint8_t aes[32];
+	time_t created {0};
+};
+
+decltype(ircd::openssl::ticket_keys)
+ircd::openssl::ticket_keys;
+
+decltype(ircd::openssl::ticket_key_interval)
+ircd::openssl::ticket_key_interval
+{
+	{ "name",     "ircd.openssl.ticket.key.rotate" },
+	{ "default",  3600L                            },
+};
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
+static int
+ircd_openssl_handle_ticket_key(SSL *const ssl,
+                               unsigned char *const name,
+                               unsigned char *const iv,
+                               EVP_CIPHER_CTX *const cipher,
+                               EVP_MAC_CTX *const mac,
+                               const int enc)
+noexcept try
+{
+	using namespace ircd::openssl;
+
+	if(enc)
+		ticket_key_rotate();
+
+	const auto *const key
+	{
+		enc? &ticket_keys[0]: ticket_key_find(name)
+	};
+
+	// Unknown key; the ticket is ignored and a full handshake is done.
+	if(!key || !key->created)
+		return 0;
+
+	if(enc)
+	{
+		memcpy(name, key->name, sizeof(key->name));
+		if(unlikely(::RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1))
+			return -1;
+	}
+
+	OSSL_PARAM params[]
+	{
+		OSSL_PARAM_construct_octet_string("key", const_cast<uint8_t *>(key->hmac), sizeof(key->hmac)),
+		OSSL_PARAM_construct_utf8_string("digest", const_cast<char *>("SHA256"), 0),
+		OSSL_PARAM_construct_end(),
+	};
+
+	if(unlikely(::EVP_MAC_CTX_set_params(mac, params) != 1))
+		return -1;
+
+	const auto init
+	{
+		enc? ::EVP_EncryptInit_ex: ::EVP_DecryptInit_ex
+	};
+
+	if(unlikely(init(cipher, EVP_aes_256_cbc(), nullptr, key->aes, iv) != 1))
+		return -1;
+
+	// A ticket of the previous key is accepted and renewed.
+	return key == &ticket_keys[0]? 1 : 2;
+}
+catch(...)
+{
+	return -1;
+}
+#else
+static int
+ircd_openssl_handle_ticket_key(SSL *const ssl,
+                               unsigned char *const name,
+                               unsigned char *const iv,
+                               EVP_CIPHER_CTX *const cipher,
+                               HMAC_CTX *const mac,
+                               const int enc)
+noexcept try
+{
+	using namespace ircd::openssl;
+
+	if(enc)
+		ticket_key_rotate();
+
+	const auto *const key
+	{
+		enc? &ticket_keys[0]: ticket_key_find(name)
+	};
+
+	// Unknown key; the ticket is ignored and a full handshake is done.
+	if(!key || !key->created)
+		return 0;
+
+	if(enc)
+	{
+		memcpy(name, key->name, sizeof(key->name));
+		if(unlikely(::RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1))
+			return -1;
+	}
+
+	if(unlikely(::HMAC_Init_ex(mac, key->hmac, sizeof(key->hmac), EVP_sha256(), nullptr) != 1))
+		return -1;
+
+	const auto init
+	{
+		enc? ::EVP_EncryptInit_ex: ::EVP_DecryptInit_ex
+	};
+
+	if(unlikely(init(cipher, EVP_aes_256_cbc(), nullptr, key->aes, iv) != 1))
+		return -1;
+
+	// A ticket of the previous key is accepted and renewed.
+	return key == &ticket_keys[0]? 1 : 2;
+}
+catch(...)
+{
+	return -1;
+}
+#endif
+
+void
+ircd::openssl::set_session_tickets(SSL_CTX &ssl)
+{
+	ticket_key_rotate();
+
+	#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
+	call(::SSL_CTX_set_tlsext_ticket_key_evp_cb, &ssl, ircd_openssl_handle_ticket_key);
+	#else
+	// The command is only handled by SSL_CTX_callback_ctrl() behind the macro.
+	if(unlikely(SSL_CTX_set_tlsext_ticket_key_cb(&ssl, ircd_openssl_handle_ticket_key) != 1))
+		throw_error();
+	#endif
+}
+
+void
+ircd::openssl::set_session_id_context(SSL_CTX &ssl,
+                                      const string_view &context)
+{
+	const uint len
+	(
+		std::min(size(context), size_t(SSL_MAX_SID_CTX_LENGTH))
+	);
+
+	call(::SSL_CTX_set_session_id_context, &ssl, reinterpret_cast<const uint8_t *>(data(context)), len);
+}
+
+void
+ircd::openssl::set_session(SSL &ssl,
+                           SSL_SESSION &session)
+{
+	call(::SSL_set_session, &ssl, &session);
+}
+
+bool
+ircd::openssl::session_reused(const SSL &ssl)
+{
+	return ::SSL_session_reused(const_cast<SSL *>(&ssl)) == 1;
+}
+
+/// For a resumed session this is the result of the verification in the
+/// handshake which established it.
+long
+ircd::openssl::verify_result(const SSL &ssl)
+{
+	return ::SSL_get_verify_result(&ssl);
+}
+
+/// Matches the host against the subjectAltName of the certificate, or its
+/// CN when it has none (RFC 6125).
+bool
+ircd::openssl::check_host(const X509 &cert,
+                          const string_view &host)
+{
+	const int ret
+	{
+		::X509_check_host(const_cast<X509 *>(&cert), data(host), size(host), 0, nullptr)
+	};
+
+	if(unlikely(ret < 0))
+		throw error
+		{
+			"Failed to check host '%s' against certificate", host
+		};
+
+	return ret == 1;
+}
+
+/// The key is rotated when it is older than the configured interval; the
+/// current key becomes the previous.
+void
+ircd::openssl::ticket_key_rotate()
+{
+	const time_t now
+	{
+		ircd::time()
+	};
+
+	const seconds &interval
+	{
+		ticket_key_interval
+	};
+
+	auto &[current, previous]
+	{
+		ticket_keys
+	};
+
+	if(current.created && now - current.created < interval.count())
+		return;
+
+	ticket_key next;
+	call(::RAND_bytes, next.name, int(sizeof(next.name)));
+	call(::RAND_bytes, next.hmac, int(sizeof(next.hmac)));
+	call(::RAND_bytes, next.aes, int(sizeof(next.aes)));
+	next.created = now;
+
+	previous = current;
+	current = next;
+}
+
+const ircd::openssl::ticket_key *
+ircd::openssl::ticket_key_find(const uint8_t *const &name)
+{
+	for(const auto &key : ticket_keys)
+		if(key.created && memcmp(key.name, name, sizeof(key.name)) == 0)
+			return &key;
+
+	return nullptr;
+}
+
 //
 // Cipher suite
 //
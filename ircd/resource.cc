@@ -429,6 +429,11 @@ try
 		stats->pending
 	};
 
+	const ircd::stats::histogram::scope latency
+	{
+		stats->latency
+	};
+
 	// Bail out if the method limited the amount of content and it was exceeded.
 	if(head.content_length > opts->payload_max)
 		throw http::error
@@ -454,15 +459,21 @@ try
 
 	// This timer will keep the request from hanging forever for whatever
 	// reason. The resource method may want to do its own timing and can
-	// disable this in its options structure.
+	// disable this in its options structure. The socket timer can't be used
+	// by one stream of an HTTP/2 connection.
 	const net::scope_timeout timeout
 	{
-		*client.sock, opts->timeout, [this, &client]
-		(const bool &timed_out)
-		{
-			if(timed_out)
-				this->handle_timeout(client);
-		}
+		!client.stream_id?
+			net::scope_timeout
+			{
+				*client.sock, opts->timeout, [this, &client]
+				(const bool &timed_out)
+				{
+					if(timed_out)
+						this->handle_timeout(client);
+				}
+			}:
+			net::scope_timeout{}
 	};
 
 	// Content that hasn't yet arrived is remaining
@@ -506,6 +517,26 @@ try
 		};
 	}
 
+	// The request is viewed as a json::object, whose iteration delimits the
+	// nested values without validating them; a JSON body is validated in full
+	// once here instead. Content left on the socket is the resource's own.
+	const auto &mime
+	{
+		split(split(head.content_type, ';').first, '/')
+	};
+
+	const bool content_json
+	{
+		!empty(content) && size(content) == head.content_length &&
+		(!head.content_type || (iequals(mime.first, "application"_sv) && iequals(mime.second, "json"_sv)))
+	};
+
+	if(content_json && !json::valid(content, std::nothrow))
+		throw http::error
+		{
+			"Request content is not valid JSON", http::BAD_REQUEST
+		};
+
 	// We take the extra step here to clear the assignment to client.request
 	// when this request stack has finished for two reasons:
 	// - It allows other ctxs to peep at the client::list to see what this
@@ -842,6 +873,49 @@ ircd::resource::response::response(client &client,
 {
 }
 
+namespace ircd
+{
+	template<class T> static string_view response_generate(mutable_buffer, const T &);
+}
+
+decltype(ircd::resource::response::offload_min)
+ircd::resource::response::offload_min
+{
+	{ "name",     "ircd.resource.response.offload.min" },
+	{ "default",  long(128_KiB)                        },
+};
+
+/// Serialize the content of a response. Large content is serialized on a
+/// ctx::ole thread so the main thread serves other clients meanwhile; this
+/// context owns the value and the buffer and waits for the result.
+template<class T>
+ircd::string_view
+ircd::response_generate(mutable_buffer buf,
+                        const T &value)
+{
+	const bool offload
+	{
+		size_t(resource::response::offload_min)
+		&& size(buf) >= size_t(resource::response::offload_min)
+	};
+
+	if(!offload)
+		return json::stringify(buf, value);
+
+	string_view ret;
+	ctx::ole::opts opts;
+	opts.name = "resource";
+	ctx::offload
+	{
+		opts, [&buf, &value, &ret]
+		{
+			ret = json::stringify(buf, value);
+		}
+	};
+
+	return ret;
+}
+
 ircd::resource::response::response(client &client,
                                    const http::code &code,
                                    const json::value &value)
@@ -861,13 +935,13 @@ try
 	{
 		case json::ARRAY:
 		{
-			response(client, json::array{stringify(mutable_buffer{buffer}, value)}, code);
+			response(client, json::array{response_generate(buffer, value)}, code);
 			return;
 		}
 
 		case json::OBJECT:
 		{
-			response(client, json::object{stringify(mutable_buffer{buffer}, value)}, code);
+			response(client, json::object{response_generate(buffer, value)}, code);
 			return;
 		}
 
@@ -906,7 +980,7 @@ try
 
 	const json::object object
 	{
-		stringify(mutable_buffer{buffer}, members)
+		response_generate(buffer, members)
 	};
 
 	response(client, object, code);
@@ -938,7 +1012,7 @@ try
 
 	const json::object object
 	{
-		stringify(mutable_buffer{buffer}, members)
+		response_generate(buffer, members)
 	};
 
 	response(client, object, code);
@@ -588,6 +588,13 @@ ircd::server::peer::enable_ipv6
 	{ "default",  true                           }
 };
 
+decltype(ircd::server::peer::enable_http2)
+ircd::server::peer::enable_http2
+{
+	{ "name",     "ircd.server.peer.enable_http2" },
+	{ "default",  false                           }
+};
+
 decltype(ircd::server::peer::link_min_default)
 ircd::server::peer::link_min_default
 {
@@ -636,6 +643,15 @@ ircd::server::peer::peer(const net::hostport &hostport,
 	// Cert verify this name.
 	this->open_opts.common_name = host(canon);
 
+	// Offer HTTP/2 so requests can be multiplexed on each link.
+	static const string_view alpn_protos[]
+	{
+		"h2", "http/1.1"
+	};
+
+	if(enable_http2)
+		this->open_opts.alpn = alpn_protos;
+
 	if(rfc3986::valid(std::nothrow, rfc3986::parser::ip_address, host(canon)))
 		this->remote =
 		{
@@ -1749,6 +1765,14 @@ ircd::server::link::tag_commit_max_default
 	{ "default",  3L                                }
 };
 
+/// Microseconds from the first byte of a request written to the link until
+/// its response is complete.
+decltype(ircd::server::link::rtt)
+ircd::server::link::rtt
+{
+	{ "name",     "ircd.server.link.rtt" },
+};
+
 decltype(ircd::server::link::ids)
 ircd::server::link::ids;
 
@@ -1794,6 +1818,65 @@ ircd::server::loghead(const mutable_buffer &buf,
 	};
 }
 
+/// HTTP/2 (RFC 7540) state of a link which negotiated "h2" by ALPN. Each
+/// tag is a stream: its HTTP/1.1 request is converted to HEADERS and DATA
+/// frames when it is committed, and the frames of its response are converted
+/// back to HTTP/1.1 and given to the tag as if read off the socket, so tags
+/// finish in any order and a slow response doesn't hold up the others.
+struct ircd::server::link::h2
+{
+	struct stream
+	{
+		int64_t send_window {0};
+		bool headed {false};               // Response head given to the tag
+		bool chunked {false};              // Response content given chunked
+	};
+
+	static conf::item<size_t> streams_max;
+	static conf::item<size_t> window_size;
+
+	http2::settings remote;                // Settings of the peer
+	http2::hpack hpack;                    // Peer's header compression state
+	std::map<uint32_t, stream> streams;
+	std::string out;                       // Frames not yet written
+	unique_buffer<mutable_buffer> buf;     // Frames read off the socket
+	size_t buffered {0};                   // Bytes of buf awaiting handling
+	http2::block block;                    // Header block being received
+	uint32_t next_stream {1};
+	int64_t send_window {65535};           // Connection flow control window
+	int64_t recv_window {65535};
+	bool streams_limited {false};          // Peer sent MAX_CONCURRENT_STREAMS
+	bool goaway {false};                   // No more streams can be opened
+
+	static uint32_t window();
+	uint32_t &setting(const http2::settings::code &);
+	tag *find(link &, const uint32_t &stream_id);
+
+	// output
+	void write(const http2::frame::header &, const const_buffer &payload = {});
+	void write_window(const uint32_t &stream_id, const size_t &increment);
+	void write_reset(const uint32_t &stream_id, const enum http2::error::code &);
+	void write_data(tag &);
+	void write_head(tag &);
+
+	// input
+	bool feed(link &, tag &, const_buffer);
+	void done(link &, const uint32_t &stream_id);
+	template<class E, class... args> void fail(link &, const uint32_t &stream_id, args&&...);
+	void handle_window(link &, const http2::frame::header &, const const_buffer &);
+	void handle_settings(link &, const http2::frame::header &, const const_buffer &);
+	void handle_data(link &, const http2::frame::header &, const_buffer);
+	void handle_headers(link &, const uint32_t &stream_id, const uint8_t &flags);
+	void handle(link &, const http2::frame::header &, const const_buffer &);
+
+  public:
+	void flush(link &);
+	void readable(link &);
+	void writable(link &);
+
+	h2();
+};
+
 //
 // link::link
 //
@@ -1906,10 +1989,20 @@ ircd::server::link::cleanup_canceled()
 		it = queue.erase(it);
 	}
 
+	// The streams of dead tags on an HTTP/2 link are reset by the writer
+	// without disturbing the rest.
+	assert(dead <= tag_committed());
+	if(dead && h2)
+	{
+		if(ready())
+			wait_writable();
+
+		return;
+	}
+
 	// If every committed tag in the pipe is canceled we can close this link
 	// to quickly disperse any queued tags to another link or simply kill this
 	// link if it's timing out.
-	assert(dead <= tag_committed());
 	if(dead && dead == tag_committed())
 	{
 		log::dwarning
@@ -1964,6 +2057,13 @@ ircd::server::link::handle_open(std::exception_ptr eptr)
 	op_init = false;
 	synack_ts = time<seconds>();
 
+	// HTTP/2 links read continuously for the control frames of the peer.
+	if(!eptr && !op_fini && net::alpn(*socket) == "h2")
+	{
+		h2 = std::make_unique<struct h2>();
+		wait_readable();
+	}
+
 	if(!eptr && !op_fini)
 		wait_writable();
 
@@ -2080,6 +2180,9 @@ void
 ircd::server::link::handle_writable_success()
 {
 	assert(socket);
+	if(h2)
+		return h2->writable(*this);
+
 	auto it(begin(queue));
 	while(it != end(queue))
 	{
@@ -2268,6 +2371,9 @@ void
 ircd::server::link::handle_readable_success()
 {
 	assert(socket);
+	if(h2)
+		return h2->readable(*this);
+
 	if(!tag_committed())
 	{
 		discard_read();
@@ -2620,7 +2726,20 @@ size_t
 ircd::server::link::tag_commit_max()
 const
 {
-	return tag_commit_max_default;
+	if(!h2)
+		return tag_commit_max_default;
+
+	// The peer doesn't limit its streams until it sends the setting; once
+	// it does, zero means no stream can be opened until it's raised.
+	if(!h2->streams_limited)
+		return size_t(h2::streams_max);
+
+	const uint32_t &remote_max
+	{
+		h2->setting(http2::settings::code::MAX_CONCURRENT_STREAMS)
+	};
+
+	return std::min(size_t(h2::streams_max), size_t(remote_max));
 }
 
 size_t
@@ -2642,6 +2761,768 @@ const
 	});
 }
 
+//
+// link::h2
+//
+
+decltype(ircd::server::link::h2::streams_max)
+ircd::server::link::h2::streams_max
+{
+	{ "name",     "ircd.server.link.http2.streams_max" },
+	{ "default",  32L                                  },
+};
+
+decltype(ircd::server::link::h2::window_size)
+ircd::server::link::h2::window_size
+{
+	{ "name",     "ircd.server.link.http2.window_size" },
+	{ "default",  long(1_MiB)                          },
+};
+
+/// The connection preface and our settings are queued for the first write.
+ircd::server::link::h2::h2()
+:buf
+{
+	http2::frame::SIZE + 64_KiB
+}
+{
+	using http2::frame;
+	using code = http2::settings::code;
+
+	const struct frame::settings::param param[]
+	{
+		{ code::ENABLE_PUSH,            0        },
+		{ code::INITIAL_WINDOW_SIZE,    window() },
+	};
+
+	char buf[sizeof(param) / sizeof(param[0]) * 6];
+	const const_buffer payload
+	{
+		http2::write_settings(buf, {param, sizeof(param) / sizeof(param[0])})
+	};
+
+	out.append(http2::connection_preface);
+	write({uint32_t(size(payload)), frame::SETTINGS, 0, 0}, payload);
+
+	// The connection window isn't covered by the setting.
+	write_window(0, window() - recv_window);
+}
+
+/// Commit tags to new streams and send the content of committed tags as
+/// their windows allow.
+void
+ircd::server::link::h2::writable(link &link)
+{
+	for(auto it(begin(link.queue)); it != end(link.queue); )
+	{
+		auto &tag(*it);
+		if(!tag.committed() && (tag.abandoned() || tag.canceled()))
+		{
+			it = link.queue.erase(it);
+			continue;
+		}
+
+		// Unlike a pipeline, the stream of a canceled tag can be reset
+		// without affecting the others.
+		if(tag.committed() && tag.canceled())
+		{
+			write_reset(tag.state.stream_id, http2::error::CANCEL);
+			streams.erase(tag.state.stream_id);
+			it = link.queue.erase(it);
+			continue;
+		}
+
+		if(!tag.committed())
+		{
+			if(goaway || link.tag_committed() >= link.tag_commit_max())
+			{
+				++it;
+				continue;
+			}
+
+			write_head(tag);
+		}
+
+		write_data(tag);
+		++it;
+	}
+
+	flush(link);
+}
+
+/// Write as much of the queued frames as the socket takes; the rest is
+/// written when the socket is writable again.
+void
+ircd::server::link::h2::flush(link &link)
+{
+	while(!out.empty())
+	{
+		const size_t wrote
+		{
+			write_any(*link.socket, const_buffer{out})
+		};
+
+		assert(link.peer);
+		link.peer->write_bytes += wrote;
+		out.erase(0, wrote);
+		if(!wrote)
+			break;
+	}
+
+	if(!out.empty())
+		link.wait_writable();
+}
+
+void
+ircd::server::link::h2::readable(link &link)
+try
+{
+	while(1)
+	{
+		const mutable_buffer space
+		{
+			data(buf) + buffered, size(buf) - buffered
+		};
+
+		const const_buffer got
+		{
+			link.read(space)
+		};
+
+		buffered += size(got);
+		const_buffer in
+		{
+			data(buf), buffered
+		};
+
+		http2::read_frames(in, [this, &link]
+		(const http2::frame::header &header, const const_buffer &payload)
+		{
+			handle(link, header, payload);
+		});
+
+		// Move the partial frame to the front for the next read.
+		buffered = size(in);
+		memmove(data(buf), data(in), buffered);
+		if(size(got) < size(space))
+			break;
+	}
+
+	flush(link);
+
+	// The peer has asked for no more streams; the link is closed when the
+	// last one finishes, dispersing any tags which weren't committed.
+	if(goaway && !link.tag_committed())
+	{
+		link.close();
+		return;
+	}
+
+	if(link.queue.empty())
+	{
+		assert(link.peer);
+		link.peer->handle_link_done(link);
+		return;
+	}
+
+	link.wait_readable();
+}
+catch(const http2::error &e)
+{
+	char buf[8];
+	const const_buffer payload
+	{
+		http2::write_goaway(buf, 0, e.code)
+	};
+
+	write({uint32_t(size(payload)), http2::frame::GOAWAY, 0, 0}, payload);
+	flush(link);
+	throw;
+}
+
+void
+ircd::server::link::h2::handle(link &link,
+                               const http2::frame::header &header,
+                               const const_buffer &payload)
+{
+	using http2::frame;
+	using http2::error;
+
+	block.expect(header);
+	switch(header.type)
+	{
+		case frame::DATA:
+			return handle_data(link, header, payload);
+
+		case frame::HEADERS:
+		case frame::CONTINUATION:
+			if(block(header, payload, 64_KiB))
+				handle_headers(link, header.stream_id, block.flags);
+
+			return;
+
+		case frame::RST_STREAM:
+		{
+			const enum error::code code
+			{
+				http2::read_reset(header, payload)
+			};
+
+			return fail<error>
+			(
+				link, header.stream_id, code, "Stream reset by the peer :%s", reflect(code)
+			);
+		}
+
+		case frame::SETTINGS:
+			return handle_settings(link, header, payload);
+
+		case frame::PING:
+		{
+			if(unlikely(size(payload) != 8 || header.stream_id))
+				throw error
+				{
+					error::PROTOCOL_ERROR, "Invalid PING."
+				};
+
+			if(~header.flags & frame::ACK)
+				write({8, frame::PING, frame::ACK, 0}, payload);
+
+			return;
+		}
+
+		case frame::GOAWAY:
+		{
+			const uint32_t last
+			{
+				http2::read_goaway(header, payload)
+			};
+
+			// Streams after the last were not processed by the peer.
+			goaway = true;
+			link.exclude = true;
+			for(auto it(streams.upper_bound(last)); it != end(streams); )
+			{
+				const auto stream_id((it++)->first);
+				fail<unavailable>
+				(
+					link, stream_id, "Stream %u refused by GOAWAY after %u.", stream_id, last
+				);
+			}
+
+			return;
+		}
+
+		case frame::WINDOW_UPDATE:
+			return handle_window(link, header, payload);
+
+		case frame::PUSH_PROMISE:
+			throw error
+			{
+				error::PROTOCOL_ERROR, "PUSH_PROMISE while disabled."
+			};
+
+		case frame::PRIORITY:
+		default:
+			return;
+	}
+}
+
+void
+ircd::server::link::h2::handle_headers(link &link,
+                                       const uint32_t &stream_id,
+                                       const uint8_t &flags)
+{
+	using http2::frame;
+
+	const bool end_stream
+	{
+		bool(flags & frame::END_STREAM)
+	};
+
+	string_view status;
+	char status_buf[4] {0};
+	bool content_length(false);
+	std::string headers;
+	hpack(const_buffer{block.buf}, [&status, &status_buf, &content_length, &headers]
+	(const string_view &name, const string_view &value)
+	{
+		if(name == ":status")
+			status = size(value) == 3? string_view(strlcpy(status_buf, value)) : string_view{};
+		else if(startswith(name, ':'))
+			return;
+		else if(name == "connection" || name == "transfer-encoding")
+			return;
+		else
+		{
+			content_length |= name == "content-length";
+			headers.append(name);
+			headers.append(": ");
+			headers.append(value);
+			headers.append("\r\n");
+		}
+	});
+
+	block.buf.clear();
+	auto *const tag
+	{
+		find(link, stream_id)
+	};
+
+	// The tag was canceled, or these are trailers after the content.
+	const auto it(streams.find(stream_id));
+	if(!tag || it == end(streams) || it->second.headed)
+	{
+		if(tag && end_stream && it != end(streams) && it->second.chunked)
+			if(feed(link, *tag, "0\r\n\r\n"_sv))
+				return done(link, stream_id);
+
+		return;
+	}
+
+	// Informational responses are not given to the tag.
+	if(unlikely(size(status) != 3))
+		return fail<http2::error>
+		(
+			link, stream_id, http2::error::PROTOCOL_ERROR, "Invalid :status in response."
+		);
+
+	if(status[0] == '1')
+		return;
+
+	// Content without a length is given to the tag as chunks.
+	auto &stream(it->second);
+	stream.headed = true;
+	stream.chunked = !content_length && !end_stream;
+	const http::code code
+	{
+		http::code(lex_cast<ushort>(status))
+	};
+
+	std::string head;
+	head.reserve(size(headers) + 64);
+	head.append("HTTP/1.1 ");
+	head.append(status);
+	head.append(" ");
+	head.append(http::status(code));
+	head.append("\r\n");
+	head.append(headers);
+	if(stream.chunked)
+		head.append("Transfer-Encoding: chunked\r\n");
+	else if(!content_length)
+		head.append("Content-Length: 0\r\n");
+
+	head.append("\r\n");
+	if(feed(link, *tag, string_view{head}))
+		return done(link, stream_id);
+
+	if(unlikely(end_stream))
+		return fail<http2::error>
+		(
+			link, stream_id, http2::error::PROTOCOL_ERROR, "Stream ended before the content-length."
+		);
+}
+
+void
+ircd::server::link::h2::handle_data(link &link,
+                                    const http2::frame::header &header,
+                                    const_buffer payload)
+{
+	using http2::frame;
+	using http2::error;
+
+	payload = http2::read_data(header, payload);
+
+	// The whole frame counts against flow control including the padding.
+	if(unlikely(header.len > recv_window))
+		throw error
+		{
+			error::FLOW_CONTROL_ERROR, "DATA of %u bytes exceeds the window.",
+			uint(header.len),
+		};
+
+	// The windows are replenished as soon as the data is given to the tag
+	// which has its buffers already.
+	recv_window -= header.len;
+	write_window(0, header.len);
+
+	const auto it(streams.find(header.stream_id));
+	auto *const tag
+	{
+		it != end(streams)? find(link, header.stream_id) : nullptr
+	};
+
+	if(!tag)
+		return;
+
+	if(tag->canceled())
+	{
+		write_reset(header.stream_id, error::CANCEL);
+		return fail<error>
+		(
+			link, header.stream_id, error::CANCEL, "Canceled."
+		);
+	}
+
+	if(unlikely(!it->second.headed))
+	{
+		write_reset(header.stream_id, error::PROTOCOL_ERROR);
+		return fail<error>
+		(
+			link, header.stream_id, error::PROTOCOL_ERROR, "DATA before the response head."
+		);
+	}
+
+	const bool end_stream
+	{
+		bool(header.flags & frame::END_STREAM)
+	};
+
+	bool fin(false);
+	auto &stream(it->second);
+	if(stream.chunked && !empty(payload))
+	{
+		char buf[24];
+		fin |= feed(link, *tag, string_view(fmt::sprintf{buf, "%zx\r\n", size(payload)}));
+		fin |= !fin && feed(link, *tag, payload);
+		fin |= !fin && feed(link, *tag, "\r\n"_sv);
+	}
+	else if(!stream.chunked)
+		fin |= feed(link, *tag, payload);
+
+	if(!fin && stream.chunked && end_stream)
+		fin |= feed(link, *tag, "0\r\n\r\n"_sv);
+
+	if(fin)
+		return done(link, header.stream_id);
+
+	if(unlikely(end_stream))
+		return fail<error>
+		(
+			link, header.stream_id, error::PROTOCOL_ERROR, "Stream ended before the content-length."
+		);
+
+	write_window(header.stream_id, header.len);
+}
+
+void
+ircd::server::link::h2::handle_settings(link &link,
+                                        const http2::frame::header &header,
+                                        const const_buffer &payload)
+{
+	using http2::frame;
+	using code = http2::settings::code;
+
+	// The difference of the initial window applies to all open streams.
+	const bool ack
+	{
+		!http2::read_settings(remote, header, payload, [this]
+		(const code &id, const uint32_t &value)
+		{
+			streams_limited |= id == code::MAX_CONCURRENT_STREAMS;
+			if(id != code::INITIAL_WINDOW_SIZE)
+				return;
+
+			const int64_t delta
+			{
+				int64_t(value) - int64_t(setting(code::INITIAL_WINDOW_SIZE))
+			};
+
+			for(auto &[id, stream] : streams)
+				stream.send_window += delta;
+		})
+	};
+
+	if(ack)
+		return;
+
+	write({0, frame::SETTINGS, frame::ACK, 0});
+
+	// The limit of streams or the windows may have opened up.
+	link.wait_writable();
+}
+
+void
+ircd::server::link::h2::handle_window(link &link,
+                                      const http2::frame::header &header,
+                                      const const_buffer &payload)
+{
+	using http2::error;
+
+	const uint32_t increment
+	{
+		http2::read_window(header, payload)
+	};
+
+	if(!header.stream_id)
+	{
+		if(unlikely(!increment))
+			throw error
+			{
+				error::PROTOCOL_ERROR, "WINDOW_UPDATE of zero."
+			};
+
+		send_window += increment;
+		if(unlikely(send_window > 0x7fffffffL))
+			throw error
+			{
+				error::FLOW_CONTROL_ERROR, "Connection window overflow."
+			};
+
+		link.wait_writable();
+		return;
+	}
+
+	const auto it(streams.find(header.stream_id));
+	if(it == end(streams))
+		return;
+
+	auto &stream(it->second);
+	stream.send_window += increment;
+	if(unlikely(!increment || stream.send_window > 0x7fffffffL))
+	{
+		write_reset(header.stream_id, !increment? error::PROTOCOL_ERROR : error::FLOW_CONTROL_ERROR);
+		return fail<error>
+		(
+			link, header.stream_id, error::FLOW_CONTROL_ERROR, "Invalid WINDOW_UPDATE for stream."
+		);
+	}
+
+	link.wait_writable();
+}
+
+/// Give the tag part of its response as HTTP/1.1; true when the tag has
+/// received all of its response.
+bool
+ircd::server::link::h2::feed(link &link,
+                             tag &tag,
+                             const_buffer in)
+{
+	bool done(false);
+	while(!empty(in) && !done)
+	{
+		const mutable_buffer buffer
+		{
+			tag.make_read_buffer()
+		};
+
+		const size_t copied
+		{
+			copy(buffer, in)
+		};
+
+		tag.read_buffer(const_buffer{data(buffer), copied}, done, link);
+		consume(in, copied);
+	}
+
+	return done;
+}
+
+void
+ircd::server::link::h2::done(link &link,
+                             const uint32_t &stream_id)
+{
+	streams.erase(stream_id);
+	for(auto it(begin(link.queue)); it != end(link.queue); ++it)
+		if(it->state.stream_id == stream_id)
+		{
+			assert(link.peer);
+			link.peer->handle_tag_done(link, *it);
+			link.queue.erase(it);
+			return;
+		}
+}
+
+template<class E,
+         class... args>
+void
+ircd::server::link::h2::fail(link &link,
+                             const uint32_t &stream_id,
+                             args&&... a)
+{
+	streams.erase(stream_id);
+	for(auto it(begin(link.queue)); it != end(link.queue); ++it)
+		if(it->state.stream_id == stream_id)
+		{
+			it->set_exception<E>(std::forward<args>(a)...);
+			link.queue.erase(it);
+			return;
+		}
+}
+
+ircd::server::tag *
+ircd::server::link::h2::find(link &link,
+                             const uint32_t &stream_id)
+{
+	for(auto &tag : link.queue)
+		if(tag.state.stream_id == stream_id)
+			return tag.request? &tag : nullptr;
+
+	return nullptr;
+}
+
+/// Convert the HTTP/1.1 head of the tag's request into the HEADERS of a
+/// new stream; this commits the tag.
+void
+ircd::server::link::h2::write_head(tag &tag)
+{
+	using http2::hpack;
+
+	assert(tag.request);
+	assert(!tag.committed());
+	const auto &req(*tag.request);
+	const const_buffer head_buf
+	{
+		tag.make_write_head_buffer()
+	};
+
+	// Literal encoding adds at most a few bytes to each line of the head.
+	const unique_buffer<mutable_buffer> buf
+	{
+		size(head_buf) * 2 + 64
+	};
+
+	mutable_buffer fields{buf};
+	parse::buffer pb{head_buf};
+	parse::capstan pc{pb};
+	const http::request::head head
+	{
+		pc, [&fields](const http::header &header)
+		{
+			const auto &[name, value] {header};
+			if(iequals(name, "host"_sv)
+			|| iequals(name, "connection"_sv)
+			|| iequals(name, "keep-alive"_sv)
+			|| iequals(name, "transfer-encoding"_sv)
+			|| iequals(name, "proxy-connection"_sv)
+			|| iequals(name, "upgrade"_sv)
+			|| iequals(name, "te"_sv))
+				return;
+
+			consume(fields, hpack::write_literal(fields, name, value));
+		}
+	};
+
+	// The pseudo-headers come first; indexes are of the static table.
+	const unique_buffer<mutable_buffer> pseudo_buf
+	{
+		size(head.method) + size(head.uri) + size(head.host) + 64
+	};
+
+	mutable_buffer pseudo{pseudo_buf};
+	if(head.method == "GET")
+		consume(pseudo, hpack::write_integer(pseudo, 0x80, 7, 2));
+	else if(head.method == "POST")
+		consume(pseudo, hpack::write_integer(pseudo, 0x80, 7, 3));
+	else
+		consume(pseudo, hpack::write_literal(pseudo, uint8_t(2), head.method));
+
+	consume(pseudo, hpack::write_integer(pseudo, 0x80, 7, 7));
+	consume(pseudo, hpack::write_literal(pseudo, uint8_t(4), head.uri));
+	consume(pseudo, hpack::write_literal(pseudo, uint8_t(1), head.host));
+
+	std::string block;
+	block.reserve(size(pseudo_buf) + size(buf));
+	block.append(data(pseudo_buf), std::distance(data(pseudo_buf), data(pseudo)));
+	block.append(data(buf), std::distance(data(buf), data(fields)));
+
+	const bool end
+	{
+		empty(req.out.content)
+	};
+
+	const uint32_t stream_id(next_stream);
+	http2::write_headers(out, const_buffer{block}, stream_id, setting(http2::settings::code::MAX_FRAME_SIZE), end);
+
+	next_stream += 2;
+	streams[stream_id].send_window = setting(http2::settings::code::INITIAL_WINDOW_SIZE);
+	tag.state.stream_id = stream_id;
+	tag.wrote_buffer(head_buf);
+}
+
+/// Send the tag's content in DATA frames as far as the windows allow.
+void
+ircd::server::link::h2::write_data(tag &tag)
+{
+	using http2::frame;
+
+	const auto it(streams.find(tag.state.stream_id));
+	if(it == end(streams))
+		return;
+
+	auto &stream(it->second);
+	while(tag.write_remaining() && std::min(send_window, stream.send_window) > 0)
+	{
+		const const_buffer buffer
+		{
+			tag.make_write_buffer()
+		};
+
+		const size_t len
+		{
+			std::min
+			({
+				size(buffer),
+				size_t(setting(http2::settings::code::MAX_FRAME_SIZE)),
+				size_t(std::min(send_window, stream.send_window)),
+			})
+		};
+
+		const uint8_t flags
+		(
+			len == tag.write_remaining()? frame::END_STREAM : 0
+		);
+
+		write({uint32_t(len), frame::DATA, flags, tag.state.stream_id}, {data(buffer), len});
+		send_window -= len;
+		stream.send_window -= len;
+		tag.wrote_buffer({data(buffer), len});
+	}
+}
+
+void
+ircd::server::link::h2::write_reset(const uint32_t &stream_id,
+                                    const enum http2::error::code &code)
+{
+	char buf[4];
+	write({4, http2::frame::RST_STREAM, 0, stream_id}, http2::write_reset(buf, code));
+}
+
+void
+ircd::server::link::h2::write_window(const uint32_t &stream_id,
+                                     const size_t &increment)
+{
+	if(!increment)
+		return;
+
+	if(!stream_id)
+		recv_window += increment;
+
+	char buf[4];
+	write({4, http2::frame::WINDOW_UPDATE, 0, stream_id}, http2::write_window(buf, increment));
+}
+
+/// Frames are queued in out; flush() writes them.
+void
+ircd::server::link::h2::write(const http2::frame::header &header,
+                              const const_buffer &payload)
+{
+	http2::write(out, header, payload);
+}
+
+uint32_t &
+ircd::server::link::h2::setting(const http2::settings::code &code)
+{
+	assert(code > 0 && code < http2::settings::code::_NUM_);
+	return remote.at(code - 1);
+}
+
+uint32_t
+ircd::server::link::h2::window()
+{
+	return std::min(size_t(window_size), size_t(0x7fffffffU));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // server/tag.h
@@ -2896,6 +3777,9 @@ ircd::server::tag::wrote_buffer(const const_buffer &buffer)
 {
 	assert(request);
 	const auto &req{*request};
+	if(!state.written)
+		state.sent = now<steady_point>();
+
 	state.written += size(buffer);
 
 	if(state.written <= size(req.out.head))
@@ -4102,6 +4986,9 @@ template<class... args>
 void
 ircd::server::tag::set_value(args&&... a)
 {
+	if(likely(state.written))
+		link::rtt(duration_cast<microseconds>(now<steady_point>() - state.sent));
+
 	if(abandoned())
 		return;
 
@@ -12,6 +12,10 @@ decltype(ircd::stats::items)
 ircd::stats::items
 {};
 
+decltype(ircd::stats::histograms)
+ircd::stats::histograms
+{};
+
 std::ostream &
 ircd::stats::operator<<(std::ostream &s, const item &item)
 {
@@ -19,6 +23,20 @@ ircd::stats::operator<<(std::ostream &s, const item &item)
 	return s;
 }
 
+std::ostream &
+ircd::stats::operator<<(std::ostream &s, const histogram &histogram)
+{
+	s << "n:" << histogram.count()
+	  << " mean:" << histogram.mean()
+	  << " p50:" << histogram.percentile(0.50L)
+	  << " p90:" << histogram.percentile(0.90L)
+	  << " p99:" << histogram.percentile(0.99L)
+	  << " p999:" << histogram.percentile(0.999L)
+	  << " max:" << histogram.max.load(std::memory_order_relaxed);
+
+	return s;
+}
+
 //
 // item
 //
@@ -77,3 +95,136 @@ noexcept
 		items.erase(it);
 	}
 }
+
+//
+// histogram
+//
+
+ircd::stats::histogram::histogram(const json::members &opts)
+:feature_
+{
+	opts
+}
+,feature
+{
+	feature_
+}
+,name
+{
+	unquote(feature.get("name"))
+}
+{
+	if(name.size() > item::NAME_MAX_LEN)
+		throw error
+		{
+			"Stats histogram '%s' name length:%zu exceeds max:%zu",
+			name,
+			name.size(),
+			item::NAME_MAX_LEN
+		};
+
+	if(name && !histograms.emplace(name, this).second)
+		throw error
+		{
+			"Stats histogram named '%s' already exists", name
+		};
+}
+
+ircd::stats::histogram::~histogram()
+noexcept
+{
+	if(name)
+	{
+		const auto it{histograms.find(name)};
+		assert(data(it->first) == data(name));
+		histograms.erase(it);
+	}
+}
+
+void
+ircd::stats::histogram::clear()
+noexcept
+{
+	for(auto &b : bucket)
+		b.store(0, std::memory_order_relaxed);
+
+	total.store(0, std::memory_order_relaxed);
+	sum.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+/// The upper bound of the bucket holding the sample at rank p; the result
+/// never exceeds the largest sample recorded.
+uint64_t
+ircd::stats::histogram::percentile(const long double &p)
+const noexcept
+{
+	uint64_t n(0);
+	for(const auto &b : bucket)
+		n += b.load(std::memory_order_relaxed);
+
+	if(!n)
+		return 0;
+
+	const uint64_t rank
+	{
+		std::clamp(uint64_t(std::ceil(p * n)), 1UL, n)
+	};
+
+	uint64_t acc(0);
+	for(size_t i(0); i < BUCKETS; ++i)
+	{
+		acc += bucket[i].load(std::memory_order_relaxed);
+		if(acc >= rank)
+			return std::min(upper(i), max.load(std::memory_order_relaxed));
+	}
+
+	return max.load(std::memory_order_relaxed);
+}
+
+uint64_t
+ircd::stats::histogram::mean()
+const noexcept
+{
+	const auto n
+	{
+		count()
+	};
+
+	return n?
+		sum.load(std::memory_order_relaxed) / n:
+		0UL;
+}
+
+uint64_t
+ircd::stats::histogram::upper(const size_t &i)
+noexcept
+{
+	const size_t exp
+	{
+		i >> SUB_BITS
+	};
+
+	return exp?
+		lower(i) + ((1UL << (exp - 1)) - 1):
+		i;
+}
+
+uint64_t
+ircd::stats::histogram::lower(const size_t &i)
+noexcept
+{
+	const size_t exp
+	{
+		i >> SUB_BITS
+	};
+
+	const uint64_t sub
+	{
+		i & ((1UL << SUB_BITS) - 1)
+	};
+
+	return exp?
+		((1UL << SUB_BITS) | sub) << (exp - 1):
+		i;
+}
@@ -127,6 +127,8 @@ ircd::m::dbs::init::init(const string_view &servername,
 	room_joined = db::domain{*events, desc::room_joined.name};
 	room_state = db::domain{*events, desc::room_state.name};
 	room_state_space = db::domain{*events, desc::room_state_space.name};
+	room_search = db::domain{*events, desc::room_search.name};
+	user_room_recency = db::domain{*events, desc::user_room_recency.name};
 }
 
 /// Shuts down the m::dbs subsystem; closes the events database. The extern
@@ -319,6 +321,9 @@ ircd::m::dbs::_index_room(db::txn &txn,
 
 	if(opts.appendix.test(appendix::ROOM_REDACT) && json::get<"type"_>(event) == "m.room.redaction")
 		_index_room_redact(txn, event, opts);
+
+	if(opts.appendix.test(appendix::ROOM_SEARCH))
+		_index_room_search(txn, event, opts);
 }
 
 // NOTE: QUERY
@@ -30,6 +30,7 @@ namespace ircd::m::dbs::desc
 	extern const ircd::db::comparator events__event_auth__cmp;
 	extern const ircd::db::prefix_transform events__event_auth__pfx;
 	extern const ircd::db::descriptor events__event_bad;
+	extern const ircd::db::descriptor events__event_json_offsets;
 	extern const ircd::db::descriptor events__state_node;
 
 	//
@@ -119,6 +120,38 @@ ircd::m::dbs::desc::events__event_bad
 	true,
 };
 
+const ircd::db::descriptor
+ircd::m::dbs::desc::events__event_json_offsets
+{
+	// name
+	"_event_json_offsets",
+
+	// explanation
+	R"(
+
+	This column is deprecated and has been dropped from the schema. This
+	descriptor will erase its presence in the database upon next open.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(uint64_t), typeid(string_view)
+	},
+
+	// options
+	{},
+
+	// comparator
+	{},
+
+	// prefix transform
+	{},
+
+	// drop column
+	true,
+};
+
 const ircd::db::descriptor
 ircd::m::dbs::desc::events_auth_events
 {
@@ -529,6 +562,14 @@ ircd::m::dbs::desc::events
 	// Mapping of all current head events for a room.
 	room_head,
 
+	// (room_id, (term, event_idx)) => (field)
+	// Full-text posting lists of content terms for a room.
+	room_search,
+
+	// (user_id, (event_idx, room_id))
+	// Rooms of a local user ordered by their most recent event.
+	user_room_recency,
+
 	//
 	// These columns are legacy; they have been dropped from the schema.
 	//
@@ -543,5 +584,6 @@ ircd::m::dbs::desc::events
 	events_signatures,
 	events__event_auth,
 	events__event_bad,
+	events__event_json_offsets,
 	events__state_node,
 };
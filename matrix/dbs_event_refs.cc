@@ -16,6 +16,11 @@ namespace ircd::m::dbs
 	static void _index_event_refs_m_relates(db::txn &, const event &, const write_opts &); //query
 	static void _index_event_refs_state(db::txn &, const event &, const write_opts &); // query
 	static void _index_event_refs_auth(db::txn &, const event &, const write_opts &); //query
+	static void _index_event_refs_auth_chain_del(db::txn &, const event &, const write_opts &); //query
+	static void _index_event_refs_auth_chain(db::txn &, const event &, const write_opts &); //query
+	static bool _event_refs_interpose(const write_opts &, const event::idx &, const ref &, const event::closure_idx_bool &);
+	static bool _event_refs_auth_chain_tip(const event::idx &root, const event::idx &, const write_opts &);
+	static event::idx _event_refs_auth_root(const event::idx &, const write_opts &);
 	static void _index_event_refs_prev(db::txn &, const event &, const write_opts &); //query
 	static bool event_refs__cmp_less(const string_view &a, const string_view &b);
 }
@@ -180,6 +185,9 @@ ircd::m::dbs::_index_event_refs(db::txn &txn,
 	if(opts.event_refs.test(uint(ref::NEXT_AUTH)))
 		_index_event_refs_auth(txn, event, opts);
 
+	if(opts.event_refs.test(uint(ref::AUTH_CHAIN)))
+		_index_event_refs_auth_chain(txn, event, opts);
+
 	if(opts.event_refs.test(uint(ref::NEXT_STATE)) ||
 	   opts.event_refs.test(uint(ref::PREV_STATE)))
 		_index_event_refs_state(txn, event, opts);
@@ -312,6 +320,315 @@ ircd::m::dbs::_index_event_refs_auth(db::txn &txn,
 	}
 }
 
+/// Chain cover index of the auth DAG. Each state event is placed on a
+/// chain: it extends the chain of one of its auth_events if that event is
+/// still the last member of its chain, preferring the same (type,state_key);
+/// otherwise it starts a new chain. Its other auth_events are recorded as
+/// links from the chain. An auth chain is then a union of chain prefixes
+/// found by following links with range scans rather than walking events.
+///
+/// An event is only indexed when all of its auth_events are indexed, so an
+/// indexed event implies its entire auth chain is covered.
+///
+// NOTE: QUERY
+void
+ircd::m::dbs::_index_event_refs_auth_chain(db::txn &txn,
+                                           const event &event,
+                                           const write_opts &opts)
+{
+	assert(opts.appendix.test(appendix::EVENT_REFS));
+	assert(opts.event_refs.test(uint(ref::AUTH_CHAIN)));
+
+	if(!opts.allow_queries)
+		return;
+
+	if(!defined(json::get<"state_key"_>(event)))
+		return;
+
+	if(opts.op != db::op::SET)
+		return _index_event_refs_auth_chain_del(txn, event, opts);
+
+	// Already indexed by a prior write of this event.
+	if(_event_refs_auth_root(opts.event_idx, opts))
+		return;
+
+	static const size_t max {16};
+	const event::prev prev{event};
+	const size_t num
+	{
+		std::min(prev.auth_events_count(), max)
+	};
+
+	if(unlikely(num < prev.auth_events_count()))
+		return;
+
+	event::idx auth_idx[max], auth_root[max];
+	for(size_t i(0); i < num; ++i)
+	{
+		auth_idx[i] = find_event_idx(prev.auth_event(i), opts);
+		auth_root[i] = auth_idx[i]?
+			_event_refs_auth_root(auth_idx[i], opts):
+			0UL;
+
+		// Without the whole auth chain covered this event isn't indexed.
+		if(!auth_root[i])
+			return;
+	}
+
+	// Find the chain to extend.
+	ssize_t extend(-1);
+	for(size_t i(0); i < num; ++i)
+	{
+		if(!_event_refs_auth_chain_tip(auth_root[i], auth_idx[i], opts))
+			continue;
+
+		bool same(true);
+		m::get(std::nothrow, auth_idx[i], "type", [&event, &same]
+		(const string_view &type)
+		{
+			same = type == json::get<"type"_>(event);
+		});
+
+		m::get(std::nothrow, auth_idx[i], "state_key", [&event, &same]
+		(const string_view &state_key)
+		{
+			same &= state_key == json::get<"state_key"_>(event);
+		});
+
+		if(extend < 0 || same)
+			extend = i;
+
+		if(same)
+			break;
+	}
+
+	const event::idx &root
+	{
+		extend >= 0?
+			auth_root[extend]:
+			opts.event_idx
+	};
+
+	thread_local char buf[EVENT_REFS_KEY_MAX_SIZE];
+	thread_local char val[sizeof(event::idx) * 2];
+	assert(opts.event_idx != 0 && root != 0);
+	db::txn::append
+	{
+		txn, dbs::event_refs,
+		{
+			opts.op, event_refs_key(buf, opts.event_idx, ref::AUTH_ROOT, root)
+		}
+	};
+
+	db::txn::append
+	{
+		txn, dbs::event_refs,
+		{
+			opts.op, event_refs_key(buf, root, ref::AUTH_CHAIN, opts.event_idx)
+		}
+	};
+
+	for(size_t i(0); i < num; ++i)
+	{
+		// Members of this chain are reached through the chain itself.
+		if(auth_root[i] == root)
+			continue;
+
+		// An earlier member of this chain already reaches the event.
+		const string_view &key
+		{
+			event_refs_key(buf, root, ref::AUTH_LINK, auth_idx[i])
+		};
+
+		const bool linked
+		{
+			root != opts.event_idx &&
+			(db::has(dbs::event_refs, key) || !_event_refs_interpose(opts, root, ref::AUTH_LINK, [&auth_idx, &i]
+			(const event::idx &linked_idx)
+			{
+				return linked_idx != auth_idx[i];
+			}))
+		};
+
+		if(linked)
+			continue;
+
+		event::idx *const link
+		{
+			reinterpret_cast<event::idx *>(val)
+		};
+
+		link[0] = opts.event_idx;
+		link[1] = auth_root[i];
+		db::txn::append
+		{
+			txn, dbs::event_refs,
+			{
+				opts.op, key, string_view{val, sizeof(val)}
+			}
+		};
+	}
+}
+
+// NOTE: QUERY
+void
+ircd::m::dbs::_index_event_refs_auth_chain_del(db::txn &txn,
+                                               const event &event,
+                                               const write_opts &opts)
+{
+	assert(opts.op != db::op::SET);
+	const event::idx &root
+	{
+		_event_refs_auth_root(opts.event_idx, opts)
+	};
+
+	if(!root)
+		return;
+
+	thread_local char buf[EVENT_REFS_KEY_MAX_SIZE];
+	db::txn::append
+	{
+		txn, dbs::event_refs,
+		{
+			opts.op, event_refs_key(buf, opts.event_idx, ref::AUTH_ROOT, root)
+		}
+	};
+
+	db::txn::append
+	{
+		txn, dbs::event_refs,
+		{
+			opts.op, event_refs_key(buf, root, ref::AUTH_CHAIN, opts.event_idx)
+		}
+	};
+
+	// Remove the links made by this event.
+	auto it
+	{
+		dbs::event_refs.begin(event_refs_key(buf, root, ref::AUTH_LINK, 0))
+	};
+
+	for(; it; ++it)
+	{
+		const auto &[type, auth_idx]
+		{
+			event_refs_key(it->first)
+		};
+
+		if(type != ref::AUTH_LINK)
+			break;
+
+		assert(size(it->second) >= sizeof(event::idx));
+		if(byte_view<event::idx>(it->second) != opts.event_idx)
+			continue;
+
+		db::txn::append
+		{
+			txn, dbs::event_refs,
+			{
+				opts.op, event_refs_key(buf, root, ref::AUTH_LINK, auth_idx)
+			}
+		};
+	}
+}
+
+/// Whether the event is the last member of the chain, including members
+/// pending in the interposed txn.
+bool
+ircd::m::dbs::_event_refs_auth_chain_tip(const event::idx &root,
+                                         const event::idx &event_idx,
+                                         const write_opts &opts)
+{
+	char buf[EVENT_REFS_KEY_MAX_SIZE];
+	auto it
+	{
+		dbs::event_refs.begin(event_refs_key(buf, root, ref::AUTH_CHAIN, event_idx + 1))
+	};
+
+	if(it && std::get<0>(event_refs_key(it->first)) == ref::AUTH_CHAIN)
+		return false;
+
+	return _event_refs_interpose(opts, root, ref::AUTH_CHAIN, [&event_idx]
+	(const event::idx &member_idx)
+	{
+		return member_idx <= event_idx;
+	});
+}
+
+/// The root of the event's chain; the interposed txn is consulted first
+/// since the auth events of an event are often written in the same txn.
+ircd::m::event::idx
+ircd::m::dbs::_event_refs_auth_root(const event::idx &event_idx,
+                                    const write_opts &opts)
+{
+	event::idx ret{0};
+	_event_refs_interpose(opts, event_idx, ref::AUTH_ROOT, [&ret]
+	(const event::idx &root)
+	{
+		ret = root;
+		return false;
+	});
+
+	if(ret)
+		return ret;
+
+	char buf[EVENT_REFS_KEY_MAX_SIZE];
+	auto it
+	{
+		dbs::event_refs.begin(event_refs_key(buf, event_idx, ref::AUTH_ROOT, 0))
+	};
+
+	if(!it)
+		return 0UL;
+
+	const auto &[type, root]
+	{
+		event_refs_key(it->first)
+	};
+
+	return type == ref::AUTH_ROOT? root: 0UL;
+}
+
+/// Iterate the refs of the type from the target which are set in the
+/// interposed txn and not yet committed. Returns false if the closure broke.
+bool
+ircd::m::dbs::_event_refs_interpose(const write_opts &opts,
+                                    const event::idx &tgt,
+                                    const ref &type,
+                                    const event::closure_idx_bool &closure)
+{
+	if(!opts.interpose)
+		return true;
+
+	return db::for_each(*opts.interpose, db::delta_closure_bool{[&tgt, &type, &closure]
+	(const db::delta &delta)
+	{
+		if(std::get<db::delta::OP>(delta) != db::op::SET)
+			return true;
+
+		if(std::get<db::delta::COL>(delta) != "_event_refs")
+			return true;
+
+		const string_view &key
+		{
+			std::get<db::delta::KEY>(delta)
+		};
+
+		if(size(key) != sizeof(event::idx) * 2)
+			return true;
+
+		if(byte_view<event::idx>(key.substr(0, sizeof(event::idx))) != tgt)
+			return true;
+
+		const auto &[_type, src]
+		{
+			event_refs_key(key.substr(sizeof(event::idx)))
+		};
+
+		return _type != type || closure(src);
+	}});
+}
+
 // NOTE: QUERY
 void
 ircd::m::dbs::_index_event_refs_state(db::txn &txn,
@@ -773,6 +1090,9 @@ ircd::m::dbs::reflect(const ref &type)
 		case ref::NEXT_AUTH:             return "NEXT_AUTH";
 		case ref::NEXT_STATE:            return "NEXT_STATE";
 		case ref::PREV_STATE:            return "PREV_STATE";
+		case ref::AUTH_CHAIN:            return "AUTH_CHAIN";
+		case ref::AUTH_ROOT:             return "AUTH_ROOT";
+		case ref::AUTH_LINK:             return "AUTH_LINK";
 		case ref::M_RECEIPT__M_READ:     return "M_RECEIPT__M_READ";
 		case ref::M_RELATES:             return "M_RELATES";
 		case ref::M_ROOM_REDACTION:      return "M_ROOM_REDACTION";
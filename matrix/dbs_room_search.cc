@@ -0,0 +1,449 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::dbs
+{
+	static bool room_search__cmp_lt(const string_view &, const string_view &);
+}
+
+decltype(ircd::m::dbs::room_search)
+ircd::m::dbs::room_search;
+
+decltype(ircd::m::dbs::desc::room_search__block__size)
+ircd::m::dbs::desc::room_search__block__size
+{
+	{ "name",     "ircd.m.dbs._room_search.block.size" },
+	{ "default",  512L                                 },
+};
+
+decltype(ircd::m::dbs::desc::room_search__meta_block__size)
+ircd::m::dbs::desc::room_search__meta_block__size
+{
+	{ "name",     "ircd.m.dbs._room_search.meta_block.size" },
+	{ "default",  8192L                                     },
+};
+
+decltype(ircd::m::dbs::desc::room_search__cache__size)
+ircd::m::dbs::desc::room_search__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs._room_search.cache.size" },
+		{ "default",  long(16_MiB)                         },
+	}, []
+	{
+		const size_t &value{room_search__cache__size};
+		db::capacity(db::cache(dbs::room_search), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::room_search__cache_comp__size)
+ircd::m::dbs::desc::room_search__cache_comp__size
+{
+	{
+		{ "name",     "ircd.m.dbs._room_search.cache_comp.size" },
+		{ "default",  long(0_MiB)                               },
+	}, []
+	{
+		const size_t &value{room_search__cache_comp__size};
+		db::capacity(db::cache_compressed(dbs::room_search), value);
+	}
+};
+
+/// Prefix transform for the room_search. The prefix here is the room_id and
+/// the term joined by a \0; the suffix is a \0 and the event_idx. Each prefix
+/// is therefor the posting list of one term in one room.
+///
+const ircd::db::prefix_transform
+ircd::m::dbs::desc::room_search__pfx
+{
+	"_room_search",
+
+	[](const string_view &key)
+	{
+		const auto &[room_id, rest]
+		{
+			split(key, '\0')
+		};
+
+		return has(rest, '\0');
+	},
+
+	[](const string_view &key)
+	{
+		const auto &[room_id, rest]
+		{
+			split(key, '\0')
+		};
+
+		const auto &[term, event_idx]
+		{
+			split(rest, '\0')
+		};
+
+		return key.substr(0, size(room_id) + 1 + size(term));
+	}
+};
+
+/// Comparator for the room_search. Within each posting list the events are
+/// sorted by event_idx from highest to lowest so the most recent matches are
+/// hit first and a paged query can seek directly to its continuation.
+///
+const ircd::db::comparator
+ircd::m::dbs::desc::room_search__cmp
+{
+	"_room_search",
+	room_search__cmp_lt,
+	std::equal_to<string_view>{},
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::room_search
+{
+	// name
+	"_room_search",
+
+	// explanation
+	R"(Full-text index of terms to the events of a room containing them.
+
+	[room_id | term, event_idx] => field
+
+	The text of content.body, content.name and content.topic is split into
+	normalized terms by the indexer. Each term is the prefix of a posting
+	list of the events in the room which contain it. The value is a single
+	byte with a bit set for each content property the term was found in.
+
+	A key with an empty term and event_idx 0 marks a room whose events are
+	all in the index: it's written with the room's create event, or once the
+	history of a room predating the index is rebuilt.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(string_view), typeid(string_view)
+	},
+
+	// options
+	{},
+
+	// comparator
+	room_search__cmp,
+
+	// prefix transform
+	room_search__pfx,
+
+	// drop column
+	false,
+
+	// cache size
+	bool(cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	bool(cache_comp_enable)? -1 : 0,
+
+	// bloom filter bits
+	0, // no bloom filter because of possible comparator issues
+
+	// expect queries hit
+	false,
+
+	// block size
+	size_t(room_search__block__size),
+
+	// meta_block size
+	size_t(room_search__meta_block__size),
+
+	// compression
+	"kLZ4Compression;kSnappyCompression"s,
+};
+
+//
+// indexer
+//
+
+/// Adds an entry to the room_search column for each distinct term found in
+/// the searchable content properties of the event.
+void
+ircd::m::dbs::_index_room_search(db::txn &txn,
+                                 const event &event,
+                                 const write_opts &opts)
+{
+	assert(opts.appendix.test(appendix::ROOM_SEARCH));
+
+	static const std::pair<string_view, uint8_t> fields[]
+	{
+		{ "body",   room_search_field::BODY   },
+		{ "name",   room_search_field::NAME   },
+		{ "topic",  room_search_field::TOPIC  },
+	};
+
+	// A room indexed from its create event needs no rebuild of its history;
+	// see m::search::indexed().
+	if(json::get<"type"_>(event) == "m.room.create")
+	{
+		char buf[ROOM_SEARCH_KEY_MAX_SIZE];
+		db::txn::append
+		{
+			txn, room_search,
+			{
+				opts.op,
+				room_search_key(buf, at<"room_id"_>(event), string_view{}, 0UL),
+				string_view{},
+			}
+		};
+	}
+
+	const json::object &content
+	{
+		json::get<"content"_>(event)
+	};
+
+	if(empty(content))
+		return;
+
+	thread_local char term_buf[ROOM_SEARCH_TERMS_MAX][ROOM_SEARCH_TERM_MAX_SIZE];
+	thread_local std::pair<string_view, uint8_t> term[ROOM_SEARCH_TERMS_MAX];
+	size_t terms(0);
+	for(const auto &field : fields)
+	{
+		const string_view &value
+		{
+			content.get(field.first)
+		};
+
+		if(!value || json::type(value, std::nothrow) != json::STRING)
+			continue;
+
+		const unique_buffer<mutable_buffer> buf
+		{
+			size(value)
+		};
+
+		const string_view text
+		{
+			json::unescape(buf, json::string(value))
+		};
+
+		room_search_terms(text, [&terms, &field]
+		(const string_view &text)
+		{
+			const auto it
+			{
+				std::find_if(term, term + terms, [&text]
+				(const auto &term)
+				{
+					return term.first == text;
+				})
+			};
+
+			if(it != term + terms)
+			{
+				it->second |= field.second;
+				return true;
+			}
+
+			if(terms >= ROOM_SEARCH_TERMS_MAX)
+				return false;
+
+			term[terms] =
+			{
+				string_view
+				{
+					term_buf[terms], copy(term_buf[terms], text)
+				},
+				field.second
+			};
+
+			++terms;
+			return true;
+		});
+	}
+
+	thread_local char buf[ROOM_SEARCH_KEY_MAX_SIZE];
+	const ctx::critical_assertion ca;
+	for(size_t i(0); i < terms; ++i)
+	{
+		const string_view &key
+		{
+			room_search_key(buf, at<"room_id"_>(event), term[i].first, opts.event_idx)
+		};
+
+		const string_view &val
+		{
+			reinterpret_cast<const char *>(&term[i].second), 1
+		};
+
+		db::txn::append
+		{
+			txn, room_search,
+			{
+				opts.op,        // db::op
+				key,            // key
+				val,            // val
+			}
+		};
+	}
+}
+
+//
+// cmp
+//
+
+bool
+ircd::m::dbs::room_search__cmp_lt(const string_view &a,
+                                  const string_view &b)
+{
+	static const auto &pt
+	{
+		desc::room_search__pfx
+	};
+
+	// Extract the prefix from the keys
+	const string_view pre[2]
+	{
+		pt.get(a),
+		pt.get(b),
+	};
+
+	// Prefix size comparison has highest priority for rocksdb
+	if(size(pre[0]) < size(pre[1]))
+		return true;
+
+	// Prefix size comparison has highest priority for rocksdb
+	if(size(pre[0]) > size(pre[1]))
+		return false;
+
+	// Prefix lexical comparison sorts prefixes of the same size
+	if(pre[0] < pre[1])
+		return true;
+
+	// Prefix lexical comparison sorts prefixes of the same size
+	if(pre[0] > pre[1])
+		return false;
+
+	// After the prefix is the \0,event_idx
+	const string_view post[2]
+	{
+		a.substr(size(pre[0])),
+		b.substr(size(pre[1])),
+	};
+
+	// These conditions are matched when the user only supplies a prefix.
+	if(empty(post[0]))
+		return !empty(post[1]);
+
+	if(empty(post[1]))
+		return false;
+
+	const auto &[event_idx_a]
+	{
+		room_search_key(post[0])
+	};
+
+	const auto &[event_idx_b]
+	{
+		room_search_key(post[1])
+	};
+
+	// reverse event_idx to start from highest first like room_events
+	return event_idx_a > event_idx_b;
+}
+
+//
+// key
+//
+
+ircd::m::dbs::room_search_tuple
+ircd::m::dbs::room_search_key(const string_view &amalgam)
+{
+	assert(size(amalgam) == 1 + 8);
+	assert(amalgam.front() == '\0');
+	return room_search_tuple
+	{
+		likely(size(amalgam) >= 1 + 8)?
+			event::idx(byte_view<uint64_t>(amalgam.substr(1, 8))):
+			0UL,
+	};
+}
+
+ircd::string_view
+ircd::m::dbs::room_search_key(const mutable_buffer &out_,
+                              const id::room &room_id,
+                              const string_view &term,
+                              const event::idx &event_idx)
+{
+	assert(room_id);
+	assert(size(term) <= ROOM_SEARCH_TERM_MAX_SIZE);
+	assert(!has(term, '\0'));
+
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, "\0"_sv));
+	consume(out, copy(out, term));
+	consume(out, copy(out, "\0"_sv));
+	consume(out, copy(out, byte_view<string_view>(event_idx)));
+	return { data(out_), data(out) };
+}
+
+//
+// terms
+//
+
+/// Split text into the normalized terms indexed by the room_search column.
+/// The same normalization must be applied to any search_term sought from the
+/// column so this is the only tokenizer for both. Terms are runs of ASCII
+/// alphanumerics or non-ASCII (UTF-8) bytes; ASCII is folded to lower-case.
+/// Terms shorter than two bytes are skipped and longer terms are truncated
+/// to ROOM_SEARCH_TERM_MAX_SIZE at the last whole character. Returns false
+/// if the closure broke.
+bool
+ircd::m::dbs::room_search_terms(const string_view &text,
+                                const room_search_term_closure &closure)
+{
+	static const auto is_term_char{[]
+	(const char &c) noexcept
+	{
+		return std::isalnum(uint8_t(c)) || uint8_t(c) >= 0x80;
+	}};
+
+	char buf[ROOM_SEARCH_TERM_MAX_SIZE];
+	auto it(begin(text));
+	while(it != end(text))
+	{
+		it = std::find_if(it, end(text), is_term_char);
+		const auto stop
+		{
+			std::find_if_not(it, end(text), is_term_char)
+		};
+
+		// Don't leave a partial UTF-8 sequence at the end of a truncated term.
+		size_t len(std::distance(it, stop));
+		if(len > sizeof(buf))
+		{
+			len = sizeof(buf);
+			while(len && (uint8_t(it[len]) & 0xc0) == 0x80)
+				--len;
+		}
+
+		const string_view term
+		{
+			it, len
+		};
+
+		it = stop;
+		if(size(term) < 2)
+			continue;
+
+		if(!closure(tolower(buf, term)))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,256 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::dbs
+{
+	static bool user_room_recency__cmp_lt(const string_view &, const string_view &);
+}
+
+decltype(ircd::m::dbs::user_room_recency)
+ircd::m::dbs::user_room_recency;
+
+decltype(ircd::m::dbs::desc::user_room_recency__block__size)
+ircd::m::dbs::desc::user_room_recency__block__size
+{
+	{ "name",     "ircd.m.dbs._user_room_recency.block.size" },
+	{ "default",  512L                                       },
+};
+
+decltype(ircd::m::dbs::desc::user_room_recency__meta_block__size)
+ircd::m::dbs::desc::user_room_recency__meta_block__size
+{
+	{ "name",     "ircd.m.dbs._user_room_recency.meta_block.size" },
+	{ "default",  8192L                                           },
+};
+
+decltype(ircd::m::dbs::desc::user_room_recency__cache__size)
+ircd::m::dbs::desc::user_room_recency__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs._user_room_recency.cache.size" },
+		{ "default",  long(16_MiB)                               },
+	}, []
+	{
+		const size_t &value{user_room_recency__cache__size};
+		db::capacity(db::cache(dbs::user_room_recency), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::user_room_recency__cache_comp__size)
+ircd::m::dbs::desc::user_room_recency__cache_comp__size
+{
+	{
+		{ "name",     "ircd.m.dbs._user_room_recency.cache_comp.size" },
+		{ "default",  long(0_MiB)                                     },
+	}, []
+	{
+		const size_t &value{user_room_recency__cache_comp__size};
+		db::capacity(db::cache_compressed(dbs::user_room_recency), value);
+	}
+};
+
+/// Prefix transform for the user_room_recency. The prefix here is the
+/// user_id; the suffix is a \0, the event_idx and the room_id.
+///
+const ircd::db::prefix_transform
+ircd::m::dbs::desc::user_room_recency__pfx
+{
+	"_user_room_recency",
+
+	[](const string_view &key)
+	{
+		return has(key, '\0');
+	},
+
+	[](const string_view &key)
+	{
+		return split(key, '\0').first;
+	}
+};
+
+/// Comparator for the user_room_recency. Within each user the rooms are
+/// sorted by event_idx from highest to lowest so the most recently active
+/// room is hit first; rooms with the same event_idx are sorted by room_id.
+///
+const ircd::db::comparator
+ircd::m::dbs::desc::user_room_recency__cmp
+{
+	"_user_room_recency",
+	user_room_recency__cmp_lt,
+	std::equal_to<string_view>{},
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::user_room_recency
+{
+	// name
+	"_user_room_recency",
+
+	// explanation
+	R"(Rooms of each local user ordered by their most recent event.
+
+	[user_id | event_idx, room_id]
+
+	For every room a local user is joined or invited to, the key carries the
+	index number of the room's latest event. When an event becomes the top of
+	a room the entries of the local members are moved to the new event_idx.
+	Iterating a user's prefix yields their rooms by descending activity.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(string_view), typeid(string_view)
+	},
+
+	// options
+	{},
+
+	// comparator
+	user_room_recency__cmp,
+
+	// prefix transform
+	user_room_recency__pfx,
+
+	// drop column
+	false,
+
+	// cache size
+	bool(cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	bool(cache_comp_enable)? -1 : 0,
+
+	// bloom filter bits
+	0, // no bloom filter because of possible comparator issues
+
+	// expect queries hit
+	false,
+
+	// block size
+	size_t(user_room_recency__block__size),
+
+	// meta_block size
+	size_t(user_room_recency__meta_block__size),
+
+	// compression
+	"kLZ4Compression;kSnappyCompression"s,
+};
+
+//
+// cmp
+//
+
+bool
+ircd::m::dbs::user_room_recency__cmp_lt(const string_view &a,
+                                        const string_view &b)
+{
+	static const auto &pt
+	{
+		desc::user_room_recency__pfx
+	};
+
+	// Extract the prefix from the keys
+	const string_view pre[2]
+	{
+		pt.get(a),
+		pt.get(b),
+	};
+
+	// Prefix size comparison has highest priority for rocksdb
+	if(size(pre[0]) < size(pre[1]))
+		return true;
+
+	// Prefix size comparison has highest priority for rocksdb
+	if(size(pre[0]) > size(pre[1]))
+		return false;
+
+	// Prefix lexical comparison sorts prefixes of the same size
+	if(pre[0] < pre[1])
+		return true;
+
+	// Prefix lexical comparison sorts prefixes of the same size
+	if(pre[0] > pre[1])
+		return false;
+
+	// After the prefix is the \0,event_idx,room_id
+	const string_view post[2]
+	{
+		a.substr(size(pre[0])),
+		b.substr(size(pre[1])),
+	};
+
+	// These conditions are matched when the user only supplies a prefix.
+	if(empty(post[0]))
+		return !empty(post[1]);
+
+	if(empty(post[1]))
+		return false;
+
+	const auto &[event_idx_a, room_id_a]
+	{
+		user_room_recency_key(post[0])
+	};
+
+	const auto &[event_idx_b, room_id_b]
+	{
+		user_room_recency_key(post[1])
+	};
+
+	// reverse event_idx to start from highest first like room_events
+	if(event_idx_a != event_idx_b)
+		return event_idx_a > event_idx_b;
+
+	return room_id_a < room_id_b;
+}
+
+//
+// key
+//
+
+ircd::m::dbs::user_room_recency_tuple
+ircd::m::dbs::user_room_recency_key(const string_view &amalgam)
+{
+	assert(size(amalgam) >= 1 + 8);
+	assert(amalgam.front() == '\0');
+	return user_room_recency_tuple
+	{
+		likely(size(amalgam) >= 1 + 8)?
+			event::idx(byte_view<uint64_t>(amalgam.substr(1, 8))):
+			0UL,
+
+		amalgam.substr(1 + 8),
+	};
+}
+
+ircd::string_view
+ircd::m::dbs::user_room_recency_key(const mutable_buffer &out_,
+                                    const id::user &user_id,
+                                    const event::idx &event_idx,
+                                    const id::room &room_id)
+{
+	assert(user_id);
+	mutable_buffer out{out_};
+	consume(out, copy(out, user_id));
+	consume(out, copy(out, "\0"_sv));
+	consume(out, copy(out, byte_view<string_view>(event_idx)));
+	consume(out, copy(out, room_id));
+	return { data(out_), data(out) };
+}
+
+ircd::string_view
+ircd::m::dbs::user_room_recency_key(const mutable_buffer &out_,
+                                    const id::user &user_id)
+{
+	assert(user_id);
+	mutable_buffer out{out_};
+	consume(out, copy(out, user_id));
+	return { data(out_), data(out) };
+}
@@ -124,11 +124,15 @@ ircd::m::vm::conform_report
 			return;
 		}
 
-		// Generate the report here.
-		eval.report = event::conforms
-		{
-			event, opts.non_conform.report
-		};
+		// When the event was part of a batch the report was generated by
+		// eval::mverify(); otherwise generate the report here.
+		if(const auto *const report{eval.reported(event)})
+			eval.report = *report;
+		else
+			eval.report = event::conforms
+			{
+				event, opts.non_conform.report
+			};
 
 		// When opts.conforming is false a bad report is not an error.
 		if(!opts.conforming)
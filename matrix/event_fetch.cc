@@ -97,6 +97,146 @@ ircd::m::seek(std::nothrow_t,
 	return fetch.valid;
 }
 
+/// Fetch a batch of events; the closure is called with the position in the
+/// batch of each event found. When the options select the json query the
+/// whole batch is read from event_json with one query to the database, and
+/// the IDs of events whose JSON lacks one with another; otherwise each event
+/// is fetched in turn.
+size_t
+ircd::m::seek(std::nothrow_t,
+              const vector_view<const event::idx> &event_idx,
+              const event::fetch::multi_closure &closure,
+              const event::fetch::opts &opts)
+{
+	size_t ret(0);
+	if(!event::fetch::should_seek_json(opts))
+	{
+		event::fetch event
+		{
+			opts
+		};
+
+		for(size_t i(0); i < event_idx.size(); ++i)
+			if(seek(std::nothrow, event, event_idx[i]))
+			{
+				closure(i, event);
+				++ret;
+			}
+
+		return ret;
+	}
+
+	static const size_t max {64};
+	string_view key[max];
+	size_t pos[max];
+	std::string source_buf[max];
+	bool found[max];
+
+	// Event IDs missing from the JSON are read from their column for the
+	// whole chunk at once; they're kept in one allocation of max entries.
+	const unique_buffer<mutable_buffer> id_buf
+	{
+		max * event::id::MAX_SIZE
+	};
+
+	string_view event_id[max];
+	auto &event_id_column
+	{
+		dbs::event_column.at(json::indexof<event, "event_id"_>())
+	};
+
+	for(size_t i(0); i < event_idx.size(); )
+	{
+		size_t num(0);
+		for(; i < event_idx.size() && num < max; ++i)
+			if(event_idx[i])
+			{
+				key[num] = byte_view<string_view>(event_idx[i]);
+				pos[num++] = i;
+			}
+
+		// The values only live for the duration of each closure; they're
+		// copied so the chunk can be completed in order once the IDs of the
+		// events which lack them are known.
+		std::fill(found, found + num, false);
+		dbs::event_json(vector_view<const string_view>(key, num), std::nothrow, [&source_buf, &found]
+		(const size_t &j, const string_view &val)
+		{
+			source_buf[j].assign(data(val), size(val));
+			found[j] = true;
+		}, opts.gopts);
+
+		size_t missing(0);
+		string_view missing_key[max];
+		size_t missing_pos[max];
+		for(size_t j(0); j < num; ++j)
+		{
+			event_id[j] = {};
+			if(found[j] && !json::object(source_buf[j]).has("event_id"))
+			{
+				missing_key[missing] = key[j];
+				missing_pos[missing++] = j;
+			}
+		}
+
+		if(missing && event_id_column)
+			event_id_column(vector_view<const string_view>(missing_key, missing), std::nothrow, [&id_buf, &event_id, &missing_pos]
+			(const size_t &k, const string_view &val)
+			{
+				const auto &j(missing_pos[k]);
+				const mutable_buffer buf
+				{
+					data(id_buf) + j * event::id::MAX_SIZE, event::id::MAX_SIZE
+				};
+
+				event_id[j] = string_view
+				{
+					data(buf), copy(buf, val)
+				};
+			}, opts.gopts);
+
+		for(size_t j(0); j < num; ++j) try
+		{
+			if(!found[j])
+				continue;
+
+			const json::object source
+			{
+				source_buf[j]
+			};
+
+			event::id::buf event_id_buf;
+			const event::id id
+			{
+				source.has("event_id")?
+					event::id(json::string(source.at("event_id"))):
+				event_id[j]?
+					event::id(event_id[j]):
+					m::event_id(std::nothrow, event_idx[pos[j]], event_id_buf)
+			};
+
+			const m::event event
+			{
+				source, id, event::keys{opts.keys}
+			};
+
+			closure(pos[j], event);
+			++ret;
+		}
+		catch(const json::parse_error &e)
+		{
+			log::critical
+			{
+				m::log, "Fetching event:%lu JSON from local database :%s",
+				event_idx[pos[j]],
+				e.what(),
+			};
+		}
+	}
+
+	return ret;
+}
+
 //
 // event::fetch
 //
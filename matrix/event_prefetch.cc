@@ -74,3 +74,63 @@ ircd::m::prefetch(const event::idx &event_idx,
 
 	return db::prefetch(column, byte_view<string_view>{event_idx});
 }
+
+size_t
+ircd::m::prefetch(const vector_view<const event::idx> &event_idx,
+                  const event::fetch::opts &opts)
+{
+	if(event::fetch::should_seek_json(opts))
+		return prefetch(event_idx, "json"_sv);
+
+	const event::keys keys
+	{
+		opts.keys
+	};
+
+	const vector_view<const string_view> cols
+	{
+		keys
+	};
+
+	size_t ret(0);
+	for(const auto &col : cols)
+		if(col)
+			ret += prefetch(event_idx, col);
+
+	return ret;
+}
+
+/// Submit the keys for the whole batch to the prefetcher at once, so the
+/// requests to the column are dispatched together rather than one at a
+/// time with each caller iteration.
+size_t
+ircd::m::prefetch(const vector_view<const event::idx> &event_idx,
+                  const string_view &key)
+{
+	const auto &column_idx
+	{
+		json::indexof<event>(key)
+	};
+
+	// Any key which is not a property of the event selects the full json.
+	auto &column
+	{
+		column_idx < dbs::event_column.size()?
+			dbs::event_column.at(column_idx):
+			dbs::event_json
+	};
+
+	size_t ret(0);
+	string_view keys[64];
+	for(size_t i(0); i < event_idx.size(); )
+	{
+		size_t num(0);
+		for(; i < event_idx.size() && num < std::size(keys); ++i)
+			if(event_idx[i])
+				keys[num++] = byte_view<string_view>{event_idx[i]};
+
+		ret += db::prefetch(column, vector_view<const string_view>(keys, num));
+	}
+
+	return ret;
+}
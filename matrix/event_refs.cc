@@ -57,6 +57,7 @@ ircd::m::event::refs::rebuild()
 			wopts.event_idx = event_idx;
 			wopts.appendix.reset();
 			wopts.appendix.set(dbs::appendix::EVENT_REFS);
+			wopts.event_refs.reset(uint(dbs::ref::AUTH_CHAIN));
 			m::dbs::write(txn, json::object{event}, wopts);
 
 			if(++j % log_interval == 0) log::info
@@ -81,6 +82,69 @@ ircd::m::event::refs::rebuild()
 	});
 
 	txn();
+	if(!ctx::interruption_requested())
+		rebuild_auth_chain();
+}
+
+/// The chain cover requires the auth events of an event to be placed before
+/// it, so unlike the other refs this is built serially in index order with
+/// each event committed before the next. Events already placed are skipped
+/// so this backfills the coverage of rooms indexed before the chain cover.
+size_t
+ircd::m::event::refs::rebuild_auth_chain()
+{
+	static const size_t log_interval{8192};
+
+	auto &column
+	{
+		dbs::event_json
+	};
+
+	size_t i(0), ret(0);
+	for(auto it(column.begin()); it; ++it, ++i)
+	{
+		if(ctx::interruption_requested())
+			break;
+
+		const m::event::idx event_idx
+		{
+			byte_view<m::event::idx>(it->first)
+		};
+
+		const json::object event
+		{
+			it->second
+		};
+
+		if(!event.has("state_key"))
+			continue;
+
+		db::txn txn
+		{
+			*m::dbs::events
+		};
+
+		m::dbs::write_opts wopts;
+		wopts.event_idx = event_idx;
+		wopts.appendix.reset();
+		wopts.appendix.set(dbs::appendix::EVENT_REFS);
+		wopts.event_refs.reset();
+		wopts.event_refs.set(uint(dbs::ref::AUTH_CHAIN));
+		m::dbs::write(txn, m::event{event}, wopts);
+		if(!txn.size())
+			continue;
+
+		txn();
+		if(++ret % log_interval == 0) log::info
+		{
+			m::log, "Auth chain builder placed %zu of %zu (@idx: %lu)",
+			ret,
+			i,
+			event_idx
+		};
+	}
+
+	return ret;
 }
 
 bool
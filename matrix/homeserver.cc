@@ -272,6 +272,12 @@ ircd::m::homeserver::homeserver(const struct opts *const &opts)
 
 	if(primary == this)
 		m::init::backfill::init();
+
+	if(primary == this)
+		m::init::recent::init();
+
+	if(primary == this)
+		m::init::search::init();
 }
 
 ircd::m::homeserver::~homeserver()
@@ -283,6 +289,8 @@ noexcept
 		client::terminate_all();         //TODO: XXX
 		server::init::close();           //TODO: XXX
 		client::close_all();             //TODO: XXX
+		m::init::search::fini();
+		m::init::recent::fini();
 		m::init::backfill::fini();
 		client::wait_all();              //TODO: XXX
 		server::init::wait();            //TODO: XXX
@@ -0,0 +1,156 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2019 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::init::recent
+{
+	void worker();
+
+	extern std::unique_ptr<context> worker_context;
+	extern conf::item<bool> enable;
+	extern log::log log;
+};
+
+decltype(ircd::m::init::recent::log)
+ircd::m::init::recent::log
+{
+	"m.init.recent"
+};
+
+decltype(ircd::m::init::recent::enable)
+ircd::m::init::recent::enable
+{
+	{ "name",     "m.init.recent.enable" },
+	{ "default",  true                   },
+};
+
+decltype(ircd::m::init::recent::worker_context)
+ircd::m::init::recent::worker_context;
+
+void
+ircd::m::init::recent::init()
+{
+	if(!enable)
+		return;
+
+	if(ircd::read_only || ircd::write_avoid)
+	{
+		log::warning
+		{
+			log, "Not indexing recent rooms of users because write-avoid flag is set."
+		};
+
+		return;
+	}
+
+	assert(!worker_context);
+	worker_context.reset(new context
+	{
+		"m.init.recent",
+		512_KiB,
+		&worker,
+		context::POST
+	});
+}
+
+void
+ircd::m::init::recent::fini()
+noexcept
+{
+	if(!worker_context)
+		return;
+
+	log::debug
+	{
+		log, "Terminating worker context..."
+	};
+
+	worker_context.reset(nullptr);
+}
+
+/// Local users without any entry in the _user_room_recency index have their
+/// entries built from the present state of their rooms. Such users predate
+/// the index; everyone else is kept up to date by the vm.
+void
+ircd::m::init::recent::worker()
+try
+{
+	// Wait for runlevel RUN before proceeding...
+	run::barrier<ctx::interrupted>{};
+
+	// Set a low priority for this context
+	ionice(ctx::cur(), 4);
+	nice(ctx::cur(), 4);
+
+	users::opts opts;
+	opts.hostpart = my_host();
+
+	size_t users(0), rooms(0);
+	users::for_each(opts, [&users, &rooms]
+	(const user &user)
+	{
+		if(unlikely(ctx::interruption_requested()))
+			return false;
+
+		char buf[dbs::USER_ROOM_RECENCY_KEY_MAX_SIZE];
+		const string_view &key
+		{
+			dbs::user_room_recency_key(buf, user)
+		};
+
+		if(dbs::user_room_recency.begin(key))
+			return true;
+
+		const m::user::rooms user_rooms
+		{
+			user
+		};
+
+		rooms += user_rooms.rebuild_recent();
+		++users;
+		return true;
+	});
+
+	if(unlikely(ctx::interruption_requested()))
+		return;
+
+	if(users)
+		log::notice
+		{
+			log, "Indexed %zu recent rooms of %zu users.",
+			rooms,
+			users,
+		};
+}
+catch(const ctx::interrupted &e)
+{
+	log::derror
+	{
+		log, "Worker interrupted without indexing the recent rooms of all users."
+	};
+
+	throw;
+}
+catch(const ctx::terminated &e)
+{
+	log::error
+	{
+		log, "Worker terminated without indexing the recent rooms of all users."
+	};
+
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "Worker :%s",
+		e.what(),
+	};
+}
@@ -0,0 +1,146 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::init::search
+{
+	void worker();
+
+	extern std::unique_ptr<context> worker_context;
+	extern conf::item<bool> enable;
+	extern log::log log;
+};
+
+decltype(ircd::m::init::search::log)
+ircd::m::init::search::log
+{
+	"m.init.search"
+};
+
+decltype(ircd::m::init::search::enable)
+ircd::m::init::search::enable
+{
+	{ "name",     "m.init.search.enable" },
+	{ "default",  true                   },
+};
+
+decltype(ircd::m::init::search::worker_context)
+ircd::m::init::search::worker_context;
+
+void
+ircd::m::init::search::init()
+{
+	if(!enable)
+		return;
+
+	if(ircd::read_only || ircd::write_avoid)
+	{
+		log::warning
+		{
+			log, "Not indexing the history of rooms for search because write-avoid flag is set."
+		};
+
+		return;
+	}
+
+	assert(!worker_context);
+	worker_context.reset(new context
+	{
+		"m.init.search",
+		512_KiB,
+		&worker,
+		context::POST
+	});
+}
+
+void
+ircd::m::init::search::fini()
+noexcept
+{
+	if(!worker_context)
+		return;
+
+	log::debug
+	{
+		log, "Terminating worker context..."
+	};
+
+	worker_context.reset(nullptr);
+}
+
+/// Rooms which aren't marked as indexed in _room_search predate the index;
+/// their history is indexed here so it can be found by /search. Rooms with
+/// a local member in any state are included since users can search rooms
+/// they have left.
+void
+ircd::m::init::search::worker()
+try
+{
+	// Wait for runlevel RUN before proceeding...
+	run::barrier<ctx::interrupted>{};
+
+	// Set a low priority for this context
+	ionice(ctx::cur(), 4);
+	nice(ctx::cur(), 4);
+
+	size_t rooms(0), events(0);
+	m::rooms::for_each([&rooms, &events]
+	(const room::id &room_id)
+	{
+		if(unlikely(ctx::interruption_requested()))
+			return false;
+
+		if(m::internal(room_id) || m::search::indexed(room_id))
+			return true;
+
+		if(m::room::members(room_id).empty(string_view{}, my_host()))
+			return true;
+
+		events += m::search::rebuild(room_id);
+		++rooms;
+		return true;
+	});
+
+	if(unlikely(ctx::interruption_requested()))
+		return;
+
+	if(rooms)
+		log::notice
+		{
+			log, "Indexed %zu events of %zu rooms for search.",
+			events,
+			rooms,
+		};
+}
+catch(const ctx::interrupted &e)
+{
+	log::derror
+	{
+		log, "Worker interrupted without indexing the history of all rooms."
+	};
+
+	throw;
+}
+catch(const ctx::terminated &e)
+{
+	log::error
+	{
+		log, "Worker terminated without indexing the history of all rooms."
+	};
+
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "Worker :%s",
+		e.what(),
+	};
+}
@@ -16,6 +16,15 @@ namespace ircd::m
 	static void check_room_auth_rule_3(const m::event &, room::auth::hookdata &);
 	static void check_room_auth_rule_2(const m::event &, room::auth::hookdata &);
 
+	// chain root => last member reached
+	using auth_chain_reach = std::map<event::idx, event::idx>;
+
+	static event::idx auth_chain_root(const event::idx &);
+	static event::idx auth_chain_prev(const event::idx &root, const event::idx &);
+	static bool auth_chain_members(const event::idx &root, const event::idx_range &, const event::closure_idx_bool &);
+	static bool auth_chain_cover(auth_chain_reach &, const event::idx &);
+	static bool auth_chain_walk(const event::idx &, const event::closure_idx_bool &);
+
 	extern hook::site<room::auth::hookdata &> room_auth_hook;
 }
 
@@ -335,6 +344,31 @@ ircd::m::room::auth::check(const event &event,
 	return check(event, vector_view<event::idx>{idx, 5});
 }
 
+ircd::m::room::auth::passfail
+ircd::m::room::auth::check(const event &event,
+                           const state::resolve &state)
+{
+	using json::at;
+
+	m::event::idx idx[5]
+	{
+		state.get(std::nothrow, "m.room.create", ""),
+		state.get(std::nothrow, "m.room.power_levels", ""),
+		state.get(std::nothrow, "m.room.member", at<"sender"_>(event)),
+
+		at<"type"_>(event) == "m.room.member" &&
+		(membership(event) == "join" || membership(event) == "invite")?
+			state.get(std::nothrow, "m.room.join_rules", ""): 0UL,
+
+		at<"type"_>(event) == "m.room.member" &&
+		at<"sender"_>(event) != json::get<"state_key"_>(event) &&
+		valid(m::id::USER, json::get<"state_key"_>(event))?
+			state.get(std::nothrow, "m.room.member", at<"state_key"_>(event)): 0UL,
+	};
+
+	return check(event, vector_view<event::idx>{idx, 5});
+}
+
 ircd::m::room::auth::passfail
 ircd::m::room::auth::check(const event &event,
                            const vector_view<event::idx> &idx)
@@ -812,6 +846,270 @@ const
 bool
 ircd::m::room::auth::chain::for_each(const closure &closure)
 const
+{
+	auth_chain_reach reach;
+	if(!auth_chain_cover(reach, idx))
+		return auth_chain_walk(idx, closure);
+
+	std::vector<event::idx> ret;
+	for(const auto &[root, last] : reach)
+		auth_chain_members(root, {0, last}, [&ret]
+		(const event::idx &member)
+		{
+			ret.emplace_back(member);
+			return true;
+		});
+
+	std::sort(begin(ret), end(ret));
+	for(const auto &idx : ret)
+		if(!closure(idx))
+			return false;
+
+	return true;
+}
+
+/// An event is in the difference when it is reached on its chain by the
+/// auth chain of at least one event but not all of them; on each chain this
+/// is the span between the lowest and the highest member reached.
+bool
+ircd::m::room::auth::chain::difference(const vector_view<const event::idx> &idx,
+                                       const closure &closure)
+{
+	std::vector<auth_chain_reach> reach(idx.size());
+	for(size_t i(0); i < idx.size(); ++i)
+	{
+		if(auth_chain_cover(reach[i], idx[i]))
+			continue;
+
+		// Without the cover the chains are walked into sets instead.
+		std::vector<std::set<event::idx>> set(idx.size());
+		for(size_t j(0); j < idx.size(); ++j)
+			auth_chain_walk(idx[j], [&set, &j]
+			(const event::idx &ref)
+			{
+				set[j].emplace(ref);
+				return true;
+			});
+
+		std::set<event::idx> all;
+		for(const auto &s : set)
+			all.insert(begin(s), end(s));
+
+		for(const auto &ref : all)
+			if(!std::all_of(begin(set), end(set), [&ref](const auto &s) { return s.count(ref); }))
+				if(!closure(ref))
+					return false;
+
+		return true;
+	}
+
+	std::map<event::idx, event::idx_range> span;
+	for(const auto &r : reach)
+		for(const auto &[root, last] : r)
+			span.emplace(root, event::idx_range{last, last});
+
+	for(auto &[root, range] : span)
+		for(const auto &r : reach)
+		{
+			const auto it(r.find(root));
+			const auto last(it != end(r)? it->second : 0UL);
+			range.first = std::min(range.first, last);
+			range.second = std::max(range.second, last);
+		}
+
+	std::vector<event::idx> ret;
+	for(const auto &[root, range] : span)
+		if(range.first < range.second)
+			auth_chain_members(root, range, [&ret]
+			(const event::idx &member)
+			{
+				ret.emplace_back(member);
+				return true;
+			});
+
+	std::sort(begin(ret), end(ret));
+	for(const auto &idx : ret)
+		if(!closure(idx))
+			return false;
+
+	return true;
+}
+
+/// Resolve the auth chain of the event into the last member reached on each
+/// chain of the cover index. False when the auth chain isn't covered.
+bool
+ircd::m::auth_chain_cover(auth_chain_reach &ret,
+                          const event::idx &idx)
+{
+	// Links are followed from the members of a chain in (first, second].
+	std::deque<std::tuple<event::idx, event::idx, event::idx>> q;
+	const auto push{[&ret, &q]
+	(const event::idx &root, const event::idx &member)
+	{
+		auto &last(ret[root]);
+		if(last >= member)
+			return;
+
+		q.emplace_back(root, last, member);
+		last = member;
+	}};
+
+	const auto root
+	{
+		auth_chain_root(idx)
+	};
+
+	if(root)
+	{
+		// The event itself is not part of its auth chain; only its links
+		// and the members of its chain before it.
+		q.emplace_back(root, idx - 1, idx);
+		if(const auto prev{auth_chain_prev(root, idx)}; prev)
+			push(root, prev);
+	}
+	else
+	{
+		// Events which aren't indexed (i.e. not state) start from their
+		// auth_events instead.
+		m::event::fetch event;
+		if(!seek(std::nothrow, event, idx))
+			return false;
+
+		const m::event::prev prev{event};
+		for(size_t i(0); i < prev.auth_events_count(); ++i)
+		{
+			const auto &auth_idx
+			{
+				m::index(std::nothrow, prev.auth_event(i))
+			};
+
+			if(!auth_idx)
+				continue;
+
+			const auto &auth_root
+			{
+				auth_chain_root(auth_idx)
+			};
+
+			if(!auth_root)
+				return false;
+
+			push(auth_root, auth_idx);
+		}
+	}
+
+	char buf[dbs::EVENT_REFS_KEY_MAX_SIZE];
+	while(!q.empty())
+	{
+		const auto [root, first, second]
+		{
+			q.front()
+		};
+
+		q.pop_front();
+		auto it
+		{
+			dbs::event_refs.begin(dbs::event_refs_key(buf, root, dbs::ref::AUTH_LINK, 0))
+		};
+
+		for(; it; ++it)
+		{
+			const auto &[type, ref]
+			{
+				dbs::event_refs_key(it->first)
+			};
+
+			if(type != dbs::ref::AUTH_LINK)
+				break;
+
+			if(unlikely(size(it->second) < sizeof(event::idx) * 2))
+				continue;
+
+			const event::idx *const link
+			{
+				reinterpret_cast<const event::idx *>(data(it->second))
+			};
+
+			if(link[0] > first && link[0] <= second)
+				push(link[1], ref);
+		}
+	}
+
+	return true;
+}
+
+bool
+ircd::m::auth_chain_members(const event::idx &root,
+                            const event::idx_range &range,
+                            const event::closure_idx_bool &closure)
+{
+	char buf[dbs::EVENT_REFS_KEY_MAX_SIZE];
+	auto it
+	{
+		dbs::event_refs.begin(dbs::event_refs_key(buf, root, dbs::ref::AUTH_CHAIN, range.first + 1))
+	};
+
+	for(; it; ++it)
+	{
+		const auto &[type, member]
+		{
+			dbs::event_refs_key(it->first)
+		};
+
+		if(type != dbs::ref::AUTH_CHAIN || member > range.second)
+			break;
+
+		if(!closure(member))
+			return false;
+	}
+
+	return true;
+}
+
+ircd::m::event::idx
+ircd::m::auth_chain_prev(const event::idx &root,
+                         const event::idx &idx)
+{
+	char buf[dbs::EVENT_REFS_KEY_MAX_SIZE];
+	auto it
+	{
+		dbs::event_refs.begin(dbs::event_refs_key(buf, root, dbs::ref::AUTH_CHAIN, idx))
+	};
+
+	if(!it || !--it)
+		return 0UL;
+
+	const auto &[type, member]
+	{
+		dbs::event_refs_key(it->first)
+	};
+
+	return type == dbs::ref::AUTH_CHAIN && member < idx? member: 0UL;
+}
+
+ircd::m::event::idx
+ircd::m::auth_chain_root(const event::idx &idx)
+{
+	char buf[dbs::EVENT_REFS_KEY_MAX_SIZE];
+	auto it
+	{
+		dbs::event_refs.begin(dbs::event_refs_key(buf, idx, dbs::ref::AUTH_ROOT, 0))
+	};
+
+	if(!it)
+		return 0UL;
+
+	const auto &[type, root]
+	{
+		dbs::event_refs_key(it->first)
+	};
+
+	return type == dbs::ref::AUTH_ROOT? root: 0UL;
+}
+
+bool
+ircd::m::auth_chain_walk(const event::idx &idx,
+                         const event::closure_idx_bool &closure)
 {
 	m::event::fetch e, a;
 	std::set<event::idx> ae;
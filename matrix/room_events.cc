@@ -447,6 +447,120 @@ const
 	return std::get<0>(part);
 }
 
+//
+// room::events::readahead
+//
+
+decltype(ircd::m::room::events::readahead::max)
+ircd::m::room::events::readahead::max
+{
+	{ "name",     "ircd.m.room.events.readahead.max" },
+	{ "default",  64L                                },
+};
+
+ircd::m::room::events::readahead::readahead(const events &followed,
+                                            const size_t &limit,
+                                            const bool &backward)
+:fopts
+{
+	followed._event.fopts
+}
+,limit
+{
+	std::min(limit, size_t(max))
+}
+,backward
+{
+	backward
+}
+{
+	if(!followed || !this->limit)
+		return;
+
+	// Position at the followed iterator from its key without the depth
+	// query made by seek_idx().
+	char buf[dbs::ROOM_EVENTS_KEY_MAX_SIZE];
+	const string_view seek_key
+	{
+		dbs::room_events_key(buf, followed.room.room_id, followed.depth(), followed.event_idx())
+	};
+
+	it.room = followed.room;
+	it.it = dbs::room_events.begin(seek_key);
+	if(!it)
+		return;
+
+	backward? --it: ++it;
+	fill();
+}
+
+/// The followed iterator has moved one position.
+size_t
+ircd::m::room::events::readahead::operator()()
+{
+	if(lead)
+		--lead;
+
+	if(pending.size() > lead)
+	{
+		pending.pop_front();
+		staged -= bool(staged);
+	}
+
+	return fill();
+}
+
+size_t
+ircd::m::room::events::readahead::fill()
+{
+	assert(fopts);
+	size_t ret(0);
+	for(; it && lead < limit; backward? --it: ++it, ++lead)
+	{
+		const auto event_idx
+		{
+			it.event_idx()
+		};
+
+		ret += m::prefetch(event_idx, *fopts);
+		pending.emplace_back(event_idx);
+	}
+
+	return ret + stage();
+}
+
+/// The sender is only known once the event itself has been read, so the
+/// membership prefetch is deferred until the event is found in cache at
+/// half the lead; one which missed the cache is not waited for.
+size_t
+ircd::m::room::events::readahead::stage()
+{
+	const m::room::state state
+	{
+		it.room
+	};
+
+	size_t ret(0);
+	for(; staged < pending.size() && staged < (limit + 1) / 2; ++staged)
+	{
+		const auto &event_idx
+		{
+			pending.at(staged)
+		};
+
+		if(!m::cached(event_idx, *fopts))
+			continue;
+
+		m::get(std::nothrow, event_idx, "sender", [&state, &ret]
+		(const string_view &sender)
+		{
+			ret += state.prefetch("m.room.member", sender);
+		});
+	}
+
+	return ret;
+}
+
 //
 // room::events::missing
 //
@@ -0,0 +1,809 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2019 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m
+{
+	using state_resolve_cells = room::state::resolve::cells;
+	using state_resolve_set = std::set<std::string, std::less<>>;
+	using state_resolve_events = std::map<event::idx, event::fetch>;
+	using state_resolve_memo = std::map<std::vector<event::idx>, std::pair<std::shared_ptr<const state_resolve_cells>, uint64_t>>;
+
+	static string_view state_resolve_cell(const mutable_buffer &, const string_view &type, const string_view &state_key);
+	static std::pair<string_view, string_view> state_resolve_cell(const string_view &);
+	static event::idx state_resolve_auth_event(const event &, const string_view &type, const string_view &state_key);
+	static event::idx state_resolve_power_prev(const event::idx &);
+	static int64_t state_resolve_power_level(const room &, const event &);
+	static event::idx state_resolve_get(const state_resolve_cells &, const state_resolve_set &, const room::state::history &, const string_view &type, const string_view &state_key);
+	static bool state_resolve_apply(state_resolve_cells &, const state_resolve_set &, const room::state::history &, const event &, const event::idx &);
+	static std::vector<event::idx> state_resolve_power_order(const room &, const state_resolve_events &, const std::set<event::idx> &);
+	static std::vector<event::idx> state_resolve_mainline_order(const state_resolve_events &, const std::set<event::idx> &, const event::idx &power);
+	static void state_resolve_conflicted(state_resolve_set &, std::set<event::idx> &, const room &, const room::state::history &, const std::vector<event::idx> &heads);
+	static state_resolve_cells state_resolve(const room &, const room::state::history &, const std::vector<event::idx> &heads);
+	static void state_resolve_evict(const size_t &max);
+
+	extern state_resolve_memo state_resolve_cache;
+	extern uint64_t state_resolve_clock;
+}
+
+decltype(ircd::m::room::state::resolve::cache_max)
+ircd::m::room::state::resolve::cache_max
+{
+	{ "name",     "ircd.m.room.state.resolve.cache.max" },
+	{ "default",  256L                                  },
+};
+
+decltype(ircd::m::room::state::resolve::depth_max)
+ircd::m::room::state::resolve::depth_max
+{
+	{ "name",     "ircd.m.room.state.resolve.depth.max" },
+	{ "default",  1024L                                 },
+};
+
+decltype(ircd::m::state_resolve_cache)
+ircd::m::state_resolve_cache;
+
+decltype(ircd::m::state_resolve_clock)
+ircd::m::state_resolve_clock;
+
+//
+// room::state::resolve
+//
+
+ircd::m::room::state::resolve::resolve(const m::room &room,
+                                       const vector_view<const event::idx> &heads)
+:history
+{
+	room, -1
+}
+,heads
+{
+	std::begin(heads), std::end(heads)
+}
+{
+	auto &vec(this->heads);
+	vec.erase(std::remove(std::begin(vec), std::end(vec), 0UL), std::end(vec));
+	std::sort(std::begin(vec), std::end(vec));
+	vec.erase(std::unique(std::begin(vec), std::end(vec)), std::end(vec));
+
+	// The state after a head includes the head; the history bound is
+	// exclusive of its depth.
+	if(!vec.empty())
+		history.bound = 0;
+
+	for(const auto &head : vec)
+		history.bound = std::max(history.bound, m::get<int64_t>(head, "depth") + 1);
+
+	static const std::shared_ptr<const cells> empty
+	{
+		std::make_shared<const cells>()
+	};
+
+	// A single head is the state at that head; nothing is conflicted.
+	if(vec.size() < 2)
+	{
+		resolved = empty;
+		return;
+	}
+
+	auto it
+	{
+		state_resolve_cache.find(vec)
+	};
+
+	if(it == std::end(state_resolve_cache))
+	{
+		auto result
+		{
+			std::make_shared<const cells>(state_resolve(room, history, vec))
+		};
+
+		log::debug
+		{
+			log, "Resolved %zu conflicted cells in %s across %zu heads",
+			result->size(),
+			string_view{room.room_id},
+			vec.size(),
+		};
+
+		// Another context may have resolved the same heads meanwhile.
+		it = state_resolve_cache.emplace(vec, std::make_pair(std::move(result), 0UL)).first;
+	}
+
+	it->second.second = ++state_resolve_clock;
+	resolved = it->second.first;
+	state_resolve_evict(size_t(cache_max));
+}
+
+ircd::m::event::idx
+ircd::m::room::state::resolve::get(const string_view &type,
+                                   const string_view &state_key)
+const
+{
+	const auto ret
+	{
+		get(std::nothrow, type, state_key)
+	};
+
+	if(unlikely(!ret))
+		throw m::NOT_FOUND
+		{
+			"(%s,%s) in %s resolved across %zu heads",
+			type,
+			state_key,
+			string_view{history.space.room.room_id},
+			heads.size(),
+		};
+
+	return ret;
+}
+
+ircd::m::event::idx
+ircd::m::room::state::resolve::get(std::nothrow_t,
+                                   const string_view &type,
+                                   const string_view &state_key)
+const
+{
+	assert(resolved);
+	char buf[event::TYPE_MAX_SIZE + 1 + event::STATE_KEY_MAX_SIZE];
+	const auto it
+	{
+		resolved->find(state_resolve_cell(buf, type, state_key))
+	};
+
+	if(it != std::end(*resolved))
+		return it->second;
+
+	return history.get(std::nothrow, type, state_key);
+}
+
+bool
+ircd::m::room::state::resolve::has(const string_view &type,
+                                   const string_view &state_key)
+const
+{
+	return get(std::nothrow, type, state_key) != 0;
+}
+
+size_t
+ircd::m::room::state::resolve::count()
+const
+{
+	size_t ret(0);
+	for_each([&ret]
+	(const auto &, const auto &, const auto &)
+	{
+		++ret;
+		return true;
+	});
+
+	return ret;
+}
+
+bool
+ircd::m::room::state::resolve::for_each(const closure_bool &closure)
+const
+{
+	assert(resolved);
+	char buf[event::TYPE_MAX_SIZE + 1 + event::STATE_KEY_MAX_SIZE];
+	const bool ret
+	{
+		history.for_each([this, &closure, &buf]
+		(const auto &type, const auto &state_key, const auto &depth, const auto &event_idx)
+		{
+			if(resolved->count(state_resolve_cell(buf, type, state_key)))
+				return true;
+
+			return closure(type, state_key, event_idx);
+		})
+	};
+
+	if(!ret)
+		return false;
+
+	for(const auto &[cell, event_idx] : *resolved)
+	{
+		if(!event_idx)
+			continue;
+
+		const auto &[type, state_key]
+		{
+			state_resolve_cell(cell)
+		};
+
+		if(!closure(type, state_key, event_idx))
+			return false;
+	}
+
+	return true;
+}
+
+//
+// internal
+//
+
+ircd::m::state_resolve_cells
+ircd::m::state_resolve(const room &room,
+                       const room::state::history &history,
+                       const std::vector<event::idx> &heads)
+{
+	state_resolve_set conflicted;
+	std::set<event::idx> full;
+	state_resolve_conflicted(conflicted, full, room, history, heads);
+
+	// The auth difference joins the conflicted events into the full set.
+	const std::vector<event::idx> conflicted_idx
+	{
+		std::begin(full), std::end(full)
+	};
+
+	room::auth::chain::difference(vector_view<const event::idx>(conflicted_idx), [&full]
+	(const event::idx &event_idx)
+	{
+		full.emplace(event_idx);
+		return true;
+	});
+
+	state_resolve_events events;
+	for(const auto &event_idx : full)
+	{
+		const auto &event
+		{
+			events.emplace
+			(
+				std::piecewise_construct,
+				std::forward_as_tuple(event_idx),
+				std::forward_as_tuple(std::nothrow, event_idx)
+			)
+			.first->second
+		};
+
+		const bool valid
+		{
+			event.valid &&
+			json::get<"room_id"_>(event) == room.room_id &&
+			defined(json::get<"state_key"_>(event))
+		};
+
+		if(!valid)
+			events.erase(event_idx);
+	}
+
+	// Power events and the events of the full set in their auth chains.
+	std::set<event::idx> power;
+	for(const auto &[event_idx, event] : events)
+		if(room::auth::is_power_event(event))
+			power.emplace(event_idx);
+
+	for(const auto &event_idx : std::vector<event::idx>(std::begin(power), std::end(power)))
+		room::auth::chain{event_idx}.for_each([&events, &power]
+		(const event::idx &event_idx)
+		{
+			if(events.count(event_idx))
+				power.emplace(event_idx);
+
+			return true;
+		});
+
+	state_resolve_cells partial;
+	for(const auto &event_idx : state_resolve_power_order(room, events, power))
+		state_resolve_apply(partial, conflicted, history, events.at(event_idx), event_idx);
+
+	std::set<event::idx> others;
+	for(const auto &[event_idx, event] : events)
+		if(!power.count(event_idx))
+			others.emplace(event_idx);
+
+	const auto power_idx
+	{
+		state_resolve_get(partial, conflicted, history, "m.room.power_levels", "")
+	};
+
+	for(const auto &event_idx : state_resolve_mainline_order(events, others, power_idx))
+		state_resolve_apply(partial, conflicted, history, events.at(event_idx), event_idx);
+
+	// Conflicted cells which nothing passed for are resolved to nothing; the
+	// unconflicted state is reapplied over everything else.
+	state_resolve_cells ret;
+	for(const auto &cell : conflicted)
+	{
+		const auto it(partial.find(cell));
+		ret.emplace(cell, it != std::end(partial)? it->second : 0UL);
+	}
+
+	for(const auto &[cell, event_idx] : partial)
+	{
+		if(conflicted.count(cell))
+			continue;
+
+		const auto &[type, state_key]
+		{
+			state_resolve_cell(cell)
+		};
+
+		if(!history.get(std::nothrow, type, state_key))
+			ret.emplace(cell, event_idx);
+	}
+
+	return ret;
+}
+
+/// Cells which differ between the heads were written between the shallowest
+/// and the deepest head. For each of those the value at every head is the
+/// latest in the state-space below its bound; several at that depth are a
+/// fork of their own and are all conflicted.
+void
+ircd::m::state_resolve_conflicted(state_resolve_set &conflicted,
+                                  std::set<event::idx> &full,
+                                  const room &room,
+                                  const room::state::history &history,
+                                  const std::vector<event::idx> &heads)
+{
+	std::vector<int64_t> bound(heads.size());
+	for(size_t i(0); i < heads.size(); ++i)
+		bound[i] = m::get<int64_t>(heads[i], "depth") + 1;
+
+	const auto &[lower, upper]
+	{
+		std::minmax_element(std::begin(bound), std::end(bound))
+	};
+
+	// The span is set by the depths of the heads, which a remote chooses;
+	// cells written deeper than the limit are taken as unconflicted.
+	const uint64_t span
+	(
+		*upper - *lower
+	);
+
+	const bool limited
+	{
+		span > size_t(room::state::resolve::depth_max)
+	};
+
+	const int64_t floor
+	{
+		limited?
+			*upper - 1 - int64_t(room::state::resolve::depth_max):
+			*lower - 1
+	};
+
+	if(unlikely(limited))
+		log::dwarning
+		{
+			log, "Conflicts in %s scanned over %zu of %lu depths.",
+			string_view{room.room_id},
+			size_t(room::state::resolve::depth_max),
+			span,
+		};
+
+	char buf[event::TYPE_MAX_SIZE + 1 + event::STATE_KEY_MAX_SIZE];
+	state_resolve_set touched;
+	for(m::room::events it{room, uint64_t(*upper - 1)}; it && int64_t(it.depth()) >= floor; --it)
+	{
+		const auto event_idx
+		{
+			it.event_idx()
+		};
+
+		string_view state_key;
+		char state_key_buf[event::STATE_KEY_MAX_SIZE];
+		if(!m::get(std::nothrow, event_idx, "state_key", [&state_key, &state_key_buf]
+		(const string_view &value)
+		{
+			state_key = { state_key_buf, copy(state_key_buf, value) };
+		}))
+			continue;
+
+		m::get(std::nothrow, event_idx, "type", [&state_key, &touched, &buf]
+		(const string_view &type)
+		{
+			touched.emplace(state_resolve_cell(buf, type, state_key));
+		});
+	}
+
+	std::vector<std::pair<int64_t, event::idx>> space;
+	std::vector<std::vector<event::idx>> value(heads.size());
+	for(const auto &cell : touched)
+	{
+		const auto &[type, state_key]
+		{
+			state_resolve_cell(cell)
+		};
+
+		space.clear();
+		history.space.for_each(type, state_key, [&space, &upper]
+		(const auto &, const auto &, const auto &depth, const auto &event_idx)
+		{
+			if(depth < *upper)
+				space.emplace_back(depth, event_idx);
+
+			return true;
+		});
+
+		for(size_t i(0); i < heads.size(); ++i)
+		{
+			int64_t top(-1);
+			for(const auto &[depth, event_idx] : space)
+				if(depth < bound[i])
+					top = std::max(top, depth);
+
+			value[i].clear();
+			for(const auto &[depth, event_idx] : space)
+				if(depth == top)
+					value[i].emplace_back(event_idx);
+
+			std::sort(std::begin(value[i]), std::end(value[i]));
+		}
+
+		const bool agree
+		{
+			value.front().size() <= 1 &&
+			std::all_of(std::begin(value), std::end(value), [&value]
+			(const auto &value_)
+			{
+				return value_ == value.front();
+			})
+		};
+
+		if(agree)
+			continue;
+
+		conflicted.emplace(cell);
+		for(const auto &value_ : value)
+			full.insert(std::begin(value_), std::end(value_));
+	}
+}
+
+/// Power events are ordered so that every event follows the events of the
+/// set in its auth_events; of the events which may go next the one sent
+/// with the highest power level goes first, then the oldest, then by id.
+std::vector<ircd::m::event::idx>
+ircd::m::state_resolve_power_order(const room &room,
+                                   const state_resolve_events &events,
+                                   const std::set<event::idx> &power)
+{
+	using key = std::tuple<int64_t, int64_t, string_view, event::idx>;
+
+	std::map<event::idx, size_t> degree;
+	std::multimap<event::idx, event::idx> next;
+	for(const auto &event_idx : power)
+	{
+		const event::prev prev
+		{
+			events.at(event_idx)
+		};
+
+		auto &count(degree[event_idx]);
+		for(size_t i(0); i < prev.auth_events_count(); ++i)
+		{
+			const auto auth_idx
+			{
+				m::index(std::nothrow, prev.auth_event(i))
+			};
+
+			if(!power.count(auth_idx))
+				continue;
+
+			next.emplace(auth_idx, event_idx);
+			++count;
+		}
+	}
+
+	const auto make_key{[&room, &events]
+	(const event::idx &event_idx) -> key
+	{
+		const auto &event
+		{
+			events.at(event_idx)
+		};
+
+		return
+		{
+			-state_resolve_power_level(room, event),
+			json::get<"origin_server_ts"_>(event),
+			event.event_id,
+			event_idx,
+		};
+	}};
+
+	std::set<key> ready;
+	for(const auto &[event_idx, count] : degree)
+		if(!count)
+			ready.emplace(make_key(event_idx));
+
+	std::vector<event::idx> ret;
+	ret.reserve(power.size());
+	while(!ready.empty())
+	{
+		const auto event_idx
+		{
+			std::get<3>(*std::begin(ready))
+		};
+
+		ready.erase(std::begin(ready));
+		ret.emplace_back(event_idx);
+
+		const auto range
+		{
+			next.equal_range(event_idx)
+		};
+
+		for(auto it(range.first); it != range.second; ++it)
+			if(!--degree.at(it->second))
+				ready.emplace(make_key(it->second));
+	}
+
+	return ret;
+}
+
+/// The mainline is the resolved power levels and the power levels preceding
+/// it in their auth_events back to the room's first. Other events are
+/// ordered by the position on the mainline of the closest power levels in
+/// their auth chain, then the oldest, then by id.
+std::vector<ircd::m::event::idx>
+ircd::m::state_resolve_mainline_order(const state_resolve_events &events,
+                                      const std::set<event::idx> &others,
+                                      const event::idx &power_idx)
+{
+	using key = std::tuple<size_t, int64_t, string_view, event::idx>;
+
+	std::vector<event::idx> mainline;
+	for(auto event_idx(power_idx); event_idx; event_idx = state_resolve_power_prev(event_idx))
+	{
+		if(std::find(std::begin(mainline), std::end(mainline), event_idx) != std::end(mainline))
+			break;
+
+		mainline.emplace_back(event_idx);
+	}
+
+	std::map<event::idx, size_t> position;
+	for(size_t i(0); i < mainline.size(); ++i)
+		position.emplace(mainline[i], mainline.size() - i);
+
+	std::set<key> order;
+	for(const auto &event_idx : others)
+	{
+		const auto &event
+		{
+			events.at(event_idx)
+		};
+
+		std::vector<event::idx> walked;
+		auto power_idx
+		{
+			state_resolve_auth_event(event, "m.room.power_levels", "")
+		};
+
+		while(power_idx && !position.count(power_idx) && walked.size() < mainline.size() + 64)
+		{
+			walked.emplace_back(power_idx);
+			power_idx = state_resolve_power_prev(power_idx);
+		}
+
+		const auto it
+		{
+			position.find(power_idx)
+		};
+
+		const size_t pos
+		{
+			it != std::end(position)? it->second : 0UL
+		};
+
+		// Power levels walked on the way to the mainline share its position.
+		for(const auto &walked_idx : walked)
+			position.emplace(walked_idx, pos);
+
+		order.emplace(pos, json::get<"origin_server_ts"_>(event), event.event_id, event_idx);
+	}
+
+	std::vector<event::idx> ret;
+	ret.reserve(order.size());
+	for(const auto &key : order)
+		ret.emplace_back(std::get<3>(key));
+
+	return ret;
+}
+
+/// Authorize the event against the partial state, with its own auth_events
+/// standing in for cells the partial state lacks. The event is applied to
+/// the partial state when it passes.
+bool
+ircd::m::state_resolve_apply(state_resolve_cells &partial,
+                             const state_resolve_set &conflicted,
+                             const room::state::history &history,
+                             const event &event,
+                             const event::idx &event_idx)
+{
+	using json::at;
+
+	const auto get{[&partial, &conflicted, &history, &event]
+	(const string_view &type, const string_view &state_key)
+	{
+		const auto ret
+		{
+			state_resolve_get(partial, conflicted, history, type, state_key)
+		};
+
+		return ret?: state_resolve_auth_event(event, type, state_key);
+	}};
+
+	const bool is_member
+	{
+		at<"type"_>(event) == "m.room.member"
+	};
+
+	const bool is_join
+	{
+		is_member && (membership(event) == "join" || membership(event) == "invite")
+	};
+
+	const bool is_target
+	{
+		is_member &&
+		at<"sender"_>(event) != json::get<"state_key"_>(event) &&
+		valid(m::id::USER, json::get<"state_key"_>(event))
+	};
+
+	event::idx idx[5]
+	{
+		get("m.room.create", ""),
+		get("m.room.power_levels", ""),
+		get("m.room.member", at<"sender"_>(event)),
+		is_join? get("m.room.join_rules", ""): 0UL,
+		is_target? get("m.room.member", at<"state_key"_>(event)): 0UL,
+	};
+
+	const auto &[pass, fail]
+	{
+		room::auth::check(event, vector_view<event::idx>{idx, 5})
+	};
+
+	if(!pass)
+		return false;
+
+	char buf[event::TYPE_MAX_SIZE + 1 + event::STATE_KEY_MAX_SIZE];
+	partial[std::string(state_resolve_cell(buf, at<"type"_>(event), at<"state_key"_>(event)))] = event_idx;
+	return true;
+}
+
+/// The partial state starts as the unconflicted state with the conflicted
+/// cells missing; events applied during the resolution are found first.
+ircd::m::event::idx
+ircd::m::state_resolve_get(const state_resolve_cells &partial,
+                           const state_resolve_set &conflicted,
+                           const room::state::history &history,
+                           const string_view &type,
+                           const string_view &state_key)
+{
+	char buf[event::TYPE_MAX_SIZE + 1 + event::STATE_KEY_MAX_SIZE];
+	const auto cell
+	{
+		state_resolve_cell(buf, type, state_key)
+	};
+
+	const auto it
+	{
+		partial.find(cell)
+	};
+
+	if(it != std::end(partial))
+		return it->second;
+
+	if(conflicted.count(cell))
+		return 0UL;
+
+	return history.get(std::nothrow, type, state_key);
+}
+
+int64_t
+ircd::m::state_resolve_power_level(const room &room,
+                                   const event &event)
+{
+	const auto power_idx
+	{
+		state_resolve_auth_event(event, "m.room.power_levels", "")
+	};
+
+	const room::power power
+	{
+		m::room{room.room_id}, power_idx
+	};
+
+	return power.level_user(json::at<"sender"_>(event));
+}
+
+ircd::m::event::idx
+ircd::m::state_resolve_power_prev(const event::idx &event_idx)
+{
+	const m::event::fetch event
+	{
+		std::nothrow, event_idx
+	};
+
+	if(!event.valid)
+		return 0UL;
+
+	return state_resolve_auth_event(event, "m.room.power_levels", "");
+}
+
+ircd::m::event::idx
+ircd::m::state_resolve_auth_event(const event &event,
+                                  const string_view &type,
+                                  const string_view &state_key)
+{
+	const event::prev prev
+	{
+		event
+	};
+
+	for(size_t i(0); i < prev.auth_events_count(); ++i)
+	{
+		const auto auth_idx
+		{
+			m::index(std::nothrow, prev.auth_event(i))
+		};
+
+		const bool match
+		{
+			auth_idx &&
+			m::query(std::nothrow, auth_idx, "type", [&type]
+			(const string_view &value)
+			{
+				return value == type;
+			}) &&
+			m::query(std::nothrow, auth_idx, "state_key", [&state_key]
+			(const string_view &value)
+			{
+				return value == state_key;
+			})
+		};
+
+		if(match)
+			return auth_idx;
+	}
+
+	return 0UL;
+}
+
+void
+ircd::m::state_resolve_evict(const size_t &max)
+{
+	while(state_resolve_cache.size() > max)
+	{
+		const auto it
+		{
+			std::min_element(std::begin(state_resolve_cache), std::end(state_resolve_cache), []
+			(const auto &a, const auto &b)
+			{
+				return a.second.second < b.second.second;
+			})
+		};
+
+		state_resolve_cache.erase(it);
+	}
+}
+
+ircd::string_view
+ircd::m::state_resolve_cell(const mutable_buffer &buf,
+                            const string_view &type,
+                            const string_view &state_key)
+{
+	mutable_buffer out{buf};
+	consume(out, copy(out, type));
+	consume(out, copy(out, "\0"_sv));
+	consume(out, copy(out, state_key));
+	return { data(buf), data(out) };
+}
+
+std::pair<ircd::string_view, ircd::string_view>
+ircd::m::state_resolve_cell(const string_view &cell)
+{
+	return split(cell, '\0');
+}
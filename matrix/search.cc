@@ -0,0 +1,220 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::search
+{
+	constexpr size_t QUERY_TERMS_MAX {8};
+	using term_buf = char[QUERY_TERMS_MAX][dbs::ROOM_SEARCH_TERM_MAX_SIZE];
+	using term_vec = string_view[QUERY_TERMS_MAX];
+
+	static size_t query_terms(term_buf &, term_vec &, const string_view &);
+}
+
+decltype(ircd::m::search::log)
+ircd::m::search::log
+{
+	"m.search"
+};
+
+/// Index the terms of every event in the room which is already in the
+/// database and mark the room as indexed. The vm indexes events as they're
+/// written; this is for the history of rooms which predate the index.
+/// Returns the number of events written to the index.
+size_t
+ircd::m::search::rebuild(const room::id &room_id)
+{
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	dbs::write_opts opts;
+	opts.appendix.reset();
+	opts.appendix.set(dbs::appendix::ROOM_SEARCH);
+
+	m::room::events it
+	{
+		room_id, uint64_t(0)
+	};
+
+	size_t ret(0);
+	for(; it; ++it)
+	{
+		const m::event &event{*it};
+		opts.event_idx = it.event_idx();
+		dbs::write(txn, event, opts);
+		++ret;
+	}
+
+	// The mark is committed with the history so an interrupted rebuild is
+	// started over rather than leaving the room marked.
+	char buf[dbs::ROOM_SEARCH_KEY_MAX_SIZE];
+	db::txn::append
+	{
+		txn, dbs::room_search,
+		{
+			db::op::SET,
+			dbs::room_search_key(buf, room_id, string_view{}, 0UL),
+			string_view{},
+		}
+	};
+
+	txn();
+	log::info
+	{
+		log, "Search index of %s rebuilt with %zu events.",
+		string_view{room_id},
+		ret,
+	};
+
+	return ret;
+}
+
+/// True when every event of the room is in the index: the room's create
+/// event was indexed by the vm or its history was rebuilt. The mark is an
+/// entry with an empty term, which no query can seek.
+bool
+ircd::m::search::indexed(const room::id &room_id)
+{
+	char buf[dbs::ROOM_SEARCH_KEY_MAX_SIZE];
+	return db::has(dbs::room_search, dbs::room_search_key(buf, room_id, string_view{}, 0UL));
+}
+
+bool
+ircd::m::search::query::empty()
+const
+{
+	return for_each([]
+	(const auto &event_idx, const auto &rank)
+	{
+		return false;
+	});
+}
+
+size_t
+ircd::m::search::query::count()
+const
+{
+	size_t ret(0);
+	for_each([&ret]
+	(const auto &event_idx, const auto &rank)
+	{
+		++ret;
+		return true;
+	});
+
+	return ret;
+}
+
+/// Intersects the posting lists of every term by leapfrogging: each list is
+/// advanced to the lowest event_idx any other list has reached until they all
+/// agree. Lists are ordered by descending event_idx so a seek moves toward
+/// older events and each posting list is traversed at most once.
+bool
+ircd::m::search::query::for_each(const closure &closure)
+const
+{
+	search::term_buf term_buf;
+	search::term_vec term;
+	const size_t terms
+	{
+		query_terms(term_buf, term, search_term)
+	};
+
+	if(!terms)
+		return true;
+
+	char buf[dbs::ROOM_SEARCH_KEY_MAX_SIZE];
+	std::vector<db::domain::const_iterator> it;
+	it.reserve(terms);
+	for(size_t i(0); i < terms; ++i)
+		it.emplace_back(dbs::room_search.begin(dbs::room_search_key(buf, room_id, term[i], upper)));
+
+	const auto idx{[](const auto &it) -> event::idx
+	{
+		return std::get<0>(dbs::room_search_key(it->first));
+	}};
+
+	event::idx target(upper);
+	while(1)
+	{
+		bool agree(true);
+		for(size_t i(0); i < terms; ++i)
+		{
+			if(!it[i])
+				return true;
+
+			// The common case is the next entry; only seek if stepping once
+			// did not reach the target.
+			if(idx(it[i]) > target && !(++it[i]))
+				return true;
+
+			if(idx(it[i]) > target)
+				if(!db::seek(it[i], dbs::room_search_key(buf, room_id, term[i], target)))
+					return true;
+
+			if(idx(it[i]) < target)
+			{
+				target = idx(it[i]);
+				agree = false;
+			}
+		}
+
+		if(!agree)
+			continue;
+
+		size_t hits(0), matched(0);
+		for(size_t i(0); i < terms; ++i)
+		{
+			const uint8_t field
+			{
+				uint8_t(it[i]->second.at(0) & fields)
+			};
+
+			hits += __builtin_popcount(field);
+			matched += bool(field);
+		}
+
+		const float rank
+		{
+			float(hits) / terms
+		};
+
+		if(matched == terms)
+			if(!closure(target, rank))
+				return false;
+
+		if(!target--)
+			return true;
+	}
+}
+
+size_t
+ircd::m::search::query_terms(term_buf &buf,
+                             term_vec &term,
+                             const string_view &search_term)
+{
+	size_t ret(0);
+	dbs::room_search_terms(search_term, [&buf, &term, &ret]
+	(const string_view &text)
+	{
+		if(std::find(term, term + ret, text) != term + ret)
+			return true;
+
+		term[ret] = string_view
+		{
+			buf[ret], copy(buf[ret], text)
+		};
+
+		return ++ret < QUERY_TERMS_MAX;
+	});
+
+	return ret;
+}
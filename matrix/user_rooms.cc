@@ -8,6 +8,117 @@
 // copyright notice and this permission notice is present in all copies. The
 // full license for this software is available in the LICENSE file.
 
+namespace ircd::m
+{
+	static void user_rooms_recent_handle(const event &, vm::eval &);
+
+	extern hookfn<vm::eval &> user_rooms_recent_hook;
+}
+
+/// Maintains the _user_room_recency index. The deltas are appended to the
+/// transaction of the eval so they are committed together with the event.
+decltype(ircd::m::user_rooms_recent_hook)
+ircd::m::user_rooms_recent_hook
+{
+	user_rooms_recent_handle,
+	{
+		{ "_site",    "vm.post" },
+	}
+};
+
+/// When an event becomes the top of a room, every local user joined or
+/// invited to the room has their entry moved from the previous top to this
+/// event. The target of a local membership event is added or removed here
+/// because the present state of the room doesn't include the event yet.
+/// This costs a delete and a put per local member for each new event, which
+/// is written with the event's own transaction.
+void
+ircd::m::user_rooms_recent_handle(const event &event,
+                                  vm::eval &eval)
+{
+	if(eval.room_internal)
+		return;
+
+	if(!eval.txn || !eval.sequence)
+		return;
+
+	const m::room::id &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	const auto top
+	{
+		m::top(std::nothrow, room_id)
+	};
+
+	const auto &top_depth(std::get<int64_t>(top));
+	const auto &top_idx(std::get<event::idx>(top));
+
+	// Backfilled events are not the latest activity in the room.
+	if(top_idx && (top_idx >= eval.sequence || top_depth > json::get<"depth"_>(event)))
+		return;
+
+	const string_view &target
+	{
+		json::get<"type"_>(event) == "m.room.member"?
+			string_view{json::get<"state_key"_>(event)}:
+			string_view{}
+	};
+
+	char buf[dbs::USER_ROOM_RECENCY_KEY_MAX_SIZE];
+	const auto update{[&eval, &room_id, &top_idx, &buf]
+	(const id::user &user_id, const bool &present)
+	{
+		if(top_idx)
+			db::txn::append
+			{
+				*eval.txn, dbs::user_room_recency,
+				{
+					db::op::DELETE,
+					dbs::user_room_recency_key(buf, user_id, top_idx, room_id),
+					string_view{},
+				}
+			};
+
+		if(present)
+			db::txn::append
+			{
+				*eval.txn, dbs::user_room_recency,
+				{
+					db::op::SET,
+					dbs::user_room_recency_key(buf, user_id, eval.sequence, room_id),
+					string_view{},
+				}
+			};
+	}};
+
+	const m::room::members members
+	{
+		room_id
+	};
+
+	for(const auto &membership : {"join"_sv, "invite"_sv})
+		members.for_each(membership, my_host(), m::room::members::closure{[&target, &update]
+		(const id::user &user_id)
+		{
+			if(user_id != target)
+				update(user_id, true);
+
+			return true;
+		}});
+
+	if(target && valid(id::USER, target) && my(id::user(target)))
+	{
+		const string_view &membership
+		{
+			m::membership(event)
+		};
+
+		update(target, membership == "join" || membership == "invite");
+	}
+}
+
 size_t
 ircd::m::user::rooms::count()
 const
@@ -110,3 +221,111 @@ const
 		return ret;
 	});
 }
+
+/// Iterate the rooms of the user from the most to the least recently active
+/// by way of the _user_room_recency index. Only one entry of each room is
+/// visited should any stale entry remain behind the present one, and only
+/// rooms the user is presently joined or invited to are visited.
+bool
+ircd::m::user::rooms::for_each_recent(const closure_recent &closure)
+const
+{
+	char buf[dbs::USER_ROOM_RECENCY_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		dbs::user_room_recency_key(buf, user)
+	};
+
+	std::set<std::string, std::less<>> seen;
+	auto it
+	{
+		dbs::user_room_recency.begin(key)
+	};
+
+	for(; it; ++it)
+	{
+		const auto &[event_idx, room_id]
+		{
+			dbs::user_room_recency_key(it->first)
+		};
+
+		if(!seen.emplace(room_id).second)
+			continue;
+
+		if(!m::membership(m::room::id(room_id), user, m::membership_positive))
+			continue;
+
+		if(!closure(m::room::id(room_id), event_idx))
+			return false;
+	}
+
+	return true;
+}
+
+/// Replace the _user_room_recency entries of the user with the present top
+/// of every room they are joined or invited to. The index is otherwise
+/// maintained by the vm; this is for users who predate it, which is done
+/// for them by m::init::recent at startup.
+size_t
+ircd::m::user::rooms::rebuild_recent()
+const
+{
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	char buf[dbs::USER_ROOM_RECENCY_KEY_MAX_SIZE];
+	auto it
+	{
+		dbs::user_room_recency.begin(dbs::user_room_recency_key(buf, user))
+	};
+
+	for(; it; ++it)
+	{
+		const auto &[event_idx, room_id]
+		{
+			dbs::user_room_recency_key(it->first)
+		};
+
+		db::txn::append
+		{
+			txn, dbs::user_room_recency,
+			{
+				db::op::DELETE,
+				dbs::user_room_recency_key(buf, user, event_idx, m::room::id(room_id)),
+				string_view{},
+			}
+		};
+	}
+
+	size_t ret(0);
+	for(const auto &membership : {"join"_sv, "invite"_sv})
+		for_each(membership, closure_bool{[this, &txn, &buf, &ret]
+		(const m::room &room, const string_view &)
+		{
+			const auto &[top_id, top_depth, top_idx]
+			{
+				m::top(std::nothrow, room.room_id)
+			};
+
+			if(!top_idx)
+				return true;
+
+			db::txn::append
+			{
+				txn, dbs::user_room_recency,
+				{
+					db::op::SET,
+					dbs::user_room_recency_key(buf, user, top_idx, room.room_id),
+					string_view{},
+				}
+			};
+
+			++ret;
+			return true;
+		}});
+
+	txn();
+	return ret;
+}
@@ -191,6 +191,23 @@ ircd::m::vm::sequence::committed;
 decltype(ircd::m::vm::sequence::uncommitted)
 ircd::m::vm::sequence::uncommitted;
 
+/// When enabled, evals are only serialized against prior evals of the same
+/// room through the relative and present auth checks and the eval hooks;
+/// evals of other rooms conduct these concurrently. Only the commitment of
+/// the sequence number and the write remain ordered across all rooms.
+decltype(ircd::m::vm::sequence::pipeline)
+ircd::m::vm::sequence::pipeline
+{
+	{ "name",     "ircd.m.vm.sequence.pipeline" },
+	{ "default",  false                         },
+};
+
+/// The mode in effect. Evals in flight wait on conditions of the mode they
+/// were sequenced under, so a change of the conf item takes effect here
+/// only when an eval is sequenced while no other eval holds a sequence.
+decltype(ircd::m::vm::sequence::pipelined)
+ircd::m::vm::sequence::pipelined;
+
 uint64_t
 ircd::m::vm::sequence::min()
 {
@@ -8,6 +8,34 @@
 // copyright notice and this permission notice is present in all copies. The
 // full license for this software is available in the LICENSE file.
 
+namespace ircd::m::vm
+{
+	extern conf::item<bool> offload_enable;
+	extern conf::item<size_t> offload_concurrency;
+	extern conf::item<size_t> offload_min;
+}
+
+decltype(ircd::m::vm::offload_enable)
+ircd::m::vm::offload_enable
+{
+	{ "name",     "ircd.m.vm.offload.enable" },
+	{ "default",  true                       },
+};
+
+decltype(ircd::m::vm::offload_concurrency)
+ircd::m::vm::offload_concurrency
+{
+	{ "name",     "ircd.m.vm.offload.concurrency" },
+	{ "default",  4L                              },
+};
+
+decltype(ircd::m::vm::offload_min)
+ircd::m::vm::offload_min
+{
+	{ "name",     "ircd.m.vm.offload.min" },
+	{ "default",  8L                      },
+};
+
 //
 // Eval
 //
@@ -118,6 +146,28 @@ ircd::m::vm::eval::seqnext(const uint64_t &seq)
 	return ret;
 }
 
+/// Lowest sequenced eval above seq in the room; nullptr if none.
+ircd::m::vm::eval *
+ircd::m::vm::eval::seqnext(const uint64_t &seq,
+                           const string_view &room_id)
+{
+	eval *ret{nullptr};
+	for(auto *const &eval : eval::list)
+	{
+		if(sequence::get(*eval) <= seq)
+			continue;
+
+		if(eval->room_id != room_id)
+			continue;
+
+		if(!ret || sequence::get(*eval) < sequence::get(*ret))
+			ret = eval;
+	}
+
+	assert(!ret || sequence::get(*ret) > seq);
+	return ret;
+}
+
 bool
 ircd::m::vm::eval::sequnique(const uint64_t &seq)
 {
@@ -294,6 +344,24 @@ ircd::m::vm::eval::operator()(const vector_view<m::event> &events)
 	if(likely(opts->verify && opts->mfetch_keys))
 		mfetch_keys();
 
+	const scope_restore eval_pdus_verified
+	{
+		this->pdus_verified, std::vector<bool>{}
+	};
+
+	const scope_restore eval_pdus_reported
+	{
+		this->pdus_reported, std::vector<bool>{}
+	};
+
+	const scope_restore eval_pdus_report
+	{
+		this->pdus_report, std::vector<event::conforms>{}
+	};
+
+	if(likely(opts->verify && events.size() > 1))
+		mverify();
+
 	// Conduct each eval without letting any one exception ruin things for the
 	// others, including an interrupt. The only exception is a termination.
 	size_t ret(0);
@@ -415,6 +483,286 @@ const
 		};
 }
 
+/// Verify the origin signature of all pdus prior to their evals. The events
+/// are grouped by signing key so each key is queried once; that much is done
+/// on this context because it may hit the database or the network. The
+/// preimages, the signature checks and the conformity reports (which include
+/// the hashing of the event_id) don't yield, so these are offloaded to the
+/// ctx::ole threads to leave the main thread for everything else. A failure
+/// here does not reject the event; the individual verification is conducted
+/// during its eval, which tries all of the origin's keys and reports the
+/// error.
+void
+ircd::m::vm::eval::mverify()
+{
+	struct item
+	{
+		string_view origin;
+		string_view key_id;
+		string_view sig;
+		mutable_buffer buf;
+		ed25519::pk pk;
+		bool has_pk {false};
+		size_t pos;
+	};
+
+	assert(opts);
+	const bool report
+	{
+		opts->conform && !opts->conformed
+	};
+
+	size_t arena_size(0);
+	for(const auto &event : this->pdus)
+		arena_size += json::serialized(event);
+
+	const unique_buffer<mutable_buffer> arena
+	{
+		arena_size
+	};
+
+	std::vector<item> items;
+	items.reserve(this->pdus.size());
+	mutable_buffer buf{arena};
+	for(size_t i(0); i < this->pdus.size(); ++i) try
+	{
+		const auto &event
+		{
+			this->pdus[i]
+		};
+
+		const mutable_buffer slice
+		{
+			data(buf), json::serialized(event)
+		};
+
+		consume(buf, size(slice));
+		const auto &origin
+		{
+			json::get<"origin"_>(event)
+		};
+
+		const json::object &signature
+		{
+			json::get<"signatures"_>(event).get(origin)
+		};
+
+		if(!origin || empty(signature))
+			continue;
+
+		const auto &[key_id, sig]
+		{
+			*begin(signature)
+		};
+
+		auto &item
+		{
+			items.emplace_back()
+		};
+
+		item.origin = origin;
+		item.key_id = json::string(key_id);
+		item.sig = json::string(sig);
+		item.buf = slice;
+		item.pos = i;
+	}
+	catch(const ctx::interrupted &)
+	{
+		throw;
+	}
+	catch(const std::exception &e)
+	{
+		continue;
+	}
+
+	std::sort(begin(items), end(items), []
+	(const auto &a, const auto &b)
+	{
+		return std::tie(a.origin, a.key_id) < std::tie(b.origin, b.key_id);
+	});
+
+	for(auto it(begin(items)); it != end(items); )
+	{
+		const auto stop
+		{
+			std::find_if(it, end(items), [&it]
+			(const auto &item)
+			{
+				return item.origin != it->origin || item.key_id != it->key_id;
+			})
+		};
+
+		try
+		{
+			const m::node node
+			{
+				it->origin
+			};
+
+			node.key(it->key_id, [&it, &stop]
+			(const ed25519::pk &pk)
+			{
+				for(auto jt(it); jt != stop; ++jt)
+				{
+					jt->pk = pk;
+					jt->has_pk = true;
+				}
+			});
+		}
+		catch(const ctx::interrupted &)
+		{
+			throw;
+		}
+		catch(const std::exception &e)
+		{
+			// The events are verified individually during their evals.
+		}
+
+		it = stop;
+	}
+
+	// Results are written by the workers into these; std::vector<bool> is
+	// not safe for concurrent writes to different elements.
+	std::vector<int8_t> verified(this->pdus.size(), false);
+	std::vector<int8_t> reported(report? this->pdus.size(): 0UL, false);
+	std::vector<event::conforms> reports(reported.size());
+
+	// Each task is either the verification of an item or the report of a
+	// pdu; the invocations of the closure take the next task until none
+	// remain.
+	const size_t tasks
+	{
+		items.size() + reports.size()
+	};
+
+	std::atomic<size_t> next {0};
+	const auto work{[this, &items, &verified, &reported, &reports, &next, &tasks]
+	{
+		for(size_t i(next++); i < tasks; i = next++) try
+		{
+			if(i >= items.size())
+			{
+				const auto pos(i - items.size());
+				reports[pos] = event::conforms
+				{
+					this->pdus[pos], opts->non_conform.report
+				};
+
+				reported[pos] = true;
+				continue;
+			}
+
+			const auto &item
+			{
+				items[i]
+			};
+
+			if(!item.has_pk)
+				continue;
+
+			thread_local char content_buf[event::MAX_SIZE];
+			const m::event essential
+			{
+				m::essential(this->pdus[item.pos], content_buf)
+			};
+
+			const string_view preimage
+			{
+				json::stringify(mutable_buffer{item.buf}, essential)
+			};
+
+			const ed25519::sig sig
+			{
+				[&item](auto &buf)
+				{
+					b64decode(buf, item.sig);
+				}
+			};
+
+			verified[item.pos] = item.pk.verify(preimage, sig);
+		}
+		catch(const std::exception &e)
+		{
+			continue;
+		}
+	}};
+
+	const size_t concurrency
+	{
+		std::min(size_t(offload_concurrency), tasks)
+	};
+
+	const bool offload
+	{
+		offload_enable
+		&& concurrency
+		&& tasks >= size_t(offload_min)
+	};
+
+	if(offload)
+	{
+		ctx::ole::opts ole_opts;
+		ole_opts.name = "vm.mverify";
+		ole_opts.concurrency = concurrency;
+		ctx::offload
+		{
+			ole_opts, work
+		};
+	}
+	else work();
+
+	this->pdus_verified.assign(begin(verified), end(verified));
+	this->pdus_reported.assign(begin(reported), end(reported));
+	this->pdus_report = std::move(reports);
+
+	log::debug
+	{
+		log, "%s verified %zu of %zu events in %zu bytes (%zu tasks; offload:%zu)",
+		loghead(*this),
+		std::count(begin(verified), end(verified), true),
+		this->pdus.size(),
+		arena_size,
+		tasks,
+		offload? concurrency: 0UL,
+	};
+}
+
+/// True if the event is one of the pdus of this eval and it was verified
+/// by mverify().
+bool
+ircd::m::vm::eval::verified(const event &event)
+const
+{
+	const auto *const begin(this->pdus.data());
+	const auto *const end(begin + this->pdus.size());
+	const auto *const ptr(std::addressof(event));
+	if(ptr < begin || ptr >= end)
+		return false;
+
+	const size_t pos(std::distance(begin, ptr));
+	return pos < pdus_verified.size() && pdus_verified[pos];
+}
+
+/// The conformity report generated by mverify() if the event is one of the
+/// pdus of this eval; otherwise null.
+const ircd::m::event::conforms *
+ircd::m::vm::eval::reported(const event &event)
+const
+{
+	const auto *const begin(this->pdus.data());
+	const auto *const end(begin + this->pdus.size());
+	const auto *const ptr(std::addressof(event));
+	if(ptr < begin || ptr >= end)
+		return nullptr;
+
+	const size_t pos(std::distance(begin, ptr));
+	if(pos >= pdus_reported.size() || !pdus_reported[pos])
+		return nullptr;
+
+	assert(pos < pdus_report.size());
+	return std::addressof(pdus_report[pos]);
+}
+
 const ircd::m::event *
 ircd::m::vm::eval::find_pdu(const event::id &event_id)
 {
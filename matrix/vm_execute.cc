@@ -36,6 +36,11 @@ namespace ircd::m::vm
 	extern conf::item<bool> log_commit_debug;
 	extern conf::item<bool> log_accept_debug;
 	extern conf::item<bool> log_accept_info;
+
+	extern stats::histogram fetch_latency;
+	extern stats::histogram auth_latency;
+	extern stats::histogram commit_latency;
+	extern stats::histogram write_latency;
 }
 
 decltype(ircd::m::vm::log_commit_debug)
@@ -59,6 +64,32 @@ ircd::m::vm::log_accept_info
 	{ "default",  false                       },
 };
 
+decltype(ircd::m::vm::fetch_latency)
+ircd::m::vm::fetch_latency
+{
+	{ "name",     "ircd.m.vm.execute.fetch.latency" },
+};
+
+decltype(ircd::m::vm::auth_latency)
+ircd::m::vm::auth_latency
+{
+	{ "name",     "ircd.m.vm.execute.auth.latency" },
+};
+
+/// From sequencing the event until it is committed; this is mostly the
+/// wait for the evals sequenced before it.
+decltype(ircd::m::vm::commit_latency)
+ircd::m::vm::commit_latency
+{
+	{ "name",     "ircd.m.vm.execute.commit.latency" },
+};
+
+decltype(ircd::m::vm::write_latency)
+ircd::m::vm::write_latency
+{
+	{ "name",     "ircd.m.vm.execute.write.latency" },
+};
+
 decltype(ircd::m::vm::issue_hook)
 ircd::m::vm::issue_hook
 {
@@ -530,7 +561,7 @@ ircd::m::vm::execute_pdu(eval &eval,
 	if(likely(opts.access))
 		call_hook(access_hook, eval, event, eval);
 
-	if(likely(opts.verify) && !verify(event))
+	if(likely(opts.verify) && !eval.verified(event) && !verify(event))
 		throw m::BAD_SIGNATURE
 		{
 			"Signature verification failed"
@@ -538,14 +569,35 @@ ircd::m::vm::execute_pdu(eval &eval,
 
 	// Fetch dependencies
 	if(likely(opts.fetch))
+	{
+		const stats::histogram::scope latency
+		{
+			fetch_latency
+		};
+
 		call_hook(fetch_hook, eval, event, eval);
+	}
+
+	// The auth checks are interleaved with sequencing below; their time is
+	// accumulated into one sample.
+	ircd::timer auth_timer
+	{
+		ircd::timer::nostart
+	};
 
 	// Evaluation by auth system; throws
 	if(likely(authenticate))
+	{
+		auth_timer.cont();
 		room::auth::check_static(event);
+		auth_timer.stop();
+	}
 
 	// Obtain sequence number here.
 	const auto *const &top(eval::seqmax());
+	if(!top)
+		sequence::pipelined = sequence::pipeline;
+
 	eval.sequence_shared[0] = 0;
 	eval.sequence_shared[1] = 0;
 	eval.sequence = 0;
@@ -556,19 +608,34 @@ ircd::m::vm::execute_pdu(eval &eval,
 			sequence::committed + 1
 	};
 
+	const ircd::timer commit_timer;
 	log::debug
 	{
 		log, "%s | event sequenced", loghead(eval)
 	};
 
-	// Wait until this is the lowest sequence number
-	sequence::dock.wait([&eval]
+	// In pipelined mode the evals of other rooms are not waited on until
+	// the commitment below.
+	const bool pipelined
+	{
+		sequence::pipelined
+	};
+
+	// Wait until this is the lowest sequence number; when pipelined, the
+	// lowest in the room which has not committed.
+	sequence::dock.wait([&eval, &pipelined]
 	{
-		return eval::seqnext(sequence::uncommitted) == &eval;
+		return pipelined?
+			eval::seqnext(sequence::committed, eval.room_id) == &eval:
+			eval::seqnext(sequence::uncommitted) == &eval;
 	});
 
 	if(likely(authenticate))
+	{
+		auth_timer.cont();
 		room::auth::check_relative(event);
+		auth_timer.stop();
+	}
 
 	log::debug
 	{
@@ -576,26 +643,40 @@ ircd::m::vm::execute_pdu(eval &eval,
 	};
 
 	assert(eval.sequence != 0);
-	assert(sequence::uncommitted <= sequence::get(eval));
+	assert(pipelined || sequence::uncommitted <= sequence::get(eval));
 	assert(sequence::committed < sequence::get(eval));
 	assert(sequence::retired < sequence::get(eval));
 	assert(eval::sequnique(sequence::get(eval)));
-	sequence::uncommitted = sequence::get(eval);
+	sequence::uncommitted = std::max(sequence::uncommitted, sequence::get(eval));
 
-	// Wait until this is the lowest sequence number
-	sequence::dock.wait([&eval]
-	{
-		return eval::seqnext(sequence::committed) == &eval;
-	});
+	// Wait until this is the lowest sequence number; when pipelined, the
+	// present state of the room is already settled by the wait above.
+	if(!pipelined)
+		sequence::dock.wait([&eval]
+		{
+			return eval::seqnext(sequence::committed) == &eval;
+		});
 
 	// Reevaluation of auth against the present state of the room.
 	if(likely(authenticate))
+	{
+		auth_timer.cont();
 		room::auth::check_present(event);
+		auth_timer.stop();
+		auth_latency(auth_timer.get<microseconds>());
+	}
 
 	// Evaluation by module hooks
 	if(likely(opts.eval))
 		call_hook(eval_hook, eval, event, eval);
 
+	// Commitment is always in order of the sequence number.
+	if(pipelined)
+		sequence::dock.wait([&eval]
+		{
+			return eval::seqnext(sequence::committed) == &eval;
+		});
+
 	log::debug
 	{
 		log, "%s | event committed", loghead(eval)
@@ -604,12 +685,22 @@ ircd::m::vm::execute_pdu(eval &eval,
 	assert(sequence::committed < sequence::get(eval));
 	assert(sequence::retired < sequence::get(eval));
 	sequence::committed = sequence::get(eval);
+	commit_latency(commit_timer.at<microseconds>());
 
-	if(likely(opts.write))
-		write_prepare(eval, event);
+	// The post hook between the write steps may recursively eval other
+	// events; it is excluded from the write sample.
+	ircd::timer write_timer
+	{
+		ircd::timer::nostart
+	};
 
 	if(likely(opts.write))
+	{
+		write_timer.cont();
+		write_prepare(eval, event);
 		write_append(eval, event);
+		write_timer.stop();
+	}
 
 	// Generate post-eval/pre-notify effects. This function may conduct
 	// an entire eval of several more events recursively before returning.
@@ -618,7 +709,14 @@ ircd::m::vm::execute_pdu(eval &eval,
 
 	// Commit the transaction to database iff this eval is at the stack base.
 	if(likely(opts.write) && !eval.sequence_shared[0])
+	{
+		write_timer.cont();
 		write_commit(eval);
+		write_timer.stop();
+	}
+
+	if(likely(opts.write))
+		write_latency(write_timer.get<microseconds>());
 
 	// Wait for sequencing only if this is the stack base, otherwise we'll
 	// never return back to that stack base.
@@ -706,6 +804,12 @@ ircd::m::vm::write_append(eval &eval,
 
 	m::dbs::write_opts wopts(opts.wopts);
 	wopts.event_idx = eval.sequence;
+
+	// The txn may be shared with other evals on this stack whose events
+	// aren't committed yet; indexers find them here.
+	if(!wopts.interpose)
+		wopts.interpose = &txn;
+
 	wopts.json_source = opts.json_source;
 	wopts.appendix.set(dbs::appendix::ROOM_STATE_SPACE, opts.history);
 
@@ -714,6 +818,10 @@ ircd::m::vm::write_append(eval &eval,
 	wopts.appendix.set(dbs::appendix::ROOM_HEAD, opts.room_head && !dummy_event);
 	wopts.appendix.set(dbs::appendix::ROOM_HEAD_RESOLVE, opts.room_head_resolve);
 
+	// Internal rooms are never searched by clients; don't index their text.
+	if(eval.room_internal)
+		wopts.appendix.reset(dbs::appendix::ROOM_SEARCH);
+
 	if(opts.present && json::get<"state_key"_>(event))
 	{
 		const room room
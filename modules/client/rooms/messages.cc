@@ -131,7 +131,14 @@ get__messages(client &client,
 		room
 	};
 
-	for(; it; page.dir == 'b'? --it : ++it)
+	// Events past the page are read ahead while the page is serialized;
+	// the lead covers the rest of the page plus the one which ends it.
+	m::room::events::readahead readahead
+	{
+		it, page.limit + 2U, page.dir == 'b'
+	};
+
+	for(; it; readahead(), page.dir == 'b'? --it : ++it)
 	{
 		const m::event &event
 		{
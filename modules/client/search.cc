@@ -16,7 +16,7 @@ IRCD_MODULE
 	"Client 11.14 :Server Side Search"
 };
 
-ircd::resource
+m::resource
 search_resource
 {
 	"/_matrix/client/r0/search",
@@ -29,16 +29,23 @@ search_resource
 	}
 };
 
+struct candidate
+{
+	m::event::idx event_idx;
+	float rank;
+};
+
 static void
 handle_room_events(client &client,
-                   const resource::request &request,
+                   const m::resource::request &request,
+                   const string_view &batch,
                    const json::object &,
                    json::stack::object &);
 
-static resource::response
-post__search(client &client, const resource::request &request);
+static m::resource::response
+post__search(client &client, const m::resource::request &request);
 
-resource::method
+m::resource::method
 post_method
 {
 	search_resource, "POST", post__search,
@@ -47,8 +54,40 @@ post_method
 	}
 };
 
-resource::response
-post__search(client &client, const resource::request &request)
+conf::item<size_t>
+limit_default
+{
+	{ "name",      "ircd.client.search.limit.default" },
+	{ "default",   10L                                },
+};
+
+conf::item<size_t>
+limit_max
+{
+	{ "name",      "ircd.client.search.limit.max" },
+	{ "default",   64L                            },
+};
+
+/// Number of candidates taken from each room when results are ordered by
+/// rank; the rank of every candidate must be known before any is returned.
+conf::item<size_t>
+rank_max
+{
+	{ "name",      "ircd.client.search.rank.max" },
+	{ "default",   512L                          },
+};
+
+/// Number of matches counted in each room for the total count of results
+/// beyond those taken as candidates.
+conf::item<size_t>
+count_max
+{
+	{ "name",      "ircd.client.search.count.max" },
+	{ "default",   8192L                          },
+};
+
+m::resource::response
+post__search(client &client, const m::resource::request &request)
 {
 	const auto &batch
 	{
@@ -60,7 +99,7 @@ post__search(client &client, const resource::request &request)
 		request["search_categories"]
 	};
 
-	resource::response::chunked response
+	m::resource::response::chunked response
 	{
 		client, http::OK
 	};
@@ -80,13 +119,14 @@ post__search(client &client, const resource::request &request)
 		top, "search_categories"
 	};
 
-	handle_room_events(client, request, search_categories, result_categories);
+	handle_room_events(client, request, batch, search_categories, result_categories);
 	return std::move(response);
 }
 
 void
 handle_room_events(client &client,
-                   const resource::request &request,
+                   const m::resource::request &request,
+                   const string_view &batch,
                    const json::object &search_categories,
                    json::stack::object &result_categories)
 try
@@ -99,6 +139,137 @@ try
 		search_categories["room_events"]
 	};
 
+	const json::string &search_term
+	{
+		at<"search_term"_>(room_events)
+	};
+
+	const m::room_event_filter filter
+	{
+		json::get<"filter"_>(room_events)
+	};
+
+	const bool recent
+	{
+		json::get<"order_by"_>(room_events) == "recent"
+	};
+
+	const size_t limit
+	{
+		std::clamp
+		(
+			json::get<"limit"_>(filter) > 0?
+				size_t(json::get<"limit"_>(filter)):
+				size_t(limit_default),
+
+			1UL,
+			size_t(limit_max)
+		)
+	};
+
+	const json::array keys
+	{
+		json::get<"keys"_>(room_events)
+	};
+
+	uint8_t fields(keys.empty()? 0xff : 0x00);
+	for(const json::string key : keys)
+		fields |=
+			key == "content.body"?
+				m::dbs::room_search_field::BODY:
+			key == "content.name"?
+				m::dbs::room_search_field::NAME:
+			key == "content.topic"?
+				m::dbs::room_search_field::TOPIC:
+				0x00;
+
+	// The batch token for recent ordering is the last event_idx returned;
+	// for rank ordering it is the offset into the ranked candidates.
+	const m::event::idx upper
+	{
+		recent && batch?
+			std::max(lex_cast<m::event::idx>(batch), 1UL) - 1:
+			-1UL
+	};
+
+	const size_t offset
+	{
+		!recent && batch?
+			lex_cast<size_t>(batch):
+			0UL
+	};
+
+	std::vector<m::room::id::buf> rooms;
+	const json::array &filter_rooms
+	{
+		json::get<"rooms"_>(filter)
+	};
+
+	for(const json::string room_id : filter_rooms)
+		rooms.emplace_back(room_id);
+
+	if(filter_rooms.empty())
+		m::user::rooms(request.user_id).for_each([&rooms]
+		(const m::room &room, const string_view &membership)
+		{
+			if(membership == "join" || membership == "leave")
+				rooms.emplace_back(room.room_id);
+		});
+
+	// Gather candidates from every room. When a room reaches its maximum the
+	// candidates of that room below its lowest are unknown; for recent
+	// ordering the results can't proceed past that floor in this batch. The
+	// matches of each room are counted further, up to count_max, for the
+	// total count of results.
+	std::vector<candidate> candidates;
+	m::event::idx floor(0);
+	size_t matches(0);
+	for(const auto &room_id : rooms)
+	{
+		const size_t room_max
+		{
+			recent? limit : size_t(rank_max)
+		};
+
+		const size_t room_limit
+		{
+			std::max(room_max, size_t(count_max))
+		};
+
+		size_t room_count(0);
+		const m::search::query query
+		{
+			room_id, search_term, fields, upper
+		};
+
+		query.for_each([&candidates, &room_count, &room_max, &room_limit]
+		(const m::event::idx &event_idx, const float &rank)
+		{
+			if(room_count < room_max)
+				candidates.emplace_back(candidate{event_idx, rank});
+
+			return ++room_count < room_limit;
+		});
+
+		// The room has more matches than candidates when the count went past
+		// them, or when the count stopped at them without knowing.
+		matches += room_count;
+		if(room_count > room_max || room_count >= room_limit)
+			floor = std::max(floor, candidates.back().event_idx);
+	}
+
+	std::sort(begin(candidates), end(candidates), [&recent]
+	(const candidate &a, const candidate &b)
+	{
+		if(!recent && a.rank > b.rank)
+			return true;
+
+		if(!recent && a.rank < b.rank)
+			return false;
+
+		return a.event_idx > b.event_idx;
+	});
+
 	json::stack::object room_events_result
 	{
 		result_categories, "room_events"
@@ -109,23 +280,41 @@ try
 		room_events_result, "results"
 	};
 
-	const json::string &search_term
+	const m::user::room user_room
 	{
-		at<"search_term"_>(room_events)
+		request.user_id
 	};
 
-	log::debug
+	size_t pos(offset), count(0);
+	m::event::idx last(0);
+	for(; pos < candidates.size() && count < limit; ++pos)
 	{
-		//TODO: search::log
-		m::log, "Search [%s] keys:%s order_by:%s inc_state:%b user:%s",
-		search_term,
-		json::get<"keys"_>(room_events),
-		json::get<"order_by"_>(room_events),
-		json::get<"include_state"_>(room_events),
-	};
+		const auto &[event_idx, rank]
+		{
+			candidates.at(pos)
+		};
+
+		if(recent && event_idx < floor)
+			break;
+
+		last = event_idx;
+		if(m::redacted(event_idx))
+			continue;
+
+		const m::event::fetch event
+		{
+			std::nothrow, event_idx
+		};
+
+		if(!event.valid)
+			continue;
+
+		if(!m::match(filter, event))
+			continue;
+
+		if(!visible(event, request.user_id))
+			continue;
 
-	long count(0);
-	{
 		json::stack::object result
 		{
 			results
@@ -133,7 +322,7 @@ try
 
 		json::stack::member
 		{
-			result, "rank", json::value(0L)
+			result, "rank", json::value(double(rank))
 		};
 
 		json::stack::object result_event
@@ -141,25 +330,70 @@ try
 			result, "result"
 		};
 
-		//m::event::append::opts opts;
-		//m::append(result_event, event, opts);
+		m::event::append::opts opts;
+		opts.event_idx = &event_idx;
+		opts.user_id = &user_room.user.user_id;
+		opts.user_room = &user_room;
+		m::event::append(result_event, event, opts);
+		++count;
 	}
 	results.~array();
 
 	json::stack::member
 	{
-		room_events_result, "count", json::value(count)
+		room_events_result, "count", json::value(long(matches))
 	};
 
-	json::stack::array
+	json::stack::array highlights
 	{
 		room_events_result, "highlights"
 	};
 
+	m::dbs::room_search_terms(search_term, [&highlights]
+	(const string_view &term)
+	{
+		highlights.append(json::value{term, json::STRING});
+		return true;
+	});
+	highlights.~array();
+
 	json::stack::object
 	{
 		room_events_result, "state"
 	};
+
+	const bool more
+	{
+		pos < candidates.size() || (recent && floor)
+	};
+
+	char next_batch_buf[24];
+	if(more)
+		json::stack::member
+		{
+			room_events_result, "next_batch", json::value
+			{
+				recent?
+					lex_cast(last, next_batch_buf):
+					lex_cast(pos, next_batch_buf),
+				json::STRING
+			}
+		};
+
+	log::debug
+	{
+		m::search::log, "Search [%s] keys:%s order_by:%s inc_state:%b user:%s rooms:%zu matches:%zu candidates:%zu floor:%lu result:%zu",
+		search_term,
+		json::get<"keys"_>(room_events),
+		json::get<"order_by"_>(room_events),
+		json::get<"include_state"_>(room_events),
+		string_view{request.user_id},
+		rooms.size(),
+		matches,
+		candidates.size(),
+		floor,
+		count,
+	};
 }
 catch(const std::system_error &)
 {
@@ -169,7 +403,6 @@ catch(const std::exception &e)
 {
 	log::error
 	{
-		//TODO: search::log
-		m::log, "Search error :%s", e.what()
+		m::search::log, "Search error :%s", e.what()
 	};
 }
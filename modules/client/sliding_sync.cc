@@ -0,0 +1,416 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::sliding_sync
+{
+	using range = std::pair<size_t, size_t>;
+	using window = std::vector<std::pair<room::id::buf, event::idx>>;
+
+	static range make_range(const json::array &);
+	static bool append(json::stack::array &, const user::room &, const event &, const event::idx &);
+	static bool append(json::stack::array &, const user::room &, const event::idx &);
+	static void room_required_state(json::stack::object &, const user::room &, const room &, const json::array &);
+	static void room_timeline(json::stack::object &, const user::room &, const room &, const size_t &);
+	static void room_handle(json::stack::object &, const user::room &, const room::id &, const event::idx &, const json::object &);
+	static resource::response handle_post(client &, const resource::request &);
+
+	extern conf::item<size_t> range_max;
+	extern conf::item<size_t> timeline_limit_max;
+	extern resource::method method_post;
+	extern resource resource;
+}
+
+ircd::mapi::header
+IRCD_MODULE
+{
+	"Client (MSC3575) :Sliding Sync"
+};
+
+decltype(ircd::m::sliding_sync::resource)
+ircd::m::sliding_sync::resource
+{
+	"/_matrix/client/unstable/org.matrix.msc3575/sync",
+	{
+		"(MSC3575) Sliding Sync room lists ordered by recent activity"
+	}
+};
+
+decltype(ircd::m::sliding_sync::method_post)
+ircd::m::sliding_sync::method_post
+{
+	resource, "POST", handle_post,
+	{
+		method_post.REQUIRES_AUTH
+	}
+};
+
+decltype(ircd::m::sliding_sync::range_max)
+ircd::m::sliding_sync::range_max
+{
+	{ "name",     "ircd.client.sliding_sync.range.max" },
+	{ "default",  256L                                 },
+};
+
+decltype(ircd::m::sliding_sync::timeline_limit_max)
+ircd::m::sliding_sync::timeline_limit_max
+{
+	{ "name",     "ircd.client.sliding_sync.timeline_limit.max" },
+	{ "default",  64L                                           },
+};
+
+/// Every list is a window into the same ordering of the user's rooms by
+/// their latest event; the _user_room_recency index is iterated once up to
+/// the end of the furthest range requested and only the rooms which fall
+/// within a range are fetched from the database.
+ircd::m::resource::response
+ircd::m::sliding_sync::handle_post(client &client,
+                                   const resource::request &request)
+{
+	const json::object &lists
+	{
+		request["lists"]
+	};
+
+	size_t window_max(0);
+	for(const auto &[name, list] : lists)
+		for(const json::array range : json::array(json::object(list)["ranges"]))
+			window_max = std::max(window_max, make_range(range).second + 1);
+
+	const m::user::rooms rooms
+	{
+		request.user_id
+	};
+
+	size_t count(0);
+	window window;
+	rooms.for_each_recent([&window, &window_max, &count]
+	(const room::id &room_id, const event::idx &event_idx)
+	{
+		if(count++ < window_max)
+			window.emplace_back(room_id, event_idx);
+
+		return true;
+	});
+
+	// The list which first included each room in the window determines
+	// what is sent for the room; an empty object is a room not included.
+	std::vector<json::object> included(window.size());
+
+	const m::user::room user_room
+	{
+		request.user_id
+	};
+
+	resource::response::chunked response
+	{
+		client, http::OK
+	};
+
+	json::stack out
+	{
+		response.buf, response.flusher()
+	};
+
+	json::stack::object top
+	{
+		out
+	};
+
+	json::stack::member
+	{
+		top, "pos", json::value
+		{
+			lex_cast(vm::sequence::retired), json::STRING
+		}
+	};
+
+	{
+		json::stack::object out_lists
+		{
+			top, "lists"
+		};
+
+		for(const auto &[name, list_] : lists)
+		{
+			const json::object &list
+			{
+				list_
+			};
+
+			json::stack::object out_list
+			{
+				out_lists, name
+			};
+
+			json::stack::member
+			{
+				out_list, "count", json::value
+				{
+					long(count)
+				}
+			};
+
+			json::stack::array ops
+			{
+				out_list, "ops"
+			};
+
+			for(const json::array range_ : json::array(list["ranges"]))
+			{
+				const auto range
+				{
+					make_range(range_)
+				};
+
+				json::stack::object op
+				{
+					ops
+				};
+
+				json::stack::member
+				{
+					op, "op", "SYNC"
+				};
+
+				{
+					json::stack::array out_range
+					{
+						op, "range"
+					};
+
+					out_range.append(json::value{long(range.first)});
+					out_range.append(json::value{long(range.second)});
+				}
+
+				json::stack::array room_ids
+				{
+					op, "room_ids"
+				};
+
+				for(size_t i(range.first); i <= range.second && i < window.size(); ++i)
+				{
+					room_ids.append(window.at(i).first);
+					if(empty(included.at(i)))
+						included.at(i) = list;
+				}
+			}
+		}
+	}
+
+	json::stack::object out_rooms
+	{
+		top, "rooms"
+	};
+
+	for(size_t i(0); i < window.size(); ++i)
+	{
+		if(empty(included.at(i)))
+			continue;
+
+		const auto &[room_id, event_idx]
+		{
+			window.at(i)
+		};
+
+		json::stack::object out_room
+		{
+			out_rooms, room_id
+		};
+
+		room_handle(out_room, user_room, room_id, event_idx, included.at(i));
+	}
+
+	return response;
+}
+
+void
+ircd::m::sliding_sync::room_handle(json::stack::object &out,
+                                   const user::room &user_room,
+                                   const room::id &room_id,
+                                   const event::idx &event_idx,
+                                   const json::object &list)
+{
+	const m::room room
+	{
+		room_id
+	};
+
+	json::stack::member
+	{
+		out, "initial", json::value
+		{
+			true
+		}
+	};
+
+	json::stack::member
+	{
+		out, "bump_stamp", json::value
+		{
+			m::get<long>(std::nothrow, event_idx, "origin_server_ts", 0L)
+		}
+	};
+
+	room_required_state(out, user_room, room, list["required_state"]);
+
+	const size_t timeline_limit
+	{
+		std::min(list.get<size_t>("timeline_limit", 1UL), size_t(timeline_limit_max))
+	};
+
+	room_timeline(out, user_room, room, timeline_limit);
+}
+
+void
+ircd::m::sliding_sync::room_required_state(json::stack::object &out,
+                                           const user::room &user_room,
+                                           const room &room,
+                                           const json::array &required_state)
+{
+	json::stack::array array
+	{
+		out, "required_state"
+	};
+
+	const m::room::state state
+	{
+		room
+	};
+
+	for(const json::array pair : required_state)
+	{
+		const json::string &type
+		{
+			pair[0]
+		};
+
+		const json::string &state_key
+		{
+			pair[1]
+		};
+
+		if(state_key == "*")
+		{
+			state.for_each(type, event::closure_idx{[&array, &user_room]
+			(const event::idx &event_idx)
+			{
+				append(array, user_room, event_idx);
+			}});
+
+			continue;
+		}
+
+		const auto event_idx
+		{
+			state.get(std::nothrow, type, state_key)
+		};
+
+		if(event_idx)
+			append(array, user_room, event_idx);
+	}
+}
+
+void
+ircd::m::sliding_sync::room_timeline(json::stack::object &out,
+                                     const user::room &user_room,
+                                     const room &room,
+                                     const size_t &limit)
+{
+	std::vector<event::idx> event_idx;
+	event_idx.reserve(limit);
+
+	m::room::events it
+	{
+		room
+	};
+
+	for(; it && event_idx.size() < limit; --it)
+		event_idx.emplace_back(it.event_idx());
+
+	// The client wants the oldest event first.
+	std::reverse(begin(event_idx), end(event_idx));
+
+	json::stack::member
+	{
+		out, "limited", json::value
+		{
+			bool(it)
+		}
+	};
+
+	json::stack::array array
+	{
+		out, "timeline"
+	};
+
+	m::seek(std::nothrow, vector_view<const event::idx>(event_idx), [&array, &user_room, &event_idx]
+	(const size_t &pos, const m::event &event)
+	{
+		append(array, user_room, event, event_idx.at(pos));
+	});
+}
+
+bool
+ircd::m::sliding_sync::append(json::stack::array &array,
+                              const user::room &user_room,
+                              const event::idx &event_idx)
+{
+	const m::event::fetch event
+	{
+		std::nothrow, event_idx
+	};
+
+	if(unlikely(!event.valid))
+		return false;
+
+	return append(array, user_room, event, event_idx);
+}
+
+bool
+ircd::m::sliding_sync::append(json::stack::array &array,
+                              const user::room &user_room,
+                              const m::event &event,
+                              const event::idx &event_idx)
+{
+	if(!visible(event, user_room.user.user_id))
+		return false;
+
+	m::event::append::opts opts;
+	opts.event_idx = &event_idx;
+	opts.user_id = &user_room.user.user_id;
+	opts.user_room = &user_room;
+	opts.query_prev_state = false;
+	return m::event::append(array, event, opts);
+}
+
+ircd::m::sliding_sync::range
+ircd::m::sliding_sync::make_range(const json::array &range)
+{
+	const size_t lower
+	{
+		lex_cast<size_t>(range.at(0))
+	};
+
+	const size_t upper
+	{
+		lex_cast<size_t>(range.at(1))
+	};
+
+	if(upper < lower)
+		throw m::BAD_REQUEST
+		{
+			"Range [%zu, %zu] is inverted.", lower, upper
+		};
+
+	return
+	{
+		lower, std::min(upper, lower + size_t(range_max) - 1)
+	};
+}
@@ -10,6 +10,15 @@
 
 namespace ircd::m::sync
 {
+	struct cache_entry;
+	using fragment = std::shared_ptr<const std::string>;
+
+	static void _room_timeline_cache_erase(const m::event::idx &);
+	static void _room_timeline_cache_evict(const size_t &max);
+	static void _room_timeline_cache_redacted(const m::event &, m::vm::eval &);
+	static fragment _room_timeline_cache_get(data &, const m::event::idx &);
+	static fragment _room_timeline_cache_put(data &, const m::event::idx &, const m::event &);
+	static bool _room_timeline_cache_append(data &, json::stack::array &, const fragment &);
 	static bool _room_timeline_append(data &, json::stack::array &, const m::event::idx &, const m::event &);
 	static event::id::buf _room_timeline_polylog_events(data &, const m::room &, bool &, bool &);
 	static bool room_timeline_polylog(data &);
@@ -19,9 +28,24 @@ namespace ircd::m::sync
 
 	extern conf::item<size_t> limit_default;
 	extern conf::item<size_t> limit_initial_default;
+	extern conf::item<size_t> cache_size;
+	extern conf::item<size_t> cache_event_max;
+	extern std::map<m::event::idx, cache_entry> cache;
+	extern std::list<m::event::idx> cache_lru;
+	extern size_t cache_bytes;
+	extern hookfn<vm::eval &> cache_redacted_hook;
 	extern item room_timeline;
 }
 
+/// An event serialized for the cache and the depth of the room at the time
+/// of serialization, which its unsigned.age is relative to.
+struct ircd::m::sync::cache_entry
+{
+	fragment value;
+	int64_t room_depth {0};
+	std::list<m::event::idx>::iterator lru;
+};
+
 ircd::mapi::header
 IRCD_MODULE
 {
@@ -50,6 +74,46 @@ ircd::m::sync::limit_initial_default
 	{ "default",  1L                                                      },
 };
 
+decltype(ircd::m::sync::cache_size)
+ircd::m::sync::cache_size
+{
+	{ "name",     "ircd.client.sync.rooms.timeline.cache.size" },
+	{ "default",  long(16_MiB)                                 },
+};
+
+decltype(ircd::m::sync::cache_event_max)
+ircd::m::sync::cache_event_max
+{
+	{ "name",     "ircd.client.sync.rooms.timeline.cache.event_max" },
+	{ "default",  long(8_KiB)                                       },
+};
+
+/// Serialized timeline events which are the same for every user of a room
+/// who is not their sender, keyed by event_idx. An entry serialized at
+/// another depth of the room is replaced rather than served. An empty
+/// fragment is cached for an event which is not sent at all.
+decltype(ircd::m::sync::cache)
+ircd::m::sync::cache;
+
+/// Events of the cache from the least to the most recently used.
+decltype(ircd::m::sync::cache_lru)
+ircd::m::sync::cache_lru;
+
+decltype(ircd::m::sync::cache_bytes)
+ircd::m::sync::cache_bytes;
+
+/// A redaction can arrive at any depth, so the depth of the room doesn't
+/// tell an entry for the redacted event is stale; it's dropped instead.
+decltype(ircd::m::sync::cache_redacted_hook)
+ircd::m::sync::cache_redacted_hook
+{
+	_room_timeline_cache_redacted,
+	{
+		{ "_site",    "vm.effect"         },
+		{ "type",     "m.room.redaction"  },
+	}
+};
+
 bool
 ircd::m::sync::room_timeline_linear(data &data)
 {
@@ -143,6 +207,17 @@ ircd::m::sync::room_timeline_linear(data &data)
 		*data.out, "events"
 	};
 
+	auto fragment
+	{
+		_room_timeline_cache_get(data, data.event_idx)
+	};
+
+	if(!fragment)
+		fragment = _room_timeline_cache_put(data, data.event_idx, *data.event);
+
+	if(fragment)
+		return _room_timeline_cache_append(data, array, fragment);
+
 	return _room_timeline_append(data, array, data.event_idx, *data.event);
 }
 
@@ -282,12 +357,32 @@ ircd::m::sync::_room_timeline_polylog_events(data &data,
 	if(i > 0 && it)
 		for(++it; i > 0 && it; --i, ++it)
 		{
+			const auto event_idx
+			{
+				it.event_idx()
+			};
+
+			// The event is only fetched if it's not in the cache.
+			auto fragment
+			{
+				_room_timeline_cache_get(data, event_idx)
+			};
+
+			if(fragment)
+			{
+				ret |= _room_timeline_cache_append(data, array, fragment);
+				continue;
+			}
+
 			const m::event &event
 			{
 				*it
 			};
 
-			ret |= _room_timeline_append(data, array, it.event_idx(), event);
+			fragment = _room_timeline_cache_put(data, event_idx, event);
+			ret |= fragment?
+				_room_timeline_cache_append(data, array, fragment):
+				_room_timeline_append(data, array, event_idx, event);
 		}
 
 	return m::event_id(std::nothrow, event_idx);
@@ -307,3 +402,181 @@ ircd::m::sync::_room_timeline_append(data &data,
 	opts.room_depth = &data.room_depth;
 	return m::event::append(events, event, opts);
 }
+
+//
+// cache
+//
+
+void
+ircd::m::sync::_room_timeline_cache_redacted(const m::event &event,
+                                             m::vm::eval &eval)
+{
+	const auto &redacts
+	{
+		json::get<"redacts"_>(event)
+	};
+
+	const auto event_idx
+	{
+		valid(m::id::EVENT, redacts)?
+			m::index(std::nothrow, m::event::id(redacts)):
+			0UL
+	};
+
+	if(event_idx)
+		_room_timeline_cache_erase(event_idx);
+}
+
+ircd::m::sync::fragment
+ircd::m::sync::_room_timeline_cache_get(data &data,
+                                        const m::event::idx &event_idx)
+{
+	// Nothing is put while the cache is off; what it held is released.
+	if(unlikely(!size_t(cache_size)))
+	{
+		_room_timeline_cache_evict(0);
+		return {};
+	}
+
+	const auto it
+	{
+		cache.find(event_idx)
+	};
+
+	if(it == end(cache) || it->second.room_depth != data.room_depth)
+		return {};
+
+	// The user's own events carry their transaction_id.
+	auto &entry(it->second);
+	const fragment &ret(entry.value);
+	if(!empty(*ret) && json::string(json::object{*ret}.get("sender")) == data.user.user_id)
+		return {};
+
+	cache_lru.splice(end(cache_lru), cache_lru, entry.lru);
+	return ret;
+}
+
+/// Serialize the event without regard for the user and cache it. Returns
+/// null if the event cannot be shared between users, is larger than
+/// cache.event_max, or the cache is off.
+ircd::m::sync::fragment
+ircd::m::sync::_room_timeline_cache_put(data &data,
+                                        const m::event::idx &event_idx,
+                                        const m::event &event)
+{
+	if(!size_t(cache_size))
+		return {};
+
+	if(json::get<"sender"_>(event) == data.user.user_id)
+		return {};
+
+	if(*data.room == data.user_room)
+		return {};
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		size_t(cache_event_max)
+	};
+
+	json::stack out
+	{
+		buf
+	};
+
+	m::event::append::opts opts;
+	opts.event_idx = &event_idx;
+	opts.room_depth = &data.room_depth;
+	bool appended;
+	{
+		json::stack::array top
+		{
+			out
+		};
+
+		appended = m::event::append(top, event, opts);
+	}
+
+	// Too large for the buffer; it is appended for the user directly.
+	if(out.failed())
+		return {};
+
+	assert(out.done());
+	const json::array result
+	{
+		out.completed()
+	};
+
+	fragment ret
+	{
+		std::make_shared<const std::string>(appended? result.at(0) : string_view{})
+	};
+
+	// Another request may have cached it while this one serialized.
+	const auto it(cache.find(event_idx));
+	if(it != end(cache) && it->second.room_depth == data.room_depth)
+		return it->second.value;
+
+	if(it != end(cache))
+		_room_timeline_cache_erase(event_idx);
+
+	auto &entry(cache[event_idx]);
+	entry.value = ret;
+	entry.room_depth = data.room_depth;
+	entry.lru = cache_lru.emplace(end(cache_lru), event_idx);
+	cache_bytes += ret->size() + sizeof(*ret);
+	_room_timeline_cache_evict(cache_size);
+	return ret;
+}
+
+/// The least recently used events are discarded first.
+void
+ircd::m::sync::_room_timeline_cache_evict(const size_t &max)
+{
+	while(cache_bytes > max && !cache_lru.empty())
+		_room_timeline_cache_erase(cache_lru.front());
+}
+
+void
+ircd::m::sync::_room_timeline_cache_erase(const m::event::idx &event_idx)
+{
+	const auto it
+	{
+		cache.find(event_idx)
+	};
+
+	if(it == end(cache))
+		return;
+
+	const auto &entry(it->second);
+	assert(cache_bytes >= entry.value->size() + sizeof(*entry.value));
+	cache_bytes -= entry.value->size() + sizeof(*entry.value);
+	cache_lru.erase(entry.lru);
+	cache.erase(it);
+}
+
+bool
+ircd::m::sync::_room_timeline_cache_append(data &data,
+                                           json::stack::array &events,
+                                           const fragment &fragment)
+{
+	assert(fragment);
+	if(empty(*fragment))
+		return false;
+
+	const json::object event
+	{
+		*fragment
+	};
+
+	const json::string &sender
+	{
+		event.get("sender")
+	};
+
+	if(!event.has("state_key") && m::user::ignores::enforce("events"))
+		if(m::user::ignores{data.user}.has(sender))
+			return false;
+
+	events.append(event);
+	return true;
+}
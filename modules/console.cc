@@ -1372,6 +1372,25 @@ console_cmd__stats(opt &out, const string_view &line)
 		    ;
 	}
 
+	for(const auto &[name, histogram] : stats::histograms)
+	{
+		static constexpr size_t name_width {60};
+
+		assert(histogram);
+		const auto trunc_name(trunc(name, name_width));
+		out << std::left << std::setw(name_width) << trunc_name;
+
+		if(size(trunc_name) == name_width)
+			out << "...";
+		else
+			out << "   ";
+
+		out << "  "
+		    << std::left << (*histogram)
+		    << std::endl
+		    ;
+	}
+
 	return true;
 }
 
@@ -6074,6 +6093,9 @@ console_cmd__resource(opt &out, const string_view &line)
 		    << (m.opts->flags & resource::method::CONTENT_DISCRETION? " CONTENT_DISCRETION" : "")
 		    << std::endl;
 
+		out << "latency (us) " << m.stats->latency
+		    << std::endl;
+
 		return true;
 	}
 
@@ -6096,6 +6118,7 @@ console_cmd__resource(opt &out, const string_view &line)
 			    << " | RET " << std::setw(8) << m.stats->completions
 			    << " | TIM " << std::setw(8) << m.stats->timeouts
 			    << " | ERR " << std::setw(8) << m.stats->internal_errors
+			    << " | P99 " << std::setw(8) << m.stats->latency.percentile(0.99L) << "us"
 			    << std::endl;
 		}
 	}
@@ -7771,6 +7794,17 @@ console_cmd__event__auth(opt &out, const string_view &line)
 bool
 console_cmd__event__refs__rebuild(opt &out, const string_view &line)
 {
+	const params param{line, " ",
+	{
+		"type"
+	}};
+
+	if(param["type"] == "auth_chain")
+	{
+		out << "placed " << m::event::refs::rebuild_auth_chain() << std::endl;
+		return true;
+	}
+
 	m::event::refs::rebuild();
 	out << "done" << std::endl;
 	return true;
@@ -9884,6 +9918,46 @@ console_cmd__room__state__space__rebuild(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__room__search__rebuild(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"room_id",
+	}};
+
+	const string_view &room_id
+	{
+		param.at("room_id")
+	};
+
+	if(room_id == "*")
+	{
+		size_t rooms(0), events(0);
+		m::rooms::for_each([&rooms, &events]
+		(const m::room::id &room_id)
+		{
+			if(m::internal(room_id))
+				return true;
+
+			events += m::search::rebuild(room_id);
+			++rooms;
+			return true;
+		});
+
+		out << "indexed " << events << " events in " << rooms << " rooms" << std::endl;
+		return true;
+	}
+
+	const auto _room_id
+	{
+		m::room_id(room_id)
+	};
+
+	out << "indexed " << m::search::rebuild(_room_id) << " events" << std::endl;
+	return true;
+}
+
 bool
 console_cmd__room__state__purge__replaced(opt &out, const string_view &line)
 {
@@ -11195,6 +11269,64 @@ console_cmd__user__rooms__origins(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__user__rooms__recent(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"user_id", "[limit]"
+	}};
+
+	const m::user &user
+	{
+		param.at(0)
+	};
+
+	auto limit
+	{
+		param.at(1, 32L)
+	};
+
+	const m::user::rooms rooms
+	{
+		user
+	};
+
+	rooms.for_each_recent([&out, &limit]
+	(const m::room::id &room_id, const m::event::idx &event_idx)
+	{
+		out << std::setw(10) << std::right << event_idx
+		    << " " << room_id
+		    << std::endl;
+
+		return --limit > 0;
+	});
+
+	return true;
+}
+
+bool
+console_cmd__user__rooms__recent__rebuild(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"user_id"
+	}};
+
+	const m::user &user
+	{
+		param.at(0)
+	};
+
+	const m::user::rooms rooms
+	{
+		user
+	};
+
+	out << "done " << rooms.rebuild_recent() << std::endl;
+	return true;
+}
+
 bool
 console_cmd__user__read(opt &out, const string_view &line)
 {
@@ -13,7 +13,7 @@
 std::list<txn> txns;
 std::map<std::string, node, std::less<>> nodes;
 
-void remove_node(const node &);
+static node *acquire(const string_view &remote);
 static void recv_timeout(txn &, node &);
 static void recv_timeouts();
 static bool recv_handle(txn &, node &);
@@ -21,10 +21,10 @@ static void recv();
 static void recv_worker();
 ctx::dock recv_action;
 
-static void send_from_user(const m::event &, const m::user::id &user_id);
-static void send_to_user(const m::event &, const m::user::id &user_id);
-static void send_to_room(const m::event &, const m::room::id &room_id);
-static void send(const m::event &);
+static void send_from_user(const m::event &, const string_view &unit, const m::user::id &user_id);
+static void send_to_user(const m::event &, const string_view &unit, const m::user::id &user_id);
+static void send_to_room(const m::event &, const string_view &unit, const m::room::id &room_id);
+static void send(const m::event &, const string_view &unit);
 static void send_worker();
 
 static void handle_notify(const m::event &, m::vm::eval &);
@@ -54,6 +54,95 @@ IRCD_MODULE
 	}
 };
 
+/// Transaction limits from the specification.
+constexpr const size_t
+TXN_PDUS_MAX {50},
+TXN_EDUS_MAX {100};
+
+conf::item<size_t>
+buffer_size_min
+{
+	{ "name",     "ircd.federation.sender.buffer.size.min" },
+	{ "default",  long(16_KiB)                              },
+};
+
+conf::item<size_t>
+buffer_size_max
+{
+	{ "name",     "ircd.federation.sender.buffer.size.max" },
+	{ "default",  long(512_KiB)                             },
+};
+
+conf::item<size_t>
+txn_size_min
+{
+	{ "name",     "ircd.federation.sender.txn.size.min" },
+	{ "default",  long(16_KiB)                           },
+};
+
+conf::item<size_t>
+txn_size_max
+{
+	{ "name",     "ircd.federation.sender.txn.size.max" },
+	{ "default",  long(1_MiB)                            },
+};
+
+conf::item<milliseconds>
+txn_latency_target
+{
+	{ "name",     "ircd.federation.sender.txn.latency.target" },
+	{ "default",  1500L                                        },
+};
+
+conf::item<seconds>
+retry_backoff_min
+{
+	{ "name",     "ircd.federation.sender.retry.backoff.min" },
+	{ "default",  15L                                         },
+};
+
+conf::item<seconds>
+retry_backoff_max
+{
+	{ "name",     "ircd.federation.sender.retry.backoff.max" },
+	{ "default",  3600L                                       },
+};
+
+stats::item
+queue_depth
+{
+	{ "name",     "ircd.federation.sender.queue.depth"                },
+	{ "desc",     "Number of units queued for all remotes"            },
+};
+
+stats::item
+queue_bytes
+{
+	{ "name",     "ircd.federation.sender.queue.bytes"                },
+	{ "desc",     "Number of bytes of units queued for all remotes"   },
+};
+
+stats::item
+inflight_bytes
+{
+	{ "name",     "ircd.federation.sender.inflight.bytes"             },
+	{ "desc",     "Number of bytes of transactions awaiting response" },
+};
+
+stats::item
+retrying
+{
+	{ "name",     "ircd.federation.sender.retrying"                   },
+	{ "desc",     "Number of remotes in retry backoff"                },
+};
+
+stats::item
+dropped
+{
+	{ "name",     "ircd.federation.sender.dropped"                    },
+	{ "desc",     "Number of units dropped from full or failed queues" },
+};
+
 std::deque<std::pair<std::string, m::event::id::buf>>
 notified_queue;
 
@@ -131,7 +220,21 @@ send_worker()
 			json::object{event_}, event_id
 		};
 
-		send(event);
+		// The notified JSON is already the PDU; an EDU is composed of the
+		// type and content.
+		thread_local char buf[m::event::MAX_SIZE];
+		const string_view &unit
+		{
+			event.event_id?
+				string_view{event_}:
+				json::stringify(mutable_buffer{buf}, json::members
+				{
+					{ "content",   json::get<"content"_>(event)  },
+					{ "edu_type",  json::get<"type"_>(event)     },
+				})
+		};
+
+		send(event, unit);
 	}
 	catch(const std::exception &e)
 	{
@@ -143,7 +246,8 @@ send_worker()
 }
 
 void
-send(const m::event &event)
+send(const m::event &event,
+     const string_view &unit)
 {
 	const auto &type
 	{
@@ -170,7 +274,7 @@ send(const m::event &event)
 
 	// target is every remote server in a room
 	if(valid(m::id::ROOM, room_id))
-		return send_to_room(event, m::room::id{room_id});
+		return send_to_room(event, unit, m::room::id{room_id});
 
 	// target is remote server hosting user/device
 	if(type == "m.direct_to_device")
@@ -181,54 +285,50 @@ send(const m::event &event)
 		};
 
 		if(valid(m::id::USER, target))
-			return send_to_user(event, m::user::id(target));
+			return send_to_user(event, unit, m::user::id(target));
 	}
 
 	// target is every remote server from every room a user is joined to.
 	if(valid(m::id::USER, sender))
-		return send_from_user(event, m::user::id{sender});
+		return send_from_user(event, unit, m::user::id{sender});
 }
 
 /// EDU and PDU path where the target is a room
 void
 send_to_room(const m::event &event,
+             const string_view &unit,
              const m::room::id &room_id)
 {
-	// Unit is not allocated until we find another server in the room.
-	std::shared_ptr<struct unit> unit;
+	const auto type
+	{
+		event.event_id? ring::PDU : ring::EDU
+	};
 
 	const m::room room{room_id};
 	const m::room::origins origins{room};
-	origins.for_each([&unit, &event]
+	origins.for_each([&type, &unit]
 	(const string_view &origin)
 	{
 		if(my_host(origin))
 			return;
 
-		auto it{nodes.lower_bound(origin)};
-		if(it == end(nodes) || it->first != origin)
+		auto *const node
 		{
-			if(server::errmsg(m::fed::matrix_service(origin)))
-				return;
-
-			it = nodes.emplace_hint(it, origin, origin);
-		}
+			acquire(origin)
+		};
 
-		auto &node{it->second};
-		if(node.err)
+		if(!node)
 			return;
 
-		if(!unit)
-			unit = std::make_shared<struct unit>(event);
-
-		node.push(unit);
-		node.flush();
+		node->push(type, unit);
+		node->flush();
 	});
 }
 
 /// EDU path where the target is a user/device
 void
 send_to_user(const m::event &event,
+             const string_view &unit,
              const m::user::id &user_id)
 {
 	const string_view &remote
@@ -239,32 +339,23 @@ send_to_user(const m::event &event,
 	if(my_host(remote))
 		return;
 
-	auto it{nodes.lower_bound(remote)};
-	if(it == end(nodes) || it->first != remote)
+	auto *const node
 	{
-		if(server::errmsg(m::fed::matrix_service(remote)))
-			return;
-
-		it = nodes.emplace_hint(it, remote, remote);
-	}
+		acquire(remote)
+	};
 
-	auto &node{it->second};
-	if(node.err)
+	if(!node)
 		return;
 
-	auto unit
-	{
-		std::make_shared<struct unit>(event)
-	};
-
-	node.push(std::move(unit));
-	node.flush();
+	node->push(ring::EDU, unit);
+	node->flush();
 }
 
 /// EDU path where the he target is every server from every room the sender
 /// is joined to.
 void
 send_from_user(const m::event &event,
+               const string_view &unit,
                const m::user::id &user_id)
 {
 	const m::user::servers servers
@@ -273,40 +364,115 @@ send_from_user(const m::event &event,
 	};
 
 	// Iterate all of the servers visible in this user's joined rooms.
-	servers.for_each("join", [&user_id, &event]
+	servers.for_each("join", [&unit]
 	(const string_view &origin)
 	{
 		if(my_host(origin))
 			return true;
 
-		auto it{nodes.lower_bound(origin)};
-		if(it == end(nodes) || it->first != origin)
+		auto *const node
 		{
-			if(server::errmsg(m::fed::matrix_service(origin)))
-				return true;
-
-			it = nodes.emplace_hint(it, origin, origin);
-		}
+			acquire(origin)
+		};
 
-		auto &node{it->second};
-		if(node.err)
+		if(!node)
 			return true;
 
-		auto unit
-		{
-			std::make_shared<struct unit>(event)
-		};
-
-		node.push(unit);
-		node.flush();
+		node->push(ring::EDU, unit);
+		node->flush();
 		return true;
 	});
 }
 
+/// Find or create the node for a remote. Null is returned when nothing
+/// should be queued for the remote at this time.
+node *
+acquire(const string_view &remote)
+{
+	auto it{nodes.lower_bound(remote)};
+	if(it == end(nodes) || it->first != remote)
+	{
+		if(server::errmsg(m::fed::matrix_service(remote)))
+			return nullptr;
+
+		it = nodes.emplace_hint(it, remote, remote);
+	}
+
+	auto &node{it->second};
+	if(!node.ready())
+		return nullptr;
+
+	return &node;
+}
+
+//
+// node
+//
+
+node::node(const string_view &remote)
+:remote{ircd::strlcpy{mutable_buffer{rembuf}, remote}}
+,room{this->remote}
+,stats
+{
+	node_stats::valid(this->remote)?
+		std::make_unique<node_stats>(this->remote):
+		nullptr
+}
+,txn_max
+{
+	txn_size_min
+}
+{
+	if(stats)
+		stats->txn_max = txn_max;
+}
+
+node::~node()
+noexcept
+{
+	account(-ssize_t(q.count), -ssize_t(q.bytes));
+	if(retries)
+		--retrying;
+}
+
+/// Copy a unit into the queue. The buffer grows to fit up to its maximum
+/// size, after which the oldest units are dropped to make room.
 void
-node::push(std::shared_ptr<unit> su)
+node::push(const enum ring::type &type,
+           const string_view &unit)
 {
-	q.emplace_back(std::move(su));
+	const auto depth(q.count), bytes(q.bytes);
+	const size_t max(buffer_size_max);
+	while(!q.fits(size(unit)) && q.capacity() < max)
+		q.reserve(std::min(std::max(q.capacity() * 2, size_t(buffer_size_min)), max));
+
+	size_t drops(0);
+	if(likely(ring::space(size(unit)) <= q.capacity()))
+	{
+		for(; !q.fits(size(unit)); ++drops)
+			q.pop();
+
+		q.push(type, unit);
+	}
+	else ++drops;
+
+	account(ssize_t(q.count) - depth, ssize_t(q.bytes) - bytes);
+	if(likely(!drops))
+		return;
+
+	dropped += drops;
+	if(stats)
+		stats->dropped += drops;
+
+	log::dwarning
+	{
+		m::log, "Dropped %zu units queued to '%s' (queue:%zu bytes:%zu capacity:%zu)",
+		drops,
+		remote,
+		q.count,
+		q.bytes,
+		q.capacity(),
+	};
 }
 
 bool
@@ -319,29 +485,42 @@ try
 	if(curtxn)
 		return true;
 
-	size_t pdus{0}, edus{0};
-	for(const auto &unit : q) switch(unit->type)
+	// Units are taken in order until the transaction would exceed the size
+	// adapted to this remote; at least one unit is always taken.
+	size_t pdus{0}, edus{0}, bytes{0};
+	q.for_each([this, &pdus, &edus, &bytes]
+	(const auto &type, const string_view &unit)
 	{
-		case unit::PDU:   ++pdus;  break;
-		case unit::EDU:   ++edus;  break;
-		default:                   break;
-	}
+		if(pdus + edus && bytes + size(unit) > txn_max)
+			return false;
+
+		if(type == ring::PDU && pdus >= TXN_PDUS_MAX)
+			return false;
+
+		if(type == ring::EDU && edus >= TXN_EDUS_MAX)
+			return false;
+
+		pdus += type == ring::PDU;
+		edus += type == ring::EDU;
+		bytes += size(unit);
+		return true;
+	});
 
 	size_t pc(0), ec(0);
-	std::vector<json::value> units(pdus + edus);
-	for(const auto &unit : q) switch(unit->type)
+	units.resize(pdus + edus);
+	q.for_each([this, &pdus, &edus, &pc, &ec]
+	(const auto &type, const string_view &unit)
 	{
-		case unit::PDU:
-			units.at(pc++) = string_view{unit->s};
-			break;
+		if(pc + ec >= pdus + edus)
+			return false;
 
-		case unit::EDU:
-			units.at(pdus + ec++) = string_view{unit->s};
-			break;
+		if(type == ring::PDU)
+			units.at(pc++) = unit;
+		else
+			units.at(pdus + ec++) = unit;
 
-		default:
-			break;
-	}
+		return true;
+	});
 
 	m::fed::send::opts opts;
 	opts.remote = remote;
@@ -362,17 +541,28 @@ try
 		m::txn::create(pduv, eduv)
 	};
 
+	// The units were copied into the content; their space is reclaimed.
+	const auto depth(q.count), qbytes(q.bytes);
+	for(size_t i(0); i < pc + ec; ++i)
+		q.pop();
+
+	account(ssize_t(q.count) - depth, ssize_t(q.bytes) - qbytes);
 	txns.emplace_back(*this, std::move(content), std::move(opts));
 	const unwind_nominal_assertion na;
 	curtxn = &txns.back();
-	q.clear();
+	inflight_bytes += size(curtxn->content);
+	if(stats)
+		stats->inflight_bytes = size(curtxn->content);
+
 	log::debug
 	{
-		m::log, "sending txn %s pdus:%zu edus:%zu to '%s'",
+		m::log, "sending txn %s pdus:%zu edus:%zu bytes:%zu to '%s' (queue:%zu)",
 		curtxn->txnid,
-		pdus,
-		edus,
+		pc,
+		ec,
+		size(curtxn->content),
 		this->remote,
+		q.count,
 	};
 
 	recv_action.notify_one();
@@ -385,10 +575,152 @@ catch(const std::exception &e)
 		"flush error to %s :%s", remote, e.what()
 	};
 
-	err = true;
+	fail();
 	return false;
 }
 
+/// The remote accepted a transaction. The size of the next transaction is
+/// doubled while the remote responds within the target latency and halved
+/// otherwise.
+void
+node::done(const milliseconds &latency)
+{
+	const bool fast
+	{
+		latency <= milliseconds(txn_latency_target)
+	};
+
+	this->latency = latency;
+	txn_max = fast?
+		std::min(txn_max * 2, size_t(txn_size_max)):
+		std::max(txn_max / 2, size_t(txn_size_min));
+
+	if(retries)
+		--retrying;
+
+	retries = 0;
+
+	// An idle remote keeps no more than the minimum buffer.
+	if(q.empty() && q.capacity() > ring::align(buffer_size_min))
+		q.release();
+
+	if(!stats)
+		return;
+
+	stats->latency = latency.count();
+	stats->txn_max = txn_max;
+	stats->retries = retries;
+}
+
+/// The remote failed a transaction. Everything queued for it is dropped and
+/// nothing more is queued until the retry backoff has elapsed.
+void
+node::fail()
+{
+	const auto drops(q.count);
+	account(-ssize_t(q.count), -ssize_t(q.bytes));
+	q.release();
+	dropped += drops;
+	if(!retries++)
+		++retrying;
+
+	const seconds backoff
+	{
+		std::min(seconds(retry_backoff_min) * (1L << std::min(retries - 1, 16UL)), seconds(retry_backoff_max))
+	};
+
+	err = true;
+	retry_after = now<steady_point>() + backoff;
+	txn_max = txn_size_min;
+	if(!stats)
+		return;
+
+	stats->dropped += drops;
+	stats->retries = retries;
+	stats->txn_max = txn_max;
+}
+
+/// Whether units can be queued for the remote. A remote in error is tried
+/// again once its backoff has elapsed and the server has no error for it.
+bool
+node::ready()
+{
+	if(!err)
+		return true;
+
+	if(curtxn)
+		return false;
+
+	if(now<steady_point>() < retry_after)
+		return false;
+
+	if(server::errmsg(m::fed::matrix_service(remote)))
+		return false;
+
+	err = false;
+	return true;
+}
+
+void
+node::account(const ssize_t &depth,
+              const ssize_t &bytes)
+{
+	queue_depth += depth;
+	queue_bytes += bytes;
+	if(!stats)
+		return;
+
+	stats->queue_depth += depth;
+	stats->queue_bytes += bytes;
+}
+
+//
+// node_stats
+//
+
+node_stats::node_stats(const string_view &remote)
+:queue_depth
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.queue.depth", remote} },
+}
+,queue_bytes
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.queue.bytes", remote} },
+}
+,inflight_bytes
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.inflight.bytes", remote} },
+}
+,retries
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.retries", remote} },
+}
+,dropped
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.dropped", remote} },
+}
+,latency
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.latency", remote} },
+}
+,txn_max
+{
+	{ "name", fmt::snstringf{128, "ircd.federation.sender.node.%s.txn.max", remote} },
+}
+{
+}
+
+bool
+node_stats::valid(const string_view &remote)
+{
+	const string_view longest
+	{
+		"ircd.federation.sender.node..inflight.bytes"
+	};
+
+	return size(longest) + size(remote) <= stats::item::NAME_MAX_LEN;
+}
+
 void
 __attribute__((noreturn))
 recv_worker()
@@ -440,15 +772,22 @@ try
 		recv_handle(txn, node)
 	};
 
+	const auto latency
+	{
+		duration_cast<milliseconds>(now<steady_point>() - txn.timeout)
+	};
+
+	inflight_bytes -= size(txn.content);
+	if(node.stats)
+		node.stats->inflight_bytes = 0;
+
 	node.curtxn = nullptr;
 	txns.erase(it);
 
-	if(node.err)
-		return remove_node(node);
-
-	if(!ret)
-		return;
+	if(!ret || node.err)
+		return node.fail();
 
+	node.done(latency);
 	node.flush();
 }
 catch(const std::exception &e)
@@ -567,15 +906,3 @@ recv_timeout(txn &txn,
 	cancel(txn);
 	node.err = true;
 }
-
-void
-remove_node(const node &node)
-{
-	const auto it
-	{
-		nodes.find(node.remote)
-	};
-
-	assert(it != end(nodes));
-	nodes.erase(it);
-}
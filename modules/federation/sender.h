@@ -18,47 +18,244 @@ using namespace ircd;
 struct txn;
 struct node;
 
-struct unit
-:std::enable_shared_from_this<unit>
+/// Queue of the serialized PDUs and EDUs for a remote. Units are copied into
+/// a fixed buffer behind a small header; a unit which doesn't fit before the
+/// end of the buffer is placed at the front instead. The buffer is allocated
+/// by the first push and released by release().
+struct ring
 {
-	enum type { PDU, EDU, FAILURE };
+	enum type :uint8_t { PDU, EDU, WRAP };
 
-	enum type type;
-	std::string s;
+	struct header
+	{
+		uint32_t size;
+		enum type type;
+	};
+
+	using closure = std::function<bool (const enum type &, const string_view &)>;
+
+	unique_buffer<mutable_buffer> buf;
+	size_t head {0};
+	size_t tail {0};
+	size_t count {0};
+	size_t bytes {0};
+
+	static size_t align(const size_t &size);
+	static size_t space(const size_t &size);
+
+	const header &at(const size_t &pos) const;
+	header &at(const size_t &pos);
 
-	unit(std::string s, const enum type &type);
-	unit(const m::event &event);
+	bool empty() const;
+	size_t capacity() const;
+	bool fits(const size_t &size) const;
+	bool for_each(const closure &) const;
+
+	void pop();
+	void clear();
+	void release();
+	void reserve(const size_t &capacity);
+	bool push(const enum type &, const string_view &);
 };
 
-unit::unit(std::string s, const enum type &type)
-:type{type}
-,s{std::move(s)}
+static_assert(sizeof(ring::header) == 8);
+
+size_t
+ring::align(const size_t &size)
+{
+	return (size + sizeof(header) - 1) / sizeof(header) * sizeof(header);
+}
+
+size_t
+ring::space(const size_t &size)
+{
+	// Units are padded so every header is aligned.
+	return sizeof(header) + align(size);
+}
+
+const ring::header &
+ring::at(const size_t &pos)
+const
+{
+	assert(pos + sizeof(header) <= capacity());
+	return *reinterpret_cast<const header *>(data(buf) + pos);
+}
+
+ring::header &
+ring::at(const size_t &pos)
+{
+	assert(pos + sizeof(header) <= capacity());
+	return *reinterpret_cast<header *>(data(buf) + pos);
+}
+
+bool
+ring::empty()
+const
+{
+	return !count;
+}
+
+size_t
+ring::capacity()
+const
 {
+	return ircd::buffer::size(buf);
+}
+
+/// Whether a unit of size can be pushed without dropping any other.
+bool
+ring::fits(const size_t &size)
+const
+{
+	const auto need
+	{
+		space(size)
+	};
+
+	if(empty())
+		return need <= capacity();
+
+	if(tail > head)
+		return need <= capacity() - tail || need <= head;
+
+	return need <= head - tail;
+}
+
+bool
+ring::for_each(const closure &closure)
+const
+{
+	size_t pos(head);
+	for(size_t i(0); i < count; ++i)
+	{
+		if(pos == capacity() || at(pos).type == WRAP)
+			pos = 0;
+
+		const auto *const hdr
+		{
+			&at(pos)
+		};
+
+		const string_view unit
+		{
+			data(buf) + pos + sizeof(header), hdr->size
+		};
+
+		if(!closure(hdr->type, unit))
+			return false;
+
+		pos += space(hdr->size);
+	}
+
+	return true;
 }
 
-unit::unit(const m::event &event)
-:type{event.event_id? PDU : EDU}
-,s{[this, &event]() -> std::string
+bool
+ring::push(const enum type &type,
+           const string_view &unit)
 {
-	switch(this->type)
+	if(unlikely(space(size(unit)) > capacity()))
+		return false;
+
+	assert(fits(size(unit)));
+	if(empty())
+		head = tail = 0;
+
+	if(tail >= head && space(size(unit)) > capacity() - tail)
 	{
-		case PDU:
-			return json::strung{event};
-
-		case EDU:
-			return json::strung{json::members
-			{
-				{ "content",   json::get<"content"_>(event)  },
-				{ "edu_type",  json::get<"type"_>(event)     },
-			}};
-
-		default:
-			return {};
+		if(tail < capacity())
+			at(tail).type = WRAP;
+
+		tail = 0;
 	}
-}()}
+
+	at(tail).size = size(unit);
+	at(tail).type = type;
+	copy(mutable_buffer{data(buf) + tail + sizeof(header), size(unit)}, unit);
+	tail += space(size(unit));
+	bytes += size(unit);
+	++count;
+	return true;
+}
+
+void
+ring::pop()
+{
+	assert(!empty());
+	if(head == capacity() || at(head).type == WRAP)
+		head = 0;
+
+	const auto *const hdr
+	{
+		&at(head)
+	};
+
+	assert(bytes >= hdr->size);
+	bytes -= hdr->size;
+	head += space(hdr->size);
+	if(!--count)
+		head = tail = 0;
+}
+
+void
+ring::clear()
 {
+	head = tail = 0;
+	count = 0;
+	bytes = 0;
 }
 
+void
+ring::release()
+{
+	clear();
+	buf = {};
+}
+
+/// Move the units into a new buffer of capacity at the front. The capacity
+/// is rounded up to a multiple of the header so the tail is never left with
+/// less than a header before the end, where push() writes the WRAP.
+void
+ring::reserve(const size_t &capacity)
+{
+	ring next;
+	next.buf = unique_buffer<mutable_buffer>
+	{
+		align(capacity)
+	};
+
+	for_each([&next]
+	(const auto &type, const auto &unit)
+	{
+		const bool pushed
+		{
+			next.fits(size(unit)) && next.push(type, unit)
+		};
+
+		assert(pushed);
+		return pushed;
+	});
+
+	*this = std::move(next);
+}
+
+/// Stats for a remote; the remote is part of the name of every item so
+/// nodes with a very long name go without.
+struct node_stats
+{
+	stats::item queue_depth;
+	stats::item queue_bytes;
+	stats::item inflight_bytes;
+	stats::item retries;
+	stats::item dropped;
+	stats::item latency;
+	stats::item txn_max;
+
+	static bool valid(const string_view &remote);
+
+	node_stats(const string_view &remote);
+};
+
 struct txndata
 {
 	std::string content;
@@ -73,21 +270,31 @@ struct txndata
 
 struct node
 {
-	std::deque<std::shared_ptr<unit>> q;
+	ring q;
+	std::vector<json::value> units;
 	std::array<char, rfc3986::DOMAIN_BUFSIZE> rembuf;
 	string_view remote;
 	m::node::room room;
 	server::request::opts sopts;
+	std::unique_ptr<node_stats> stats;
 	txn *curtxn {nullptr};
+	size_t txn_max {0};
+	size_t retries {0};
+	milliseconds latency {0ms};
+	steady_point retry_after;
 	bool err {false};
 
+	void account(const ssize_t &depth, const ssize_t &bytes);
+	void fail();
+	void done(const milliseconds &latency);
+	bool ready();
 	bool flush();
-	void push(std::shared_ptr<unit>);
+	void push(const enum ring::type &, const string_view &);
 
-	node(const string_view &remote)
-	:remote{ircd::strlcpy{mutable_buffer{rembuf}, remote}}
-	,room{this->remote}
-	{}
+	node(const string_view &remote);
+	node(node &&) = delete;
+	node(const node &) = delete;
+	~node() noexcept;
 };
 
 struct txn
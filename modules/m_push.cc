@@ -10,20 +10,96 @@
 
 namespace ircd::m::push
 {
+	struct program;
+	struct ruleset;
+
 	static void execute(const event &, vm::eval &, const user::id &, const path &, const rule &, const event::idx &);
-	static bool matching(const event &, vm::eval &, const user::id &, const path &, const rule &);
-	static bool handle_kind(const event &, vm::eval &, const user::id &, const path &);
-	static void handle_rules(const event &, vm::eval &, const user::id &, const string_view &scope);
+	static bool matching(const event &, vm::eval &, const user::id &, const program &, const size_t &);
+	static void handle_rules(const event &, vm::eval &, const user::id &, const ruleset &, std::vector<int8_t> &);
+	static std::shared_ptr<ruleset> compile(const user::id &);
+	static std::shared_ptr<ruleset> acquire(const user::id &);
+	static void handle_invalidate(const m::event &, vm::eval &);
 	static void handle_event(const m::event &, vm::eval &);
+
+	extern conf::item<bool> cache_enable;
+	extern std::map<std::string, std::weak_ptr<program>, std::less<>> programs;
+	extern std::map<std::string, std::shared_ptr<ruleset>, std::less<>> rulesets;
+	extern uint64_t invalidations;
+	extern hookfn<vm::eval &> hook_invalidate;
 	extern hookfn<vm::eval &> hook_event;
 }
 
+/// The rules of a user compiled into the order of evaluation. The JSON of
+/// each rule is parsed once here rather than on every event. Users with
+/// identical rules share the same program by its signature, which allows
+/// the results of rules not dependent on the user to be computed once for
+/// all of them.
+struct ircd::m::push::program
+{
+	struct entry;
+
+	std::string signature;
+	std::deque<entry> rules; // entries hold views of themselves; no relocation
+
+	program(std::string signature);
+	program(program &&) = delete;
+	program(const program &) = delete;
+	~program() noexcept;
+};
+
+struct ircd::m::push::program::entry
+{
+	std::string kind;
+	std::string ruleid;
+	std::string source;
+	push::rule rule;
+	std::vector<push::cond> cond;
+	bool user_dependent {false};
+
+	entry(const string_view &kind, const string_view &ruleid, const json::object &source);
+	entry(entry &&) = delete;
+	entry(const entry &) = delete;
+};
+
+/// A user's handle to a program. The event::idx of each rule is specific to
+/// the user so it is kept here rather than in the shared program.
+struct ircd::m::push::ruleset
+{
+	std::shared_ptr<push::program> program;
+	std::vector<event::idx> rule_idx;
+};
+
 ircd::mapi::header
 IRCD_MODULE
 {
 	"Matrix 13.13 :Push Notifications",
 };
 
+decltype(ircd::m::push::cache_enable)
+ircd::m::push::cache_enable
+{
+	{ "name",     "ircd.m.push.cache.enable" },
+	{ "default",  true                       },
+};
+
+decltype(ircd::m::push::programs)
+ircd::m::push::programs;
+
+decltype(ircd::m::push::rulesets)
+ircd::m::push::rulesets;
+
+decltype(ircd::m::push::invalidations)
+ircd::m::push::invalidations;
+
+decltype(ircd::m::push::hook_invalidate)
+ircd::m::push::hook_invalidate
+{
+	handle_invalidate,
+	{
+		{ "_site", "vm.effect" },
+	}
+};
+
 decltype(ircd::m::push::hook_event)
 ircd::m::push::hook_event
 {
@@ -33,6 +109,42 @@ ircd::m::push::hook_event
 	}
 };
 
+/// Discards the cached ruleset of a user when a push rule is written to (or
+/// redacted from) their user room; it is recompiled on next use.
+void
+ircd::m::push::handle_invalidate(const m::event &event,
+                                 vm::eval &eval)
+{
+	// User rooms are internal rooms.
+	if(!eval.room_internal)
+		return;
+
+	const auto &type
+	{
+		json::get<"type"_>(event)
+	};
+
+	if(!startswith(type, rule::type_prefix) && type != "m.room.redaction")
+		return;
+
+	const m::user::id &sender
+	{
+		at<"sender"_>(event)
+	};
+
+	if(!my(sender) || !m::user::room::is(at<"room_id"_>(event), sender))
+		return;
+
+	++invalidations;
+	const auto it
+	{
+		rulesets.find(string_view{sender})
+	};
+
+	if(it != end(rulesets))
+		rulesets.erase(it);
+}
+
 void
 ircd::m::push::handle_event(const m::event &event,
                             vm::eval &eval)
@@ -56,7 +168,8 @@ try
 		room_id
 	};
 
-	members.for_each("join", my_host(), [&event, &eval]
+	std::vector<std::pair<std::shared_ptr<ruleset>, user::id::buf>> users;
+	members.for_each("join", my_host(), [&event, &users]
 	(const user::id &user_id, const event::idx &membership_event_idx)
 	{
 		// r0.6.0-13.13.15 Homeservers MUST NOT notify the Push Gateway for
@@ -64,9 +177,30 @@ try
 		if(user_id == at<"sender"_>(event))
 			return true;
 
-		handle_rules(event, eval, user_id, "global");
+		users.emplace_back(acquire(user_id), user_id);
 		return true;
 	});
+
+	// Users sharing a program are made adjacent so the results of their
+	// common rules can be memoized for the group.
+	std::sort(begin(users), end(users), []
+	(const auto &a, const auto &b)
+	{
+		return a.first->program < b.first->program;
+	});
+
+	std::vector<int8_t> memo;
+	const program *last {nullptr};
+	for(const auto &[ruleset, user_id] : users)
+	{
+		if(ruleset->program.get() != last)
+		{
+			last = ruleset->program.get();
+			memo.assign(last->rules.size(), -1);
+		}
+
+		handle_rules(event, eval, user_id, *ruleset, memo);
+	}
 }
 catch(const ctx::interrupted &)
 {
@@ -82,86 +216,83 @@ catch(const std::exception &e)
 	};
 }
 
+/// Evaluates the user's rules in order and executes the first match. The
+/// memo holds the result of each rule not dependent on the user for the
+/// group of users sharing the program: -1 when not yet evaluated.
 void
 ircd::m::push::handle_rules(const event &event,
                             vm::eval &eval,
                             const user::id &user_id,
-                            const string_view &scope)
+                            const ruleset &ruleset,
+                            std::vector<int8_t> &memo)
 {
-	const push::path path[]
+	const auto &program
 	{
-		{ scope, "override",   string_view{}         },
-		{ scope, "content",    string_view{}         },
-		{ scope, "room",       at<"room_id"_>(event) },
-		{ scope, "sender",     at<"sender"_>(event)  },
-		{ scope, "underride",  string_view{}         },
+		*ruleset.program
 	};
 
-	for(const auto &p : path)
-		if(!handle_kind(event, eval, user_id, p))
-			break;
-}
-
-bool
-ircd::m::push::handle_kind(const event &event,
-                           vm::eval &eval,
-                           const user::id &user_id,
-                           const path &path)
-{
-	const user::pushrules pushrules
+	assert(memo.size() == program.rules.size());
+	assert(ruleset.rule_idx.size() == program.rules.size());
+	for(size_t i(0); i < program.rules.size(); ++i)
 	{
-		user_id
-	};
+		const auto &rule
+		{
+			program.rules[i]
+		};
 
-	return pushrules.for_each(path, [&event, &eval, &user_id]
-	(const auto &event_idx, const auto &path, const auto &rule)
-	{
-		if(matching(event, eval, user_id, path, rule))
+		if(rule.kind == "room" && rule.ruleid != json::get<"room_id"_>(event))
+			continue;
+
+		if(rule.kind == "sender" && rule.ruleid != json::get<"sender"_>(event))
+			continue;
+
+		const bool match
 		{
-			execute(event, eval, user_id, path, rule, event_idx);
-			return false; // false to break due to match
-		}
-		else return true;
-	});
+			rule.user_dependent?
+				matching(event, eval, user_id, program, i):
+
+			memo[i] < 0?
+				bool((memo[i] = matching(event, eval, user_id, program, i))):
+
+			bool(memo[i])
+		};
+
+		if(!match)
+			continue;
+
+		const push::path path
+		{
+			"global", rule.kind, rule.ruleid
+		};
+
+		execute(event, eval, user_id, path, rule.rule, ruleset.rule_idx[i]);
+		break;
+	}
 }
 
 bool
 ircd::m::push::matching(const event &event,
                         vm::eval &eval,
                         const user::id &user_id,
-                        const path &path,
-                        const rule &rule)
+                        const program &program,
+                        const size_t &pos)
 try
 {
-	const auto &[scope, kind, ruleid]
+	const auto &rule
 	{
-		path
+		program.rules.at(pos)
 	};
 
-	if(!json::get<"enabled"_>(rule))
+	if(!json::get<"enabled"_>(rule.rule))
 		return false;
 
 	push::match::opts opts;
 	opts.user_id = user_id;
-	const push::match match
-	{
-		event, rule, opts
-	};
-
-	#if 0
-	log::debug
-	{
-		log, "event %s rule { %s, %s, %s } for %s %s",
-		string_view{event.event_id},
-		scope,
-		kind,
-		ruleid,
-		string_view{user_id},
-		bool(match)? "MATCH"_sv : string_view{}
-	};
-	#endif
+	for(const auto &cond : rule.cond)
+		if(!push::match(event, cond, opts))
+			return false;
 
-	return bool(match);
+	return true;
 }
 catch(const ctx::interrupted &)
 {
@@ -169,25 +300,169 @@ catch(const ctx::interrupted &)
 }
 catch(const std::exception &e)
 {
-	const auto &[scope, kind, ruleid]
+	const auto &rule
 	{
-		path
+		program.rules.at(pos)
 	};
 
 	log::error
 	{
-		log, "Push rule matching in %s for %s at { %s, %s, %s } :%s",
+		log, "Push rule matching in %s for %s at { global, %s, %s } :%s",
 		string_view{event.event_id},
 		string_view{user_id},
-		scope,
-		kind,
-		ruleid,
+		rule.kind,
+		rule.ruleid,
 		e.what(),
 	};
 
 	return false;
 }
 
+//
+// ruleset
+//
+
+std::shared_ptr<ircd::m::push::ruleset>
+ircd::m::push::acquire(const user::id &user_id)
+{
+	const auto it
+	{
+		rulesets.find(string_view{user_id})
+	};
+
+	if(it != end(rulesets))
+		return it->second;
+
+	// The compilation yields; the result is not cached if a rule of any user
+	// was written in the interim.
+	const auto invalidations
+	{
+		push::invalidations
+	};
+
+	auto ret
+	{
+		compile(user_id)
+	};
+
+	if(cache_enable && invalidations == push::invalidations)
+		rulesets.insert_or_assign(std::string{user_id}, ret);
+
+	return ret;
+}
+
+std::shared_ptr<ircd::m::push::ruleset>
+ircd::m::push::compile(const user::id &user_id)
+{
+	static const string_view kinds[]
+	{
+		"override", "content", "room", "sender", "underride"
+	};
+
+	const user::pushrules pushrules
+	{
+		user_id
+	};
+
+	std::vector<std::pair<std::string, event::idx>> source;
+	std::vector<std::pair<string_view, string_view>> path;
+	std::string signature;
+	for(const auto &kind : kinds)
+		pushrules.for_each(push::path{"global", kind, {}}, [&]
+		(const auto &event_idx, const auto &path_, const json::object &rule)
+		{
+			const auto &ruleid
+			{
+				std::get<2>(path_)
+			};
+
+			source.emplace_back(std::string{rule}, event_idx);
+			path.emplace_back(kind, ruleid);
+			signature += kind;
+			signature += '\0';
+			signature += ruleid;
+			signature += '\0';
+			signature += string_view{rule};
+			signature += '\0';
+			return true;
+		});
+
+	auto ret
+	{
+		std::make_shared<ruleset>()
+	};
+
+	ret->rule_idx.reserve(source.size());
+	for(const auto &[source, event_idx] : source)
+		ret->rule_idx.emplace_back(event_idx);
+
+	auto &program
+	{
+		programs[signature]
+	};
+
+	if((ret->program = program.lock()))
+		return ret;
+
+	ret->program = std::make_shared<push::program>(std::move(signature));
+	for(size_t i(0); i < source.size(); ++i)
+		ret->program->rules.emplace_back(path[i].first, path[i].second, json::object{source[i].first});
+
+	program = ret->program;
+	return ret;
+}
+
+//
+// program
+//
+
+ircd::m::push::program::program(std::string signature)
+:signature{std::move(signature)}
+{
+}
+
+ircd::m::push::program::~program()
+noexcept
+{
+	const auto it
+	{
+		programs.find(signature)
+	};
+
+	if(it != end(programs) && it->second.expired())
+		programs.erase(it);
+}
+
+ircd::m::push::program::entry::entry(const string_view &kind,
+                                     const string_view &ruleid,
+                                     const json::object &source)
+:kind{kind}
+,ruleid{ruleid}
+,source{source}
+,rule{json::object{this->source}}
+{
+	static const string_view user_dependent_kind[]
+	{
+		"contains_user_mxid",
+		"state_key_user_mxid",
+		"contains_display_name",
+	};
+
+	if(json::get<"pattern"_>(rule))
+		cond.emplace_back(json::members
+		{
+			{ "kind",     "event_match"               },
+			{ "key",      "content.body"              },
+			{ "pattern",  json::get<"pattern"_>(rule) },
+		});
+
+	for(const json::object &cond : json::get<"conditions"_>(rule))
+		this->cond.emplace_back(cond);
+
+	for(const auto &cond : this->cond)
+		user_dependent |= std::find(begin(user_dependent_kind), end(user_dependent_kind), json::get<"kind"_>(cond)) != end(user_dependent_kind);
+}
+
 void
 ircd::m::push::execute(const event &event,
                        vm::eval &eval,
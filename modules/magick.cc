@@ -25,10 +25,12 @@ namespace ircd::magick
 	static void *handle_malloc(size_t) noexcept;
 	static void handle_free(void *) noexcept;
 	static uint handle_progress(const char *, const int64_t, const uint64_t, ExceptionInfo *) noexcept;
+	static void handle_result(const ExceptionInfo &);
 
 	template<class R, class F, class... A> static R call(F&&, A&&...);
 	template<class R, class F, class... A> static R callex(F&&, A&&...);
 	template<class F, class... A> static void callpf(F&&, A&&...);
+	static void submit(const std::function<void ()> &);
 
 	static void init();
 	static void fini();
@@ -40,6 +42,19 @@ namespace ircd::magick
 	extern conf::item<uint64_t> limit_cycles;
 	extern conf::item<uint64_t> yield_threshold;
 	extern conf::item<uint64_t> yield_interval;
+	extern conf::item<uint64_t> limit_pixels;
+	extern conf::item<milliseconds> limit_time;
+	extern conf::item<bool> pool_enable;
+	extern conf::item<size_t> pool_concurrency;
+	extern conf::item<size_t> pool_queue;
+	extern size_t pool_running, pool_queued;
+	extern ctx::dock pool_dock;
+	extern stats::item jobs_queued;
+	extern stats::item jobs_running;
+	extern stats::item jobs_completed;
+	extern stats::item jobs_rejected;
+	extern stats::item jobs_failed;
+	extern stats::item jobs_time;
 	extern log::log log;
 }
 
@@ -100,6 +115,92 @@ ircd::magick::yield_interval
 	{ "default", 768L                         },
 };
 
+decltype(ircd::magick::limit_pixels)
+ircd::magick::limit_pixels
+{
+	{ "name",    "ircd.magick.limit.pixels" },
+	{ "default", 64000000L                  },
+};
+
+decltype(ircd::magick::limit_time)
+ircd::magick::limit_time
+{
+	{ "name",    "ircd.magick.limit.time" },
+	{ "default", 10000L                   },
+};
+
+decltype(ircd::magick::pool_enable)
+ircd::magick::pool_enable
+{
+	{ "name",    "ircd.magick.pool.enable" },
+	{ "default", true                      },
+};
+
+decltype(ircd::magick::pool_concurrency)
+ircd::magick::pool_concurrency
+{
+	{ "name",    "ircd.magick.pool.concurrency" },
+	{ "default", 2L                             },
+};
+
+decltype(ircd::magick::pool_queue)
+ircd::magick::pool_queue
+{
+	{ "name",    "ircd.magick.pool.queue" },
+	{ "default", 32L                      },
+};
+
+decltype(ircd::magick::pool_running)
+ircd::magick::pool_running;
+
+decltype(ircd::magick::pool_queued)
+ircd::magick::pool_queued;
+
+decltype(ircd::magick::pool_dock)
+ircd::magick::pool_dock;
+
+decltype(ircd::magick::jobs_queued)
+ircd::magick::jobs_queued
+{
+	{ "name",    "ircd.magick.jobs.queued"                      },
+	{ "desc",    "Number of jobs waiting for a pool thread"     },
+};
+
+decltype(ircd::magick::jobs_running)
+ircd::magick::jobs_running
+{
+	{ "name",    "ircd.magick.jobs.running"                     },
+	{ "desc",    "Number of jobs running on the pool threads"   },
+};
+
+decltype(ircd::magick::jobs_completed)
+ircd::magick::jobs_completed
+{
+	{ "name",    "ircd.magick.jobs.completed"                   },
+	{ "desc",    "Number of jobs completed by the pool threads" },
+};
+
+decltype(ircd::magick::jobs_rejected)
+ircd::magick::jobs_rejected
+{
+	{ "name",    "ircd.magick.jobs.rejected"                    },
+	{ "desc",    "Number of jobs rejected because of a full queue" },
+};
+
+decltype(ircd::magick::jobs_failed)
+ircd::magick::jobs_failed
+{
+	{ "name",    "ircd.magick.jobs.failed"                      },
+	{ "desc",    "Number of jobs which threw from the pool"     },
+};
+
+decltype(ircd::magick::jobs_time)
+ircd::magick::jobs_time
+{
+	{ "name",    "ircd.magick.jobs.time"                        },
+	{ "desc",    "Total microseconds of jobs on the pool threads" },
+};
+
 // It is likely that we can't have two contexts enter libmagick
 // simultaneously. This race is possible if the progress callback yields
 // and another context starts an operation. It is highly unlikely the lib
@@ -271,7 +372,7 @@ ircd::magick::fini()
 	call_ready = false;
 	call_dock.wait([]
 	{
-		return !call_mutex.locked();
+		return !call_mutex.locked() && !pool_running;
 	});
 
 	DestroyMagick();
@@ -434,40 +535,70 @@ ircd::magick::transform::transform(const const_buffer &input,
                                    const output &output,
                                    const transformer &transformer)
 {
-	const custom_ptr<ImageInfo> input_info
+	// The decode, transform and encode are conducted as one job which may
+	// run on a pool thread; the output is always given on this context.
+	const_buffer result;
+	std::unique_ptr<void, void (*)(void *)> result_data
 	{
-		CloneImageInfo(nullptr),
-		DestroyImageInfo
+		nullptr, handle_free
 	};
 
-	const custom_ptr<ImageInfo> output_info
+	submit([&input, &transformer, &result, &result_data]
 	{
-		CloneImageInfo(nullptr),
-		DestroyImageInfo
-	};
+		const custom_ptr<ImageInfo> input_info
+		{
+			CloneImageInfo(nullptr),
+			DestroyImageInfo
+		};
 
-	const custom_ptr<Image> input_image
-	{
-		callex<Image *>(BlobToImage, input_info.get(), data(input), size(input)),
-		DestroyImage // pollock
-	};
+		const custom_ptr<ImageInfo> output_info
+		{
+			CloneImageInfo(nullptr),
+			DestroyImageInfo
+		};
 
-	const custom_ptr<Image> output_image
-	{
-		transformer({*input_info, input_image.get()}),
-		DestroyImage
-	};
+		// Read only the header to refuse images which would decode into
+		// more memory than we allow a single job.
+		const custom_ptr<Image> ping_image
+		{
+			callex<Image *>(PingBlob, input_info.get(), data(input), size(input)),
+			DestroyImage
+		};
 
-	size_t output_size(0);
-	const auto output_data
-	{
-		callex<void *>(ImageToBlob, output_info.get(), output_image.get(), &output_size)
-	};
+		const uint64_t pixels
+		{
+			uint64_t(ping_image->columns) * uint64_t(ping_image->rows)
+		};
 
-	const const_buffer result
-	{
-		reinterpret_cast<char *>(output_data), output_size
-	};
+		if(uint64_t(limit_pixels) && pixels > uint64_t(limit_pixels))
+			throw error
+			{
+				"Image %lux%lu pixels:%lu exceeds server limit:%lu",
+				ulong(ping_image->columns),
+				ulong(ping_image->rows),
+				pixels,
+				uint64_t(limit_pixels),
+			};
+
+		const custom_ptr<Image> input_image
+		{
+			callex<Image *>(BlobToImage, input_info.get(), data(input), size(input)),
+			DestroyImage // pollock
+		};
+
+		const custom_ptr<Image> output_image
+		{
+			transformer({*input_info, input_image.get()}),
+			DestroyImage
+		};
+
+		size_t output_size(0);
+		result_data.reset(callex<void *>(ImageToBlob, output_info.get(), output_image.get(), &output_size));
+		result = const_buffer
+		{
+			reinterpret_cast<char *>(result_data.get()), output_size
+		};
+	});
 
 	output(result);
 }
@@ -521,11 +652,16 @@ ircd::magick::callex(function&& f,
 			"Graphics library not ready."
 		};
 
-	const std::lock_guard lock
+	// Jobs on the pool threads each have their own images and enter the
+	// library concurrently; contexts on the main thread are serialized.
+	std::unique_lock<ctx::mutex> lock
 	{
-		call_mutex
+		call_mutex, std::defer_lock
 	};
 
+	if(ctx::current)
+		lock.lock();
+
 	ExceptionInfo ei;
 	GetExceptionInfo(&ei); // initializer
 	const unwind destroy{[&ei]
@@ -539,19 +675,10 @@ ircd::magick::callex(function&& f,
 		f(std::forward<args>(a)..., &ei)
 	};
 
-	const auto their_handler
-	{
-		SetErrorHandler(handle_exception)
-	};
-
-	const unwind reset{[&their_handler]
-	{
-		SetErrorHandler(their_handler);
-	}};
-
-	// exception comes out of here; if this is not safe we'll have to
-	// convey with a global or inspect ExceptionInfo manually.
-	CatchException(&ei);
+	// The ExceptionInfo is inspected here rather than swapping the global
+	// error handler for CatchException(), which isn't safe with jobs on
+	// several threads; an exception comes out of here.
+	handle_result(ei);
 	return ret;
 }
 
@@ -578,15 +705,28 @@ ircd::magick::call(function&& f,
 			"Graphics library not ready."
 		};
 
-	const std::lock_guard lock
+	std::unique_lock<ctx::mutex> lock
 	{
-		call_mutex
+		call_mutex, std::defer_lock
 	};
 
+	if(ctx::current)
+		lock.lock();
+
 	assert(call_ready);
 	return f(std::forward<args>(a)...);
 }
 
+void
+ircd::magick::handle_result(const ExceptionInfo &ei)
+{
+	if(ei.severity >= ErrorException)
+		handle_exception(ei.severity, ei.reason, ei.description);
+
+	if(ei.severity >= WarningException)
+		handle_warning(ei.severity, ei.reason, ei.description);
+}
+
 //
 // ircd::magick::job
 //
@@ -598,12 +738,14 @@ namespace ircd::magick
 	static void finished(job &);
 	static bool check_yield(job &);
 	static void check_cycles(job &);
+	static void check_time(job &);
 }
 
 struct ircd::magick::job::state
 {
 	uint64_t cycles {0};
 	uint64_t yield {0};
+	steady_point deadline;     // set for jobs on the pool threads
 	char description[1024];
 }
 thread_local ircd::magick::job::state;
@@ -627,7 +769,9 @@ noexcept try
 	// and monotonically increases across jobs as well.
 	const auto cycles_sample
 	{
-		ctx::this_ctx::cycles()
+		ctx::current?
+			ctx::this_ctx::cycles():
+			prof::cycles()
 	};
 
 	// Detect if this is a new job. Tick is usually zero for a new job, but for
@@ -676,6 +820,7 @@ noexcept try
 	#endif
 
 	check_cycles(job::cur);
+	check_time(job::cur);
 	check_yield(job::cur);
 
 	return true;
@@ -735,9 +880,32 @@ ircd::magick::check_cycles(job &job)
 		};
 }
 
+void
+ircd::magick::check_time(job &job)
+{
+	// Only jobs on the pool threads have a deadline.
+	if(likely(job::state.deadline == steady_point{}))
+		return;
+
+	if(unlikely(now<steady_point>() > job::state.deadline))
+		throw error
+		{
+			"job:%lu exceeded time limit of %ld ms (progress %2.2lf%% (%ld/%ld))",
+			job.id,
+			milliseconds(limit_time).count(),
+			(job.tick / double(job.ticks) * 100.0),
+			job.tick,
+			job.ticks,
+		};
+}
+
 bool
 ircd::magick::check_yield(job &job)
 {
+	// The pool threads have no contexts to yield to.
+	if(!ctx::current)
+		return false;
+
 	const uint64_t &yield_threshold
 	{
 		magick::yield_threshold
@@ -834,6 +1002,96 @@ ircd::magick::loghead(const job &job)
 	};
 }
 
+//
+// pool (internal)
+//
+
+/// Run the job on a ctx::ole thread and wait for it. At most
+/// pool_concurrency jobs run at once and pool_queue contexts wait for their
+/// turn; beyond that the job is rejected. When the pool is disabled the job
+/// runs here as it always has.
+void
+ircd::magick::submit(const std::function<void ()> &func)
+{
+	if(!pool_enable)
+		return func();
+
+	if(unlikely(pool_queued >= size_t(pool_queue)))
+	{
+		++jobs_rejected;
+		throw error
+		{
+			"Too many jobs waiting (%zu); try again later.",
+			pool_queued,
+		};
+	}
+
+	{
+		const scope_count queued
+		{
+			pool_queued
+		};
+
+		++jobs_queued;
+		const unwind dequeued{[]
+		{
+			--jobs_queued;
+		}};
+
+		pool_dock.wait([]
+		{
+			return pool_running < size_t(pool_concurrency);
+		});
+	}
+
+	const scope_count running
+	{
+		pool_running
+	};
+
+	++jobs_running;
+	const unwind done{[]
+	{
+		--jobs_running;
+		pool_dock.notify_one();
+		call_dock.notify_all();
+	}};
+
+	const unwind_exceptional failed{[]
+	{
+		++jobs_failed;
+	}};
+
+	const auto started
+	{
+		now<steady_point>()
+	};
+
+	const auto deadline
+	{
+		started + milliseconds(limit_time)
+	};
+
+	ctx::ole::opts opts;
+	opts.name = "magick";
+	ctx::offload
+	{
+		opts, [&func, &deadline]
+		{
+			job::state.deadline = deadline;
+			const unwind reset{[]
+			{
+				job::state.deadline = {};
+			}};
+
+			func();
+		}
+	};
+
+	jobs_time += duration_cast<microseconds>(now<steady_point>() - started).count();
+	++jobs_completed;
+}
+
 //
 // (Internal) patch panels
 //
@@ -39,6 +39,11 @@ get__download_local(client &client,
                     const string_view &file,
                     const m::room &room);
 
+static bool
+parse_range(std::pair<size_t, size_t> &range,
+            const string_view &header,
+            const size_t &file_size);
+
 static m::resource::response
 get__download(client &client,
               const m::resource::request &request)
@@ -127,39 +132,155 @@ get__download_local(client &client,
 		};
 	});
 
+	// A single range is honored; anything else sends the whole file. The
+	// content of an mxc never changes so any If-Range would be satisfied,
+	// but without an entity-tag we can't tell, so the whole file is sent.
+	std::pair<size_t, size_t> range
+	{
+		0, file_size
+	};
+
+	const bool ranged
+	{
+		request.head.range && !request.head.if_range
+	};
+
+	if(ranged && !parse_range(range, request.head.range, file_size))
+	{
+		char headers_buf[128];
+		return m::resource::response
+		{
+			client, http::RANGE_NOT_SATISFIABLE, content_type, 0UL, fmt::sprintf
+			{
+				headers_buf, "Content-Range: bytes */%zu\r\n", file_size
+			}
+		};
+	}
+
+	const bool partial
+	{
+		range.first != 0 || range.second != file_size
+	};
+
+	const size_t length
+	{
+		range.second - range.first
+	};
+
+	char headers_buf[128];
+	const string_view headers
+	{
+		partial?
+			fmt::sprintf
+			{
+				headers_buf, "Accept-Ranges: bytes\r\nContent-Range: bytes %zu-%zu/%zu\r\n",
+				range.first,
+				range.second - 1,
+				file_size,
+			}:
+			"Accept-Ranges: bytes\r\n"_sv
+	};
+
 	// Send HTTP head to client
 	m::resource::response
 	{
-		client, http::OK, content_type, file_size
+		client, partial? http::PARTIAL_CONTENT: http::OK, content_type, length, headers
 	};
 
+	// The blocks are streamed to the client as they are read from the
+	// database; the read seeks straight to the first block of the range.
 	size_t sent{0}, read
 	{
-		m::media::file::read(room, [&client, &sent]
+		m::media::file::read(room, range.first, length, [&client, &sent]
 		(const string_view &block)
 		{
-			sent += write_all(*client.sock, block);
+			sent += client.write_all(block);
 		})
 	};
 
-	if(unlikely(read != file_size))
+	if(unlikely(read != length))
 		log::error
 		{
 			m::media::log, "File %s/%s [%s] size mismatch: expected %zu got %zu",
 			server,
 			file,
 			string_view{room.room_id},
-			file_size,
+			length,
 			read
 		};
 
 	// Have to kill client here after failing content length expectation.
-	if(unlikely(read != file_size))
+	if(unlikely(read != length))
 		client.close(net::dc::RST, net::close_ignore);
 
 	return {};
 }
 
+/// Parse a Range header of one range in bytes into the half-open range;
+/// false if the range can't be satisfied. A header which can't be parsed or
+/// has several ranges leaves the range unmodified (the whole file).
+bool
+parse_range(std::pair<size_t, size_t> &range,
+            const string_view &header,
+            const size_t &file_size)
+try
+{
+	const auto &[unit, spec]
+	{
+		split(header, '=')
+	};
+
+	if(strip(unit) != "bytes" || has(spec, ','))
+		return true;
+
+	const auto &[first, last]
+	{
+		split(strip(spec), '-')
+	};
+
+	// suffix range: the last n bytes
+	if(!first)
+	{
+		const auto suffix
+		{
+			lex_cast<size_t>(last)
+		};
+
+		if(!suffix || !file_size)
+			return false;
+
+		range.first = file_size - std::min(suffix, file_size);
+		range.second = file_size;
+		return true;
+	}
+
+	const auto start
+	{
+		lex_cast<size_t>(first)
+	};
+
+	if(start >= file_size)
+		return false;
+
+	const auto end
+	{
+		last?
+			std::min(lex_cast<size_t>(last) + 1, file_size):
+			file_size
+	};
+
+	if(end <= start)
+		return true;
+
+	range.first = start;
+	range.second = end;
+	return true;
+}
+catch(const bad_lex_cast &)
+{
+	return true;
+}
+
 static m::resource::method
 method_get
 {
@@ -61,6 +61,11 @@ ircd::m::media::blocks_descriptor
 	Key-value store of blocks belonging to files. The key is a hash of
 	the block. The key is plaintext sha256-b58 and the block is binary
 	up to 32768 bytes.
+
+	Generated thumbnails are cached here as well. Their key is the path
+	server/mediaid/WxH/method, which never collides with a b58 hash; the
+	value is the whole thumbnail. The dimensions are of a fixed set and
+	each file keeps a limited number of them.
 	)",
 
 	// typing
@@ -425,6 +430,7 @@ ircd::m::media::file::write(const m::room &room,
 		{ "value", content_type }
 	});
 
+	int64_t depth(-1);
 	size_t off{0}, wrote{0};
 	while(off < size(content))
 	{
@@ -438,19 +444,126 @@ ircd::m::media::file::write(const m::room &room,
 			data(content) + off, blksz
 		};
 
-		block::set(room, user_id, block);
+		const auto event_id
+		{
+			block::set(room, user_id, block, off)
+		};
+
+		if(depth < 0)
+			depth = m::get<int64_t>(m::index(event_id), "depth");
+
 		wrote += size(block);
 		off += blksz;
 	}
 
+	// Every block but the last is the same size and they are at consecutive
+	// depths; the index lets a reader seek straight to the block containing
+	// any offset rather than walking the file from the beginning. The index
+	// is only a hint: a file written before it, or whose write stopped short
+	// of it, has none and seek() falls back to reading from the beginning.
+	if(depth >= 0)
+		send(room, user_id, "ircd.file.stat", "index", json::members
+		{
+			{ "depth",       depth         },
+			{ "block_size",  long(32_KiB)  },
+		});
+
 	assert(off == size(content));
 	assert(wrote == off);
 	return wrote;
 }
 
+/// Find the depth of the block containing offset and the offset where that
+/// block starts. The index written by file::write() is checked against the
+/// block found there; a file without an index is read from the beginning.
+std::pair<uint64_t, size_t>
+IRCD_MODULE_EXPORT
+ircd::m::media::file::seek(const m::room &room,
+                           const size_t &offset)
+{
+	const std::pair<uint64_t, size_t> start
+	{
+		1, 0
+	};
+
+	if(!offset)
+		return start;
+
+	static const event::fetch::opts fopts
+	{
+		event::keys::include { "content", "type" }
+	};
+
+	const m::room::state state
+	{
+		room, &fopts
+	};
+
+	int64_t depth(-1);
+	size_t block_size(0);
+	state.get(std::nothrow, "ircd.file.stat", "index", [&depth, &block_size]
+	(const m::event &event)
+	{
+		const json::object &content
+		{
+			at<"content"_>(event)
+		};
+
+		depth = content.get<int64_t>("depth", -1L);
+		block_size = content.get<size_t>("block_size", 0UL);
+	});
+
+	if(depth < 0 || !block_size)
+		return start;
+
+	const size_t block
+	{
+		offset / block_size
+	};
+
+	const std::pair<uint64_t, size_t> ret
+	{
+		depth + block, block * block_size
+	};
+
+	room::events it
+	{
+		room, ret.first, &fopts
+	};
+
+	if(!it || it.depth() != ret.first)
+		return start;
+
+	const m::event &event
+	{
+		*it
+	};
+
+	if(json::get<"type"_>(event) != "ircd.file.block")
+		return start;
+
+	if(json::get<"content"_>(event).get<size_t>("offset", -1UL) != ret.second)
+		return start;
+
+	return ret;
+}
+
+size_t
+IRCD_MODULE_EXPORT
+ircd::m::media::file::read(const m::room &room,
+                           const closure &closure)
+{
+	return read(room, 0, -1UL, closure);
+}
+
+/// Read length bytes of the file starting at offset into the closure; the
+/// first and last blocks are trimmed to the range. Blocks before the range
+/// are not fetched. Returns the number of bytes given to the closure.
 size_t
 IRCD_MODULE_EXPORT
 ircd::m::media::file::read(const m::room &room,
+                           const size_t &offset,
+                           const size_t &length,
                            const closure &closure)
 {
 	static const event::fetch::opts fopts
@@ -458,10 +571,22 @@ ircd::m::media::file::read(const m::room &room,
 		event::keys::include { "content", "type" }
 	};
 
-	size_t ret{0};
+	const size_t stop
+	{
+		length < -1UL - offset?
+			offset + length:
+			-1UL
+	};
+
+	const auto [depth, start]
+	{
+		seek(room, offset)
+	};
+
+	size_t ret{0}, pos{start};
 	room::events it
 	{
-		room, 1, &fopts
+		room, depth, &fopts
 	};
 
 	if(!it)
@@ -470,18 +595,18 @@ ircd::m::media::file::read(const m::room &room,
 	size_t events_fetched(0), events_prefetched(0);
 	room::events epf
 	{
-		room, 1, &fopts
+		room, depth, &fopts
 	};
 
-	size_t blocks_fetched(0), blocks_prefetched(0);
+	size_t blocks_fetched(0), blocks_prefetched(0), prefetch_pos{start};
 	room::events bpf
 	{
-		room, 1, &fopts
+		room, depth, &fopts
 	};
 
-	for(; it; ++it)
+	for(; it && pos < stop; ++it)
 	{
-		for(; bpf && blocks_prefetched < blocks_fetched + blocks_prefetch; ++bpf)
+		for(; bpf && blocks_prefetched < blocks_fetched + blocks_prefetch && prefetch_pos < stop; ++bpf)
 		{
 			for(; epf && events_prefetched < events_fetched + events_prefetch; ++epf)
 				events_prefetched += epf.prefetch();
@@ -495,12 +620,19 @@ ircd::m::media::file::read(const m::room &room,
 			if(at<"type"_>(event) != "ircd.file.block")
 				continue;
 
+			const json::object &content
+			{
+				at<"content"_>(event)
+			};
+
 			const json::string &hash
 			{
-				at<"content"_>(event).at("hash")
+				content.at("hash")
 			};
 
-			blocks_prefetched += block::prefetch(hash);
+			prefetch_pos += content.get<size_t>("size");
+			if(prefetch_pos > offset)
+				blocks_prefetched += block::prefetch(hash);
 		}
 
 		if(!blocks_fetched)
@@ -525,6 +657,15 @@ ircd::m::media::file::read(const m::room &room,
 			at<"content"_>(event).get<size_t>("size")
 		};
 
+		const size_t block_pos
+		{
+			pos
+		};
+
+		pos += block_size;
+		if(pos <= offset)
+			continue;
+
 		const auto handle{[&](const const_buffer &block)
 		{
 			if(unlikely(size(block) != block_size))
@@ -540,7 +681,24 @@ ircd::m::media::file::read(const m::room &room,
 				};
 
 			assert(size(block) == block_size);
-			ret += size(block);
+			const size_t first
+			{
+				offset > block_pos?
+					offset - block_pos:
+					0UL
+			};
+
+			const size_t last
+			{
+				std::min(block_size, stop - block_pos)
+			};
+
+			const const_buffer range
+			{
+				data(block) + first, last - first
+			};
+
+			ret += size(range);
 
 			#if 0
 			log::debug
@@ -557,7 +715,7 @@ ircd::m::media::file::read(const m::room &room,
 			};
 			#endif
 
-			closure(block);
+			closure(range);
 		}};
 
 		if(unlikely(!block::get(hash, handle)))
@@ -619,7 +777,8 @@ ircd::m::event::id::buf
 IRCD_MODULE_EXPORT
 ircd::m::media::block::set(const m::room &room,
                            const m::user::id &user_id,
-                           const const_buffer &block)
+                           const const_buffer &block,
+                           const size_t &offset)
 {
 	static constexpr const auto bufsz
 	{
@@ -634,8 +793,9 @@ ircd::m::media::block::set(const m::room &room,
 
 	return send(room, user_id, "ircd.file.block", json::members
 	{
-		{ "size",  long(size(block))  },
-		{ "hash",  hash               }
+		{ "size",    long(size(block))  },
+		{ "hash",    hash               },
+		{ "offset",  long(offset)       },
 	});
 }
 
@@ -44,4 +44,11 @@ namespace ircd::m::media::thumbnail
 	extern conf::item<size_t> height_max;
 	extern conf::item<std::string> mime_whitelist;
 	extern conf::item<std::string> mime_blacklist;
+	extern conf::item<std::string> sizes;
+	extern conf::item<bool> cache_enable;
+	extern conf::item<size_t> cache_max;
+	extern conf::item<size_t> cache_count;
+	extern conf::item<seconds> cache_wait;
+	extern std::set<std::string, std::less<>> rendering;
+	extern ctx::dock rendering_dock;
 }
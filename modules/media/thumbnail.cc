@@ -69,6 +69,47 @@ ircd::m::media::thumbnail::mime_blacklist
 	{ "default",  ""                                      },
 };
 
+decltype(ircd::m::media::thumbnail::sizes)
+ircd::m::media::thumbnail::sizes
+{
+	{ "name",     "ircd.m.media.thumbnail.sizes" },
+	{ "default",  "32 96 320 640 800 1536"      },
+};
+
+decltype(ircd::m::media::thumbnail::cache_enable)
+ircd::m::media::thumbnail::cache_enable
+{
+	{ "name",     "ircd.m.media.thumbnail.cache.enable" },
+	{ "default",  true                                  },
+};
+
+decltype(ircd::m::media::thumbnail::cache_max)
+ircd::m::media::thumbnail::cache_max
+{
+	{ "name",     "ircd.m.media.thumbnail.cache.max" },
+	{ "default",  long(2_MiB)                        },
+};
+
+decltype(ircd::m::media::thumbnail::cache_count)
+ircd::m::media::thumbnail::cache_count
+{
+	{ "name",     "ircd.m.media.thumbnail.cache.count" },
+	{ "default",  8L                                   },
+};
+
+decltype(ircd::m::media::thumbnail::cache_wait)
+ircd::m::media::thumbnail::cache_wait
+{
+	{ "name",     "ircd.m.media.thumbnail.cache.wait" },
+	{ "default",  15L                                 },
+};
+
+decltype(ircd::m::media::thumbnail::rendering)
+ircd::m::media::thumbnail::rendering;
+
+decltype(ircd::m::media::thumbnail::rendering_dock)
+ircd::m::media::thumbnail::rendering_dock;
+
 m::resource
 thumbnail_resource__legacy
 {
@@ -95,6 +136,14 @@ get__thumbnail_local(client &client,
                      const m::media::mxc &,
                      const m::room &room);
 
+static size_t
+thumbnail_snap(const size_t &value);
+
+static void
+thumbnail_cache_set(const string_view &prefix,
+                    const string_view &key,
+                    const const_buffer &buf);
+
 m::resource::response
 get__thumbnail(client &client,
                const m::resource::request &request)
@@ -165,15 +214,18 @@ get__thumbnail_local(client &client,
                      const m::media::mxc &mxc,
                      const m::room &room)
 {
-	const auto &method
+	// Anything but crop is scaled.
+	const string_view method
 	{
-		request.query.get("method", "scale"_sv)
+		request.query.get("method") == "crop"?
+			"crop"_sv:
+			"scale"_sv
 	};
 
 	std::pair<size_t, size_t> dimension
 	{
-		request.query.get<size_t>("width", 0),
-		request.query.get<size_t>("height", 0)
+		thumbnail_snap(request.query.get<size_t>("width", 0)),
+		thumbnail_snap(request.query.get<size_t>("height", 0))
 	};
 
 	if(dimension.first)
@@ -227,35 +279,6 @@ get__thumbnail_local(client &client,
 		};
 	});
 
-	const unique_buffer<mutable_buffer> buf
-	{
-		file_size
-	};
-
-	size_t copied(0);
-	const auto sink{[&buf, &copied]
-	(const const_buffer &block)
-	{
-		copied += copy(buf + copied, block);
-	}};
-
-	const size_t read_size
-	{
-		m::media::file::read(room, sink)
-	};
-
-	if(unlikely(read_size != file_size || file_size != copied))
-		throw ircd::error
-		{
-			"File %s/%s [%s] size mismatch: expected %zu got %zu copied %zu",
-			mxc.server,
-			mxc.mediaid,
-			string_view{room.room_id},
-			file_size,
-			read_size,
-			copied
-		};
-
 	const bool available
 	{
 		m::media::magick_support
@@ -278,10 +301,7 @@ get__thumbnail_local(client &client,
 	const bool valid_args
 	{
 		// Both dimension parameters given in query string
-		(dimension.first && dimension.second)
-
-		// Known thumbnailing method in query string
-		&& (method == "scale" || method == "crop")
+		dimension.first && dimension.second
 	};
 
 	const bool fallback // Reasons to just send the original image
@@ -315,19 +335,112 @@ get__thumbnail_local(client &client,
 				"Unknown reason",
 		};
 
-	if(fallback)
-		return m::resource::response
+	bool cache
+	{
+		!fallback && cache_enable && cache_count
+	};
+
+	char keybuf[512];
+	const string_view key
+	{
+		cache?
+			fmt::sprintf
+			{
+				keybuf, "%s/%s/%zux%zu/%s",
+				mxc.server,
+				mxc.mediaid,
+				dimension.first,
+				dimension.second,
+				method,
+			}:
+			string_view{}
+	};
+
+	// The renditions of the file share the key up to the dimensions.
+	const string_view prefix
+	{
+		key.substr(0, size(mxc.server) + 1 + size(mxc.mediaid) + 1)
+	};
+
+	const auto respond{[&client, &content_type]
+	(const const_buffer &buf)
+	{
+		m::resource::response
 		{
 			client, buf, content_type
 		};
+	}};
 
-	const auto closure{[&client, &content_type]
-	(const const_buffer &buf)
+	// A thumbnail is rendered by one request at a time; the others wait for
+	// it to be stored and are then served from the cache. One which waits
+	// too long renders its own without the cache.
+	while(cache)
 	{
-		m::resource::response
+		if(m::media::block::get(key, respond))
+			return {}; // responded from closure.
+
+		if(rendering.emplace(key).second)
+			break;
+
+		cache = rendering_dock.wait_for(seconds(cache_wait), [&key]
+		{
+			return !rendering.count(key);
+		});
+	}
+
+	const unwind rendered{[&cache, &key]
+	{
+		if(!cache)
+			return;
+
+		const auto it(rendering.find(key));
+		assert(it != end(rendering));
+		rendering.erase(it);
+		rendering_dock.notify_all();
+	}};
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		file_size
+	};
+
+	size_t copied(0);
+	const auto sink{[&buf, &copied]
+	(const const_buffer &block)
+	{
+		copied += copy(buf + copied, block);
+	}};
+
+	const size_t read_size
+	{
+		m::media::file::read(room, sink)
+	};
+
+	if(unlikely(read_size != file_size || file_size != copied))
+		throw ircd::error
+		{
+			"File %s/%s [%s] size mismatch: expected %zu got %zu copied %zu",
+			mxc.server,
+			mxc.mediaid,
+			string_view{room.room_id},
+			file_size,
+			read_size,
+			copied
+		};
+
+	if(fallback)
+		return m::resource::response
 		{
 			client, buf, content_type
 		};
+
+	const auto closure{[&cache, &prefix, &key, &respond]
+	(const const_buffer &buf)
+	{
+		if(cache && size(buf) <= size_t(cache_max))
+			thumbnail_cache_set(prefix, key, buf);
+
+		respond(buf);
 	}};
 
 	if(method == "crop")
@@ -343,3 +456,49 @@ get__thumbnail_local(client &client,
 
 	return {}; // responded from closure.
 }
+
+/// Requested dimensions are rounded up to the next of the configured sizes
+/// (ascending) so a file has a bounded number of renditions; a request
+/// beyond the largest gets the largest.
+size_t
+thumbnail_snap(const size_t &value)
+{
+	if(!value)
+		return 0;
+
+	size_t ret(0);
+	const token_view_bool closure{[&value, &ret]
+	(const string_view &size)
+	{
+		ret = lex_cast<size_t>(size);
+		return ret < value;
+	}};
+
+	tokens(string_view{sizes}, ' ', closure);
+
+	return ret?: value;
+}
+
+/// Store a rendition of a file. No more than cache.count are kept for each
+/// file; when there are as many already the others are dropped to make room.
+void
+thumbnail_cache_set(const string_view &prefix,
+                    const string_view &key,
+                    const const_buffer &buf)
+{
+	std::vector<std::string> keys;
+	for(auto it(m::media::blocks.lower_bound(prefix)); bool(it); ++it)
+	{
+		const string_view &cached(it->first);
+		if(!startswith(cached, prefix))
+			break;
+
+		if(cached != key)
+			keys.emplace_back(cached);
+	}
+
+	for(; !keys.empty() && keys.size() >= size_t(cache_count); keys.pop_back())
+		db::del(m::media::blocks, keys.back());
+
+	m::media::block::set(key, buf);
+}
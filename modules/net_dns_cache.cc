@@ -10,23 +10,51 @@
 
 namespace ircd::net::dns::cache
 {
+	struct entry;
+
+	using entries = std::unordered_map<std::string, entry>;
+	using expiry = std::multimap<time_t, const std::string *>;
+
+	static std::string make_key(const string_view &type, const string_view &state_key);
+	static const entry *find(const string_view &type, const string_view &state_key);
+	static size_t expire();
+
 	static bool call_waiter(const string_view &, const string_view &, const json::array &, waiter &);
 	static size_t call_waiters(const string_view &, const string_view &, const json::array &);
-	static void handle(const m::event &, m::vm::eval &);
 
+	static bool put(const string_view &type, const string_view &state_key, const json::array &rrs);
 	static bool put(const string_view &type, const string_view &state_key, const records &rrs);
 	static bool put(const string_view &type, const string_view &state_key, const uint &code, const string_view &msg);
 
+	static std::string snapshot_path();
+	static size_t snapshot_load();
+	static size_t snapshot_save();
+	static void snapshot_worker();
+
+	extern conf::item<seconds> snapshot_interval;
+	extern entries table;
+	extern expiry expiring;
+	extern bool dirty;
+	extern ctx::context snapshotter;
+
 	extern const m::room::id::buf dns_room_id;
-	extern m::hookfn<m::vm::eval &> hook;
 
 	static void init(), fini();
 }
 
+/// Records of one (type, state_key). The ts is when they were put; every
+/// record has expired at the time indexed by the expires iterator.
+struct ircd::net::dns::cache::entry
+{
+	std::string rrs;
+	time_t ts {0};
+	expiry::iterator expires;
+};
+
 ircd::mapi::header
 IRCD_MODULE
 {
-	"DNS cache using Matrix rooms.",
+	"DNS cache in memory with snapshots.",
 	ircd::net::dns::cache::init,
 	ircd::net::dns::cache::fini,
 };
@@ -37,23 +65,40 @@ ircd::net::dns::cache::dns_room_id
 	"dns", m::my_host()
 };
 
-decltype(ircd::net::dns::cache::hook)
-ircd::net::dns::cache::hook
+decltype(ircd::net::dns::cache::snapshot_interval)
+ircd::net::dns::cache::snapshot_interval
 {
-	ircd::net::dns::cache::handle,
-	{
-		{ "_site",    "vm.effect"              },
-		{ "room_id",  string_view{dns_room_id} },
-	}
+	{ "name",     "ircd.net.dns.cache.snapshot.interval" },
+	{ "default",  300L                                   },
+};
+
+decltype(ircd::net::dns::cache::table)
+ircd::net::dns::cache::table;
+
+decltype(ircd::net::dns::cache::expiring)
+ircd::net::dns::cache::expiring;
+
+decltype(ircd::net::dns::cache::dirty)
+ircd::net::dns::cache::dirty;
+
+decltype(ircd::net::dns::cache::snapshotter)
+ircd::net::dns::cache::snapshotter
+{
+	"dnscache", 256_KiB, &snapshot_worker, context::POST,
 };
 
 void
 ircd::net::dns::cache::init()
 {
+	const auto count
+	{
+		snapshot_load()
+	};
+
 	log::debug
 	{
-		"DNS cache room %s currently set.",
-		string_view{dns_room_id}
+		log, "DNS cache loaded %zu entries from snapshot.",
+		count,
 	};
 }
 
@@ -71,6 +116,11 @@ ircd::net::dns::cache::fini()
 	{
 		return waiting.empty();
 	});
+
+	snapshotter.terminate();
+	snapshotter.join();
+	if(dirty && seconds(snapshot_interval) > 0s)
+		snapshot_save();
 }
 
 bool
@@ -132,76 +182,41 @@ ircd::net::dns::cache::put(const string_view &type,
                            const string_view &msg)
 try
 {
-	char content_buf[1024];
-	json::stack out{content_buf};
-	json::stack::object content{out};
-	json::stack::array array
-	{
-		content, ""
-	};
-
-	json::stack::object rr0
-	{
-		array
-	};
-
-	json::stack::member
-	{
-		rr0, "errcode", lex_cast(code)
-	};
-
-	json::stack::member
-	{
-		rr0, "error", msg
-	};
-
-	json::stack::member
+	char buf[1024];
+	json::stack out{buf};
 	{
-		rr0, "ttl", json::value
+		json::stack::array array
 		{
-			code == 3?
-				long(seconds(nxdomain_ttl).count()):
-				long(seconds(error_ttl).count())
-		}
-	};
+			out
+		};
 
-	rr0.~object();
-	array.~array();
-	content.~object();
-	const m::room room
-	{
-		dns_room_id
-	};
+		json::stack::object rr0
+		{
+			array
+		};
 
-	if(unlikely(!exists(room)))
-		create(room, m::me(), "internal");
+		json::stack::member
+		{
+			rr0, "errcode", lex_cast(code)
+		};
 
-	send(room, m::me(), type, state_key, json::object(out.completed()));
-	return true;
-}
-catch(const http::error &e)
-{
-	const ctx::exception_handler eh;
-	log::error
-	{
-		log, "cache put (%s, %s) code:%u (%s) :%s %s",
-		type,
-		state_key,
-		code,
-		msg,
-		e.what(),
-		e.content,
-	};
+		json::stack::member
+		{
+			rr0, "error", msg
+		};
 
-	const json::value error_value
-	{
-		json::object{e.content}
-	};
+		json::stack::member
+		{
+			rr0, "ttl", json::value
+			{
+				code == 3?
+					long(seconds(nxdomain_ttl).count()):
+					long(seconds(error_ttl).count())
+			}
+		};
+	}
 
-	const json::value error_records{&error_value, 1};
-	const json::strung error{error_records};
-	call_waiters(type, state_key, error);
-	return false;
+	return put(type, state_key, json::array{out.completed()});
 }
 catch(const std::exception &e)
 {
@@ -240,118 +255,130 @@ try
 	};
 
 	json::stack out{buf};
-	json::stack::object content{out};
-	json::stack::array array
 	{
-		content, ""
-	};
+		json::stack::array array
+		{
+			out
+		};
 
-	if(rrs.empty())
-	{
-		// Add one object to the array with nothing except a ttl indicating no
-		// records (and no error) so we can cache that for the ttl. We use the
-		// nxdomain ttl for this value.
-		json::stack::object rr0{array};
-		json::stack::member
+		if(rrs.empty())
 		{
-			rr0, "ttl", json::value
+			// Add one object to the array with nothing except a ttl indicating
+			// no records (and no error) so we can cache that for the ttl. We
+			// use the nxdomain ttl for this value.
+			json::stack::object rr0{array};
+			json::stack::member
 			{
-				long(seconds(nxdomain_ttl).count())
-			}
-		};
-	}
-	else for(const auto &record : rrs)
-	{
-		switch(record->type)
+				rr0, "ttl", json::value
+				{
+					long(seconds(nxdomain_ttl).count())
+				}
+			};
+		}
+		else for(const auto &record : rrs)
 		{
-			case 1: // A
+			switch(record->type)
 			{
-				json::stack::object object{array};
-				dynamic_cast<const rfc1035::record::A *>(record)->append(object);
-				continue;
-			}
+				case 1: // A
+				{
+					json::stack::object object{array};
+					dynamic_cast<const rfc1035::record::A *>(record)->append(object);
+					continue;
+				}
 
-			case 5: // CNAME
-			{
-				json::stack::object object{array};
-				dynamic_cast<const rfc1035::record::CNAME *>(record)->append(object);
-				continue;
-			}
+				case 5: // CNAME
+				{
+					json::stack::object object{array};
+					dynamic_cast<const rfc1035::record::CNAME *>(record)->append(object);
+					continue;
+				}
 
-			case 28: // AAAA
-			{
-				json::stack::object object{array};
-				dynamic_cast<const rfc1035::record::AAAA *>(record)->append(object);
-				continue;
-			}
+				case 28: // AAAA
+				{
+					json::stack::object object{array};
+					dynamic_cast<const rfc1035::record::AAAA *>(record)->append(object);
+					continue;
+				}
 
-			case 33: // SRV
-			{
-				json::stack::object object{array};
-				dynamic_cast<const rfc1035::record::SRV *>(record)->append(object);
-				continue;
+				case 33: // SRV
+				{
+					json::stack::object object{array};
+					dynamic_cast<const rfc1035::record::SRV *>(record)->append(object);
+					continue;
+				}
 			}
 		}
 	}
 
-	array.~array();
-	content.~object();
-	const m::room room
-	{
-		dns_room_id
-	};
-
-	if(unlikely(!exists(room)))
-		create(room, m::me(), "internal");
-
-	send(room, m::me(), type, state_key, json::object{out.completed()});
-	return true;
+	return put(type, state_key, json::array{out.completed()});
 }
-catch(const http::error &e)
+catch(const std::exception &e)
 {
 	const ctx::exception_handler eh;
 	log::error
 	{
-		log, "cache put (%s, %s) rrs:%zu :%s %s",
+		log, "cache put (%s, %s) rrs:%zu :%s",
 		type,
 		state_key,
 		rrs.size(),
 		e.what(),
-		e.content,
 	};
 
-	const json::value error_value
+	const json::members error_object
 	{
-		json::object{e.content}
+		{ "error", e.what() },
 	};
 
+	const json::value error_value{error_object};
 	const json::value error_records{&error_value, 1};
 	const json::strung error{error_records};
 	call_waiters(type, state_key, error);
 	return false;
 }
-catch(const std::exception &e)
+
+/// Replaces the records of the (type, state_key) and indexes them by the
+/// time the last of them expires. Waiters for them are called back with the
+/// caller's copy; they may put into the cache again from their frame.
+bool
+ircd::net::dns::cache::put(const string_view &type,
+                           const string_view &state_key,
+                           const json::array &rrs)
 {
-	const ctx::exception_handler eh;
-	log::error
+	const time_t ts
 	{
-		log, "cache put (%s, %s) rrs:%zu :%s",
-		type,
-		state_key,
-		rrs.size(),
-		e.what(),
+		ircd::time()
 	};
 
-	const json::members error_object
+	time_t expires(ts);
+	for(const json::object rr : rrs)
 	{
-		{ "error", e.what() },
+		const seconds &min
+		{
+			is_error(rr)? error_ttl : min_ttl
+		};
+
+		expires = std::max(expires, ts + std::max(get_ttl(rr), time_t(min.count())));
+	}
+
+	auto it
+	{
+		table.find(make_key(type, state_key))
 	};
 
-	const json::value error_value{error_object};
-	const json::value error_records{&error_value, 1};
-	const json::strung error{error_records};
-	call_waiters(type, state_key, error);
-	return false;
+	if(it == end(table))
+		it = table.emplace(make_key(type, state_key), entry{}).first;
+	else
+		expiring.erase(it->second.expires);
+
+	auto &entry(it->second);
+	entry.rrs = std::string(rrs);
+	entry.ts = ts;
+	entry.expires = expiring.emplace(expires, &it->first);
+	dirty = true;
+
+	expire();
+	call_waiters(type, state_key, rrs);
+	return true;
 }
 
 bool
@@ -374,44 +401,39 @@ ircd::net::dns::cache::get(const hostport &hp,
 			host(hp)
 	};
 
-	const m::room::state state
-	{
-		dns_room_id
-	};
-
-	const m::event::idx &event_idx
+	const auto *const entry
 	{
-		state.get(std::nothrow, type, state_key)
+		find(type, state_key)
 	};
 
-	if(!event_idx)
+	if(!entry)
 		return false;
 
-	time_t origin_server_ts;
-	if(!m::get<time_t>(event_idx, "origin_server_ts", origin_server_ts))
-		return false;
+	// The closure may put into the cache from its frame.
+	const std::string content
+	{
+		entry->rrs
+	};
 
-	bool ret{false};
-	const time_t ts{origin_server_ts / 1000L};
-	m::get(std::nothrow, event_idx, "content", [&hp, &closure, &ret, &ts]
-	(const json::object &content)
+	const json::array rrs
 	{
-		const json::array &rrs
-		{
-			content.get("")
-		};
+		content
+	};
 
-		// If all records are expired then skip; otherwise since this closure
-		// expects a single array we reveal both expired and valid records.
-		ret = !std::all_of(begin(rrs), end(rrs), [&ts]
+	// If all records are expired then skip; otherwise since this closure
+	// expects a single array we reveal both expired and valid records.
+	const time_t &ts(entry->ts);
+	const bool ret
+	{
+		!std::all_of(begin(rrs), end(rrs), [&ts]
 		(const json::object &rr)
 		{
 			return expired(rr, ts);
-		});
+		})
+	};
 
-		if(ret && closure)
-			closure(hp, rrs);
-	});
+	if(ret && closure)
+		closure(hp, rrs);
 
 	return ret;
 }
@@ -436,39 +458,25 @@ ircd::net::dns::cache::for_each(const hostport &hp,
 			host(hp)
 	};
 
-	const m::room::state state
+	const auto *const entry
 	{
-		dns_room_id
+		find(type, state_key)
 	};
 
-	const m::event::idx &event_idx
-	{
-		state.get(std::nothrow, type, state_key)
-	};
-
-	if(!event_idx)
+	if(!entry)
 		return false;
 
-	time_t origin_server_ts;
-	if(!m::get<time_t>(event_idx, "origin_server_ts", origin_server_ts))
-		return false;
-
-	bool ret{true};
-	const time_t ts{origin_server_ts / 1000L};
-	m::get(std::nothrow, event_idx, "content", [&state_key, &closure, &ret, &ts]
-	(const json::object &content)
+	const time_t &ts(entry->ts);
+	for(const json::object &rr : json::array(entry->rrs))
 	{
-		for(const json::object &rr : json::array(content.get("")))
-		{
-			if(expired(rr, ts))
-				continue;
+		if(expired(rr, ts))
+			continue;
 
-			if(!(ret = closure(state_key, rr)))
-				break;
-		}
-	});
+		if(!closure(state_key, rr))
+			return false;
+	}
 
-	return ret;
+	return true;
 }
 
 bool
@@ -482,68 +490,266 @@ ircd::net::dns::cache::for_each(const string_view &type,
 		make_type(type_buf, type)
 	};
 
-	const m::room::state state
+	for(const auto &[key, entry] : table)
+	{
+		const auto &[entry_type, state_key]
+		{
+			split(key, '\0')
+		};
+
+		if(entry_type != full_type)
+			continue;
+
+		const time_t &ts(entry.ts);
+		for(const json::object &rr : json::array(entry.rrs))
+		{
+			if(expired(rr, ts))
+				continue;
+
+			if(!closure(state_key, rr))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/// Entries whose records have all expired are dropped in the order they
+/// expire.
+size_t
+ircd::net::dns::cache::expire()
+{
+	const time_t now
 	{
-		dns_room_id
+		ircd::time()
 	};
 
-	return state.for_each(full_type, [&closure]
-	(const string_view &, const string_view &state_key, const m::event::idx &event_idx)
+	size_t ret(0);
+	auto it(begin(expiring));
+	for(; it != end(expiring) && it->first < now; ++ret)
 	{
-		time_t origin_server_ts;
-		if(!m::get<time_t>(event_idx, "origin_server_ts", origin_server_ts))
-			return true;
+		table.erase(*it->second);
+		it = expiring.erase(it);
+	}
 
-		bool ret{true};
-		const time_t ts{origin_server_ts / 1000L};
-		m::get(std::nothrow, event_idx, "content", [&state_key, &closure, &ret, &ts]
-		(const json::object &content)
-		{
-			for(const json::object &rr : json::array(content.get("")))
-			{
-				if(expired(rr, ts))
-					continue;
+	dirty |= ret > 0;
+	return ret;
+}
 
-				if(!(ret = closure(state_key, rr)))
-					break;
-			}
-		});
+const ircd::net::dns::cache::entry *
+ircd::net::dns::cache::find(const string_view &type,
+                            const string_view &state_key)
+{
+	const auto it
+	{
+		table.find(make_key(type, state_key))
+	};
 
-		return ret;
-	});
+	return it != end(table)? &it->second : nullptr;
 }
 
+std::string
+ircd::net::dns::cache::make_key(const string_view &type,
+                                const string_view &state_key)
+{
+	std::string ret;
+	ret.reserve(size(type) + 1 + size(state_key));
+	ret.append(type);
+	ret.push_back('\0');
+	ret.append(state_key);
+	return ret;
+}
+
+//
+// snapshot
+//
+
+/// The cache is written out in full every interval while it has changed,
+/// and once more when the module unloads. Each line of the file is a JSON
+/// array of the type, the state_key, the ts and the records.
 void
-ircd::net::dns::cache::handle(const m::event &event,
-                              m::vm::eval &eval)
+ircd::net::dns::cache::snapshot_worker()
+try
+{
+	while(1)
+	{
+		const seconds interval
+		{
+			snapshot_interval
+		};
+
+		ctx::sleep(interval > 0s? interval : 60s);
+		expire();
+
+		if(dirty && interval > 0s)
+			snapshot_save();
+	}
+}
+catch(const ctx::terminated &)
+{
+	return;
+}
+
+size_t
+ircd::net::dns::cache::snapshot_save()
 try
 {
-	const string_view &type
+	std::string out;
+	for(const auto &[key, entry] : table)
+	{
+		const auto &[type, state_key]
+		{
+			split(key, '\0')
+		};
+
+		const json::value line[4]
+		{
+			json::value{type, json::STRING},
+			json::value{state_key, json::STRING},
+			json::value{long(entry.ts)},
+			json::value{entry.rrs, json::ARRAY},
+		};
+
+		out.append(json::strung(json::value{line, 4}));
+		out.push_back('\n');
+	}
+
+	// Nothing may yield before this point; the entries are only copied.
+	dirty = false;
+	const auto path
 	{
-		json::get<"type"_>(event)
+		snapshot_path()
 	};
 
-	if(!startswith(type, "ircd.dns.rrs."))
-		return;
+	const auto tmp
+	{
+		path + ".tmp"
+	};
 
-	const string_view &state_key
+	fs::overwrite(tmp, const_buffer{out});
+	fs::rename(tmp, path);
+
+	log::debug
 	{
-		json::get<"state_key"_>(event)
+		log, "DNS cache snapshot of %zu entries (%zu bytes) to `%s'",
+		table.size(),
+		out.size(),
+		path,
 	};
 
-	const json::array &rrs
+	return table.size();
+}
+catch(const ctx::interrupted &)
+{
+	dirty = true;
+	throw;
+}
+catch(const std::exception &e)
+{
+	dirty = true;
+	log::error
 	{
-		json::get<"content"_>(event).get("")
+		log, "DNS cache snapshot :%s",
+		e.what(),
 	};
 
-	call_waiters(type, state_key, rrs);
+	return 0;
+}
+
+size_t
+ircd::net::dns::cache::snapshot_load()
+try
+{
+	const auto path
+	{
+		snapshot_path()
+	};
+
+	if(!fs::exists(path))
+		return 0;
+
+	const std::string in
+	{
+		fs::read(path)
+	};
+
+	const time_t now
+	{
+		ircd::time()
+	};
+
+	size_t ret(0);
+	tokens(in, '\n', token_view_bool{[&ret, &now]
+	(const string_view &line)
+	{
+		const json::array row
+		{
+			line
+		};
+
+		const json::string type(row.at(0));
+		const json::string state_key(row.at(1));
+		const time_t ts(row.at<time_t>(2));
+		const json::array rrs(row.at(3));
+
+		const bool live
+		{
+			!std::all_of(begin(rrs), end(rrs), [&ts]
+			(const json::object &rr)
+			{
+				return expired(rr, ts);
+			})
+		};
+
+		if(!live)
+			return true;
+
+		// Keep the original ts so the records expire on schedule.
+		time_t expires(ts);
+		for(const json::object rr : rrs)
+		{
+			const seconds &min
+			{
+				is_error(rr)? error_ttl : min_ttl
+			};
+
+			expires = std::max(expires, ts + std::max(get_ttl(rr), time_t(min.count())));
+		}
+
+		auto it
+		{
+			table.emplace(make_key(type, state_key), entry{}).first
+		};
+
+		auto &entry(it->second);
+		entry.rrs = std::string(rrs);
+		entry.ts = ts;
+		entry.expires = expiring.emplace(std::max(expires, now), &it->first);
+		++ret;
+		return true;
+	}});
+
+	return ret;
+}
+catch(const ctx::interrupted &)
+{
+	throw;
 }
 catch(const std::exception &e)
 {
-	log::critical
+	log::error
 	{
-		log, "handle_cached() :%s", e.what()
+		log, "DNS cache snapshot load :%s",
+		e.what(),
 	};
+
+	return 0;
+}
+
+std::string
+ircd::net::dns::cache::snapshot_path()
+{
+	return fs::path_string(fs::base::DB, "dns.cache");
 }
 
 /// Note complications due to reentrance and other factors: